@@ -8,8 +8,18 @@
 #include <iomanip>
 #include <algorithm>
 #include <shellapi.h>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
 #include "common/communication.h"
+#include "common/desktopstate.h"
+#include "common/control.h"
+#include "common/framestream.h"
+#include "backend/Win32DesktopBackend.hpp"
+#include "DesktopIcons.hpp"
 #include "tool/LogMessage.hpp"
+#include "tool/SliceScheduler.hpp"
+#include "tool/Animator.hpp"
 #include "tool/A.hpp"
 #define MAX_ICON_COUNT 256
 using namespace std;
@@ -60,6 +70,15 @@ extern "C" __declspec(dllexport) void DLL_ForceUnload() {
 //	int itemIndex;
 //};
 
+// @struct EnumerationSnapshot
+// @brief 一次分页枚举开始时抓取的图标快照
+// @note 同一次枚举的所有分页都从这里读取，枚举期间图标增删不会导致遗漏或重复
+struct EnumerationSnapshot {
+	uint32_t generation = 0;		// 快照代号，0 表示还没有快照
+	vector<wstring> names;			// 图标名称
+	vector<DesktopPoint> points;	// 图标坐标
+};
+
 // @class DLL_Mover
 // @brief 操作桌面
 class DLL_Mover
@@ -67,8 +86,12 @@ class DLL_Mover
 public:
 	// @brief 初始化
 	// @param _logMessage 传个 LogMessage 来记录日志
-	DLL_Mover(LogMessage& logMessage) : logMessage(logMessage) {
-		this->m_hListView = this->GetHListView();
+	DLL_Mover(LogMessage& logMessage) : logMessage(logMessage), backend(new Win32DesktopBackend(logMessage)) {
+	}
+
+	// @brief 使用指定的桌面后端初始化（如 SimulatedDesktopBackend）
+	DLL_Mover(LogMessage& logMessage, unique_ptr<DesktopBackend> backend) : logMessage(logMessage), backend(std::move(backend)) {
+		logMessage.log(L"桌面后端: " + wstring(this->backend->GetName()));
 	}
 
 	// @brief 检查环境兼容性
@@ -185,12 +208,80 @@ public:
 			return EXIT_FAILURE;
 		}
 
+		// 创建桌面状态共享内存（只读发布，失败不影响命令处理）
+		HandleGuard stateMapping(CreateFileMappingW(
+			INVALID_HANDLE_VALUE,
+			nullptr,
+			PAGE_READWRITE,
+			0,
+			sizeof(DesktopState),
+			DESKTOP_STATE_NAME));
+		if (stateMapping)
+			this->desktopState = reinterpret_cast<DesktopState*>(MapViewOfFile(stateMapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(DesktopState)));
+		if (this->desktopState) this->PublishDesktopState();
+		else logMessage.log(L"创建桌面状态共享内存失败，错误代码: " + to_wstring(GetLastError()));
+
+		// 读者心跳：客户端唯一可写的部分，与桌面状态分开（失败时只在执行命令后更新桌面状态）
+		HandleGuard readerMapping(CreateFileMappingW(
+			INVALID_HANDLE_VALUE,
+			nullptr,
+			PAGE_READWRITE,
+			0,
+			sizeof(DesktopStateReader),
+			DESKTOP_STATE_READER_NAME));
+		if (readerMapping)
+			this->stateReader = reinterpret_cast<DesktopStateReader*>(MapViewOfFile(readerMapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(DesktopStateReader)));
+		if (!this->stateReader)
+			logMessage.log(L"创建读者心跳共享内存失败，错误代码: " + to_wstring(GetLastError()));
+
+		// 创建帧流（失败不影响命令处理）
+		HandleGuard streamMapping(CreateFileMappingW(
+			INVALID_HANDLE_VALUE,
+			nullptr,
+			PAGE_READWRITE,
+			0,
+			sizeof(FrameStreamRegion),
+			FRAME_STREAM_MEM_NAME));
+		HandleGuard streamReadyEvent(CreateEventW(NULL, FALSE, FALSE, FRAME_STREAM_READY_EVENT_NAME));
+		HandleGuard streamAppliedEvent(CreateEventW(NULL, FALSE, FALSE, FRAME_STREAM_APPLIED_EVENT_NAME));
+		if (streamMapping && streamReadyEvent && streamAppliedEvent)
+			this->frameStream = reinterpret_cast<FrameStreamRegion*>(MapViewOfFile(streamMapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(FrameStreamRegion)));
+		if (this->frameStream) {
+			initFrameStream(this->frameStream, this->streamFront);
+			this->streamReadyEvent = streamReadyEvent.handle;
+			this->streamAppliedEvent = streamAppliedEvent.handle;
+		}
+		else logMessage.log(L"创建帧流失败，错误代码: " + to_wstring(GetLastError()));
+
+		// 控制通道：存活检测不与批量命令排队
+		if (!this->StartControlLane())
+			logMessage.log(L"启动控制通道失败，错误代码: " + to_wstring(GetLastError()));
+
+		// 通知主程序：已经可以接收命令
+		HandleGuard readyEvent(CreateEventW(NULL, TRUE, FALSE, READY_EVENT_NAME));
+		if (readyEvent) SetEvent(readyEvent);
+		else logMessage.log(L"打开就绪事件失败，错误代码: " + to_wstring(GetLastError()));
+
 		// 等待命令
 		logMessage.log(L"等待命令...");
 
 		// 处理请求
 		ProcessRequest(cmdEvent.handle, rspEvent.handle, sharedMemView);
 
+		if (this->desktopState) {
+			UnmapViewOfFile(this->desktopState);
+			this->desktopState = nullptr;
+		}
+		if (this->stateReader) {
+			UnmapViewOfFile(this->stateReader);
+			this->stateReader = nullptr;
+		}
+		if (this->frameStream) {
+			UnmapViewOfFile(this->frameStream);
+			this->frameStream = nullptr;
+		}
+		this->streamReadyEvent = this->streamAppliedEvent = nullptr;
+
 		return EXIT_SUCCESS;
 	}
 
@@ -205,16 +296,41 @@ public:
 			// 等待命令事件
 			logMessage.log(L"新一轮命令循环");
 			SetEvent(rspEvent); // 就绪
-			DWORD waitResult = WaitForSingleObject(cmdEvent, INFINITE);
+			// 执行过改变桌面的命令、或最近有客户端读取桌面状态时，空闲时更新桌面状态；帧流有新帧时立即应用
+			const HANDLE waits[] = { cmdEvent, this->streamReadyEvent };
+			const DWORD waitCount = this->frameStream ? 2 : 1;
+			DWORD waitResult;
+			while (true) {
+				waitResult = WaitForMultipleObjects(waitCount, waits, FALSE, this->stateDirty ? DESKTOP_STATE_SETTLE : DESKTOP_STATE_REFRESH);
+				if (waitResult == WAIT_TIMEOUT) {
+					if (this->stateDirty || (this->stateReader && hasRecentDesktopStateReader(this->stateReader)))
+						this->PublishDesktopState();
+				}
+				else if (waitResult == WAIT_OBJECT_0 + 1) this->ApplyStreamFrame();
+				else break;
+			}
 			if (waitResult == WAIT_OBJECT_0) {
 				sharedMemView->errorNumber = 0;
 				sharedMemView->errorMessage[0] = L'\0';
+				sharedMemView->sliceCount = 0;
+				sharedMemView->maxSliceMicroseconds = 0;
+				sharedMemView->framesRendered = 0;
+				sharedMemView->framesDropped = 0;
+				sharedMemView->fingerprint = LayoutFingerprint();
 				logMessage.log(L"---------- 接收命令 ----------");
 				logMessage.log(L"sharedMemView->command      = " + to_wstring(static_cast<int>(sharedMemView->command)));
 				logMessage.log(L"sharedMemView->size         = " + to_wstring(sharedMemView->size));
 				logMessage.log(L"sharedMemView->u_batchIndex = " + to_wstring(sharedMemView->u_batchIndex));
 				logMessage.log(L"sharedMemView->errorNumber  = " + to_wstring(sharedMemView->errorNumber));
 				logMessage.log(L"-----------------------------");
+				this->progressDone = 0;
+				this->progressTotal = 0;
+				this->progressErrors = 0;
+				this->cancelRequested = false;
+				if (this->backend) this->backend->ResetWatchdog(); // 每条命令重新判定界面线程是否无响应
+				this->activeSinceTick = GetTickCount64();
+				this->activeCommand = sharedMemView->command;
+				this->streamSliceBudget = sharedMemView->sliceBudget; // 帧流沿用客户端最近一次命令的时间片预算
 				switch (sharedMemView->command)
 				{
 				case CommandID::COMMAND_F_CK_WINDOWS:
@@ -222,11 +338,13 @@ public:
 					exit(static_cast<int>(CommandID::COMMAND_F_CK_WINDOWS));
 				case CommandID::COMMAND_FORCE_EXIT:
 					logMessage.log(L"请求处理完成: 强制退出");
+					this->StopControlLane();
 					SetEvent(rspEvent);
 					DLL_FreeLibrary();
 					return;
 				case CommandID::COMMAND_EXIT:
 					logMessage.log(L"请求处理完成: 正常退出");
+					this->StopControlLane();
 					SetEvent(rspEvent);
 					DLL_ForceUnload();
 					return;
@@ -238,6 +356,10 @@ public:
 					this->ProcessMoveRequest(sharedMemView, true);
 					logMessage.log(L"请求处理完成: 移动图标（比率）");
 					break;
+				case CommandID::COMMAND_ANIMATE:
+					this->ProcessAnimateRequest(sharedMemView);
+					logMessage.log(L"请求处理完成: 平滑移动图标");
+					break;
 				case CommandID::COMMAND_REFRESH_DESKTOP:
 					this->RefreshDesktop();
 					logMessage.log(L"请求处理完成: 刷新桌面");
@@ -253,6 +375,14 @@ public:
 					this->ProcessGetAllIconsRequest(sharedMemView);
 					logMessage.log(L"请求处理完成: 获取桌面上所有图标");
 					break;
+				case CommandID::COMMAND_GET_POSITIONS:
+					this->ProcessGetPositionsRequest(sharedMemView);
+					logMessage.log(L"请求处理完成: 获取桌面上所有图标位置");
+					break;
+				case CommandID::COMMAND_GET_FINGERPRINT:
+					this->ProcessGetFingerprintRequest(sharedMemView);
+					logMessage.log(L"请求处理完成: 计算布局指纹");
+					break;
 				case CommandID::COMMAND_GET_ICON_NUMBER:
 					this->ProcessGetIconNumberRequest(sharedMemView);
 					logMessage.log(L"请求处理完成: 获取桌面图标数量");
@@ -272,6 +402,12 @@ public:
 					logMessage.log(L"未知请求");
 					break;
 				}
+				this->activeCommand = CommandID::COMMAND_INVALID;
+				// 可能改变桌面的命令之后，下一次空闲时尽快更新桌面状态，帧流重新确认图标索引与位置
+				if (!isQueryCommand(sharedMemView->command)) {
+					this->stateDirty = true;
+					this->streamItemCount = -1;
+				}
 				logMessage.log(L"---------- 回复命令 ----------");
 				logMessage.log(L"sharedMemView->command      = " + to_wstring(static_cast<int>(sharedMemView->command)));
 				logMessage.log(L"sharedMemView->size         = " + to_wstring(sharedMemView->size));
@@ -292,253 +428,500 @@ private:
 	// 系统层
 	// -------------------------------
 
-	// @brief 查找桌面 ListView 窗口
-	HWND FindDesktopListView() {
-		logMessage.log(L"开始查找桌面ListView窗口...");
-
-		// 标准方法
-		HWND hWorker = nullptr;
-		while ((hWorker = FindWindowEx(nullptr, hWorker, L"WorkerW", nullptr))) {
-			HWND hShell = FindWindowEx(hWorker, nullptr, L"SHELLDLL_DefView", nullptr);
-			if (hShell) {
-				HWND hList = FindWindowEx(hShell, nullptr, L"SysListView32", L"FolderView");
-				if (hList && IsWindowVisible(hList)) {
-					logMessage.log(L"通过WorkerW找到桌面ListView窗口");
-					return hList;
-				}
-			}
+	// @brief 获取可用的桌面后端
+	// @ret 后端不可用时返回 nullptr
+	DesktopBackend* GetDesktop()
+	{
+		return this->backend && this->backend->IsAvailable() ? this->backend.get() : nullptr;
+	}
+
+	// @brief 处理移动请求 CommandID = COMMAND_MOVE_ICON_BY_RATE or COMMAND_MOVE_ICON
+	// @note 请求链：IPC -> ProcessMoveRequest -> DesktopIcons::Move
+	// @note 校验请求、按名称查找索引、换算坐标、写日志都在本线程上完成，界面线程上只执行 SetItemPosition
+	// @note 按 sliceBudget 分片，每片最多 MAX_BATCH_ICONS 个图标，通过 RunBatch 一次交给界面线程，片与片之间让出
+	// @note 每片结束后更新一次进度；每片开始前检查取消标志，取消时已移动的图标保持在新位置
+	void ProcessMoveRequest(SharedData* sharedMemView, bool is_rate = false) {
+		logMessage.log(L"准备移动 " + to_wstring(sharedMemView->size) + L" 个图标");
+		const int size = max(sharedMemView->size, 0);
+
+		DesktopBackend* desktop = this->GetDesktop();
+		if (desktop == nullptr) {
+			(sharedMemView->errorNumber) += sharedMemView->size;
+			wcscpy_s(sharedMemView->errorMessage, L"找不到桌面列表视图");
+			logMessage.log(L"找不到桌面列表视图");
+			return;
+		}
+		this->progressTotal = size;
+		SliceScheduler scheduler(sharedMemView->sliceBudget);
+		const unsigned long long savedBefore = desktop->GetSavedThreadSwitches();
+		DesktopIcons icons(desktop);
+
+		IconIndex index;
+		if (!this->BuildIconIndex(desktop, icons, index, scheduler)) {
+			sharedMemView->errorNumber += size;
+			this->progressErrors = static_cast<int>(sharedMemView->errorNumber);
+			this->ReportAborted(sharedMemView, desktop, 0, size, L"移动");
+			return;
 		}
 
-		// 备用方法（针对特殊桌面配置）
-		HWND hProgman = FindWindow(L"Progman", L"Program Manager");
-		if (hProgman) {
-			// 尝试通过Progman直接查找桌面窗口
-			HWND hDesktop = FindWindowEx(hProgman, nullptr, L"SHELLDLL_DefView", nullptr);
-			if (!hDesktop) {
-				// 尝试桌面子窗口
-				hDesktop = FindWindowEx(hProgman, nullptr, nullptr, L"FolderView");
+		// 解析请求：不合法或找不到的项计为错误，不进入界面线程
+		vector<IconMove> moves;
+		vector<int> entries; // moves[k] 对应的请求项
+		moves.reserve(size);
+		entries.reserve(size);
+		for (int i = 0; i < size; ++i) {
+			const IconPositionMove& entry = sharedMemView->iconPositionMove[i];
+			if (!IsValidMoveEntry(entry)) {
+				++(sharedMemView->errorNumber);
+				logMessage.log(L"请求内容不合法: " + wstring(entry.targetName) + L" " + to_wstring(entry.p.x) + L" " + to_wstring(entry.p.y));
+				continue;
 			}
-			if (hDesktop) {
-				HWND hList = FindWindowEx(hDesktop, nullptr, L"SysListView32", nullptr);
-				if (hList && IsWindowVisible(hList)) {
-					logMessage.log(L"通过Progman找到桌面ListView窗口");
-					return hList;
-				}
+			const int found = index.Find(entry.targetName);
+			if (found == -1) {
+				++(sharedMemView->errorNumber);
+				swprintf_s(sharedMemView->errorMessage, L"找不到图标: %s", entry.targetName);
+				logMessage.log(L"找不到图标: " + wstring(entry.targetName));
+				continue;
 			}
+			moves.push_back({ found, icons.ToDevicePoint(entry.p.x, entry.p.y, is_rate) });
+			entries.push_back(i);
 		}
+		const int skipped = size - static_cast<int>(moves.size());
+
+		// 移动
+		vector<size_t> failed;
+		const size_t done = icons.Move(moves, scheduler, failed, [this] {
+			return this->cancelRequested.load();
+		}, [&](size_t moved) {
+			this->progressDone = skipped + static_cast<int>(moved);
+			this->progressErrors = static_cast<int>(sharedMemView->errorNumber + failed.size());
+		});
+		for (size_t k : failed) {
+			++(sharedMemView->errorNumber);
+			wcscpy_s(sharedMemView->errorMessage, L"移动图标失败");
+			logMessage.log(L"移动图标失败: " + wstring(sharedMemView->iconPositionMove[entries[k]].targetName));
+		}
+		if (done < moves.size()) {
+			sharedMemView->errorNumber += moves.size() - done;
+			this->ReportAborted(sharedMemView, desktop, skipped + static_cast<int>(done), size, L"移动");
+		}
+		this->progressErrors = static_cast<int>(sharedMemView->errorNumber);
+
+		scheduler.finish();
+		sharedMemView->sliceCount = static_cast<uint32_t>(scheduler.sliceCount());
+		sharedMemView->maxSliceMicroseconds = scheduler.maxSliceMicroseconds();
+		logMessage.log(L"移动 " + to_wstring(done - failed.size()) + L" / " + to_wstring(size) + L" 个图标，时间片: " +
+			scheduler.summary() + L"，省下 " + to_wstring(desktop->GetSavedThreadSwitches() - savedBefore) +
+			L" 次跨线程调用，单条消息最长 " + to_wstring(desktop->GetMaxCallMicroseconds()) + L" us");
+	}
 
-		// 枚举所有窗口
-		logMessage.log(L"尝试枚举所有窗口查找桌面ListView");
-		HWND hDesktop = GetDesktopWindow();
-		HWND hChild = GetWindow(hDesktop, GW_CHILD);
-		while (hChild) {
-			wchar_t className[256];
-			GetClassName(hChild, className, 256);
-
-			if (wcscmp(className, L"SysListView32") == 0) {
-				wchar_t windowText[256];
-				GetWindowText(hChild, windowText, 256);
+	// @brief 读取全部图标名称并建立名称索引
+	// @param points 输出：同时读取的图标坐标，为 nullptr 时不读
+	// @ret 是否读完；界面线程无响应或被取消时返回 false
+	bool BuildIconIndex(DesktopBackend* desktop, DesktopIcons& icons, IconIndex& index, SliceScheduler& scheduler, vector<DesktopPoint>* points = nullptr) {
+		vector<wstring> names;
+		if (!icons.Read(desktop->GetItemCount(), &names, points, scheduler, [this] { return this->cancelRequested.load(); }))
+			return false;
+		if (names.empty()) logMessage.log(L"ListView中没有图标");
+		index.Build(names);
+		return true;
+	}
 
-				if (wcscmp(windowText, L"FolderView") == 0) {
-					logMessage.log(L"通过枚举找到桌面ListView窗口");
-					return hChild;
-				}
-			}
-			hChild = GetWindow(hChild, GW_HWNDNEXT);
+	// @brief 命令中途停止：界面线程无响应或被取消
+	// @param finished 已完成的项数
+	// @param what 操作名称（用于日志）
+	void ReportAborted(SharedData* sharedMemView, DesktopBackend* desktop, int finished, int size, const wchar_t* what) {
+		if (desktop->IsHung()) {
+			swprintf_s(sharedMemView->errorMessage, L"%s（完成 %d / %d 个）", desktop->GetHangReport().c_str(), finished, size);
+			logMessage.log(wstring(what) + L"中止：完成 " + to_wstring(finished) + L" / " + to_wstring(size) + L" 个");
 		}
+		else {
+			swprintf_s(sharedMemView->errorMessage, L"已取消：完成 %d / %d 个", finished, size);
+			logMessage.log(wstring(what) + L"已取消：完成 " + to_wstring(finished) + L" / " + to_wstring(size) + L" 个");
+		}
+	}
 
-		logMessage.log(L"无法找到桌面ListView窗口");
-		return nullptr;
+	// @brief 移动请求中的一项是否合法
+	static bool IsValidMoveEntry(const IconPositionMove& entry) {
+		return entry.targetName[0] != L'\0'
+			&& entry.p.x >= 0 && entry.p.y >= 0
+			&& entry.p.x < INT_MAX && entry.p.y < INT_MAX;
 	}
 
-	// @brief 查找桌面 ListView
-	HWND GetHListView() {
-		// 查找桌面列表视图
-		HWND hListView = FindDesktopListView();
-		if (!hListView) {
-			logMessage.log(L"找不到桌面ListView窗口");
-			return nullptr;
+	// @struct AnimationTrack
+	// @brief 一个图标的动画轨迹（设备像素）
+	struct AnimationTrack {
+		int index;
+		DesktopPoint from;
+		DesktopPoint to;
+	};
+
+	// @brief 处理平滑移动请求 CommandID = COMMAND_ANIMATE
+	// @note 请求链：IPC -> ProcessAnimateRequest -> Animator
+	// @note 起点为图标的当前位置；每帧把所有图标作为一批交给界面线程，一帧只切换一次线程、只重绘一次
+	// @note 取消或 explorer 无响应时停在当前帧，未到达终点的图标计为错误
+	void ProcessAnimateRequest(SharedData* sharedMemView) {
+		const int size = sharedMemView->size;
+		const AnimationParams params = sharedMemView->animation;
+		const bool is_rate = params.byRate != 0;
+		logMessage.log(L"准备平滑移动 " + to_wstring(size) + L" 个图标，时长 " + to_wstring(params.duration) +
+			L" ms，目标 " + to_wstring(params.framesPerSecond) + L" 帧/秒");
+
+		DesktopBackend* desktop = this->GetDesktop();
+		if (desktop == nullptr) {
+			(sharedMemView->errorNumber) += size;
+			wcscpy_s(sharedMemView->errorMessage, L"找不到桌面列表视图");
+			logMessage.log(L"找不到桌面列表视图");
+			return;
 		}
 
-		// 获取 ListView 信息
-		wchar_t className[256];
-		GetClassName(hListView, className, 256);
-		DWORD pid = 0;
-		GetWindowThreadProcessId(hListView, &pid);
-
-		logMessage.log(L"ListView 类名: " + wstring(className));
-		logMessage.log(L"ListView 进程ID: " + to_wstring(pid));
+		// 确定每个图标的起点与终点：按片读取名称与当前位置，查找在本线程上进行
+		DesktopIcons icons(desktop);
+		SliceScheduler scheduler(sharedMemView->sliceBudget);
+		IconIndex index;
+		vector<DesktopPoint> points;
+		if (!this->BuildIconIndex(desktop, icons, index, scheduler, &points)) {
+			sharedMemView->errorNumber += max(size, 0);
+			this->ReportAborted(sharedMemView, desktop, 0, size, L"动画");
+			return;
+		}
+		vector<AnimationTrack> tracks;
+		tracks.reserve(max(size, 0));
+		for (int i = 0; i < size; ++i) {
+			const IconPositionMove& entry = sharedMemView->iconPositionMove[i];
+			const int found = IsValidMoveEntry(entry) ? index.Find(entry.targetName) : -1;
+			if (found == -1) {
+				++(sharedMemView->errorNumber);
+				swprintf_s(sharedMemView->errorMessage, L"找不到图标: %s", entry.targetName);
+				continue;
+			}
+			tracks.push_back({ found, points[found], icons.ToDevicePoint(entry.p.x, entry.p.y, is_rate) });
+		}
 
-		return hListView;
+		Animator animator(params.duration, params.framesPerSecond, params.easing);
+		this->progressTotal = static_cast<int>(animator.plannedFrames());
+		int failed = 0; // 最近一帧移动失败的图标数
+		const bool finished = animator.play([&](RatioQ16 progress) {
+			failed = 0;
+			desktop->RunBatch([&] {
+				for (const AnimationTrack& track : tracks) {
+					const DesktopPoint point = { interpolate(track.from.x, track.to.x, progress), interpolate(track.from.y, track.to.y, progress) };
+					if (!desktop->SetItemPosition(track.index, point)) ++failed;
+				}
+			});
+			this->progressDone = static_cast<int>(animator.framesRendered()) + 1;
+		}, [&] {
+			return this->cancelRequested || desktop->IsHung();
+		});
+
+		if (!finished) {
+			sharedMemView->errorNumber += tracks.size();
+			if (desktop->IsHung()) swprintf_s(sharedMemView->errorMessage, L"%s", desktop->GetHangReport().c_str());
+			else wcscpy_s(sharedMemView->errorMessage, L"已取消");
+		}
+		else if (failed) {
+			sharedMemView->errorNumber += failed;
+			wcscpy_s(sharedMemView->errorMessage, L"移动图标失败");
+		}
+		this->progressErrors = static_cast<int>(sharedMemView->errorNumber);
+		sharedMemView->framesRendered = animator.framesRendered();
+		sharedMemView->framesDropped = animator.framesDropped();
+		logMessage.log(L"动画: " + to_wstring(tracks.size()) + L" 个图标，" + animator.summary());
 	}
 
-	// @brief 获取缓存中的 桌面 ListView
-	// @warning 有可能失效
-	HWND GetLocalHListView()
-	{
-		if (!this->m_hListView) return this->m_hListView;
-
-		this->m_hListView = this->GetHListView();
-		return this->m_hListView;
+	// @brief 处理获取所有桌面图标请求
+	// @note 请求链：IPC -> ProcessGetAllIconsRequest -> GetAllIcons
+	bool ProcessGetAllIconsRequest(SharedData* sharedMemView) {
+		DesktopBackend* desktop = this->GetDesktop();
+		if (desktop == nullptr) {
+			(sharedMemView->errorNumber) += sharedMemView->size;
+			wcscpy_s(sharedMemView->errorMessage, L"找不到桌面列表视图");
+			return false;
+		}
+		const EnumerationSnapshot* icons = this->BeginEnumerationPage(desktop, sharedMemView);
+		if (icons == nullptr) {
+			sharedMemView->size = 0;
+			return false;
+		}
+		sharedMemView->size = GetAllIcons(*icons, sharedMemView->iconPositionMove, sharedMemView->u_batchIndex, sharedMemView->size);
+		return true;
 	}
 
-	// @brief 获取桌面图标的显示名称 By 索引
-	// @param hListView 桌面窗口句柄
-	// @param index 图标索引
-	// @ret 图标显示名称，失败返回空字符串
-	wstring GetIconDisplayName(HWND hListView, int index) {
-		wchar_t buffer[256] = { 0 };
-		LVITEM lvi = { 0 };
-		lvi.iItem = index;
-		lvi.mask = LVIF_TEXT;
-		lvi.pszText = buffer;
-		lvi.cchTextMax = 256;
+	// @brief 处理获取图标位置请求（只回传坐标与名称散列）
+	// @note 请求链：IPC -> ProcessGetPositionsRequest
+	// @note u_batchIndex 为起始索引，一次最多 MAX_POSITION_COUNT 个
+	bool ProcessGetPositionsRequest(SharedData* sharedMemView) {
+		DesktopBackend* desktop = this->GetDesktop();
+		if (desktop == nullptr) {
+			++sharedMemView->errorNumber;
+			wcscpy_s(sharedMemView->errorMessage, L"找不到桌面列表视图");
+			return false;
+		}
 
-		if (ListView_GetItem(hListView, &lvi)) {
-			return wstring(buffer);
+		const EnumerationSnapshot* icons = this->BeginEnumerationPage(desktop, sharedMemView);
+		if (icons == nullptr) {
+			sharedMemView->size = 0;
+			return false;
+		}
+
+		const size_t count = icons->names.size();
+		const size_t start = sharedMemView->u_batchIndex == SIZE_MAX ? 0 : sharedMemView->u_batchIndex;
+		const int localSize = start < count
+			? static_cast<int>(min(count - start, static_cast<size_t>(MAX_POSITION_COUNT)))
+			: 0;
+
+		IconPositionHash* positions = positionsOf(sharedMemView);
+		for (int i = 0; i < localSize; ++i) {
+			const wstring& name = icons->names[start + i];
+			const DesktopPoint& point = icons->points[start + i];
+			positions[i] = { static_cast<int32_t>(point.x), static_cast<int32_t>(point.y), hashName(name.c_str(), name.size()) };
 		}
 
-		return L"";
+		sharedMemView->size = localSize;
+		logMessage.log(L"获取图标位置: " + to_wstring(localSize) + L" 个");
+		return true;
 	}
 
-	// @brief 查找图标索引 By 名称
-	// @param hListView 桌面窗口句柄
-	// @param target 图标显示名称
-	// @note 本函数执行三种匹配方式：
-	//			1. 精确匹配
-	//			2. 不区分大小写匹配
-	//			3. 部分匹配（忽略后缀）
-	int FindItemIndex(HWND hListView, const wchar_t* target) {
-		if (!hListView) return -1;
-
-		int count = ListView_GetItemCount(hListView);
-		if (count == 0) {
-			logMessage.log(L"ListView中没有图标");
-			return -1;
+	// @brief 处理布局指纹请求
+	// @note 请求链：IPC -> ProcessGetFingerprintRequest
+	// @note 只统计名称为 0 ~ size-1 的占位图标，每个编号只取第一个；量化网格与 ToDevicePoint 相同，
+	//			并按默认容差分格（见 common/fingerprint.h），客户端按同一网格计算文件的指纹，两者逐位可比
+	bool ProcessGetFingerprintRequest(SharedData* sharedMemView) {
+		DesktopBackend* desktop = this->GetDesktop();
+		if (desktop == nullptr) {
+			++sharedMemView->errorNumber;
+			wcscpy_s(sharedMemView->errorMessage, L"找不到桌面列表视图");
+			return false;
 		}
 
-		wstring targetName(target);
-		logMessage.log(L"查找图标: " + targetName);
+		DesktopIcons icons(desktop);
+		LayoutFingerprint& fingerprint = sharedMemView->fingerprint;
+		fingerprint.screenWidth = icons.GetScreenSize().x;
+		fingerprint.screenHeight = icons.GetScreenSize().y;
+		fingerprint.dpi = icons.GetDpi();
+		fingerprint.quantum = fingerprintQuantum(fingerprint.dpi);
 
-		// 首先尝试精确匹配
-		for (int i = 0; i < count; ++i) {
-			wstring name = this->GetIconDisplayName(hListView, i);
-			if (name == target) {
-				logMessage.log(L"精确匹配找到图标: " + name + L" 索引: " + to_wstring(i));
-				return i;
-			}
+		const int size = max(sharedMemView->size, 0);
+		unordered_map<uint32_t, int> placeholders;
+		placeholders.reserve(size);
+		for (int i = 0; i < size; ++i) {
+			const wstring name = to_wstring(i);
+			placeholders.emplace(hashName(name.c_str(), name.size()), i);
 		}
 
-		// 然后尝试不区分大小写匹配
-		for (int i = 0; i < count; ++i) {
-			wstring name = this->GetIconDisplayName(hListView, i);
-			if (_wcsicmp(name.c_str(), target) == 0) {
-				logMessage.log(L"不区分大小写匹配找到图标: " + name + L" 索引: " + to_wstring(i));
-				return i;
-			}
+		// 按片读取名称与坐标，散列与统计在本线程上进行
+		vector<wstring> names;
+		vector<DesktopPoint> points;
+		SliceScheduler scheduler(sharedMemView->sliceBudget);
+		if (!icons.Read(desktop->GetItemCount(), &names, &points, scheduler)) {
+			++sharedMemView->errorNumber;
+			swprintf_s(sharedMemView->errorMessage, L"%s", desktop->GetHangReport().c_str());
+			return false;
+		}
+		vector<bool> seen(size, false);
+		for (size_t i = 0; i < names.size(); ++i) {
+			auto found = placeholders.find(hashName(names[i].c_str(), names[i].size()));
+			if (found == placeholders.end() || seen[found->second]) continue;
+			seen[found->second] = true;
+			fingerprint.add(found->first, points[i].x, points[i].y);
 		}
 
-		// 最后尝试部分匹配（忽略后缀）
-		for (int i = 0; i < count; ++i) {
-			wstring name = this->GetIconDisplayName(hListView, i);
-
-			// 移除可能的.lnk后缀
-			wstring cleanName = name;
-			if (cleanName.size() > 4 && cleanName.substr(cleanName.size() - 4) == L".lnk") {
-				cleanName = cleanName.substr(0, cleanName.size() - 4);
-			}
+		logMessage.log(L"布局指纹: " + to_wstring(fingerprint.count) + L" / " + to_wstring(size) + L" 个占位图标");
+		return true;
+	}
 
-			if (_wcsicmp(cleanName.c_str(), target) == 0) {
-				logMessage.log(L"部分匹配找到图标: " + name + L" 索引: " + to_wstring(i));
-				return i;
-			}
+	// @brief 启动控制通道线程
+	// @ret 是否成功
+	bool StartControlLane() {
+		this->controlMapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(ControlData), CONTROL_MEM_NAME);
+		if (!this->controlMapping) return false;
+		this->controlView = reinterpret_cast<ControlData*>(MapViewOfFile(this->controlMapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(ControlData)));
+		this->controlCmdEvent = CreateEventW(NULL, FALSE, FALSE, CONTROL_CMD_EVENT_NAME);
+		this->controlRspEvent = CreateEventW(NULL, FALSE, FALSE, CONTROL_RSP_EVENT_NAME);
+		this->controlStopEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+		if (!this->controlView || !this->controlCmdEvent || !this->controlRspEvent || !this->controlStopEvent) {
+			this->StopControlLane();
+			return false;
 		}
 
-		logMessage.log(L"未找到匹配的图标");
-		return -1;
+		this->controlThread = CreateThread(nullptr, 0, [](LPVOID self) -> DWORD {
+			static_cast<DLL_Mover*>(self)->ControlLoop();
+			return 0;
+			}, this, 0, nullptr);
+		if (!this->controlThread) {
+			this->StopControlLane();
+			return false;
+		}
+		logMessage.log(L"控制通道已启动");
+		return true;
 	}
 
-	// @brief 获取桌面图标的实际位置 By 索引
-	POINT GetIconPosition(HWND hListView, int index) {
-		POINT pt = { 0 };
-		if (hListView && index >= 0) {
-			ListView_GetItemPosition(hListView, index, &pt);
+	// @brief 停止控制通道线程并释放资源
+	// @note 卸载 DLL 之前必须调用，否则线程会在已卸载的代码中醒来
+	void StopControlLane() {
+		if (this->controlThread) {
+			SetEvent(this->controlStopEvent);
+			WaitForSingleObject(this->controlThread, INFINITE);
+			CloseHandle(this->controlThread);
+			this->controlThread = nullptr;
+		}
+		if (this->controlView) {
+			UnmapViewOfFile(this->controlView);
+			this->controlView = nullptr;
+		}
+		for (HANDLE* handle : { &this->controlMapping, &this->controlCmdEvent, &this->controlRspEvent, &this->controlStopEvent }) {
+			if (*handle) CloseHandle(*handle);
+			*handle = nullptr;
 		}
-		return pt;
 	}
 
-	// @brief 处理移动请求 CommandID = COMMAND_MOVE_ICON_BY_RATE or COMMAND_MOVE_ICON
-	// @note 请求链：IPC -> ProcessMoveRequest -> MoveDesktopIcon
-	void ProcessMoveRequest(SharedData* sharedMemView, bool is_rate = false) {
-		logMessage.log(L"准备移动 " + to_wstring(sharedMemView->size) + L" 个图标");
-		int size = sharedMemView->size;
+	// @brief 控制通道循环：收到命令 -> 处理 -> 响应
+	// @note 客户端持有控制通道互斥锁时才会发命令，所以不需要主通道的“就绪”握手
+	// @note 不访问桌面、不写日志，主通道正忙时也能立即响应
+	void ControlLoop() {
+		const HANDLE handles[] = { this->controlStopEvent, this->controlCmdEvent };
+		while (true) {
+			if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0 + 1)
+				return; // 停止或出错
 
-		HWND hListView = GetLocalHListView();
-		if (hListView == nullptr) {
-			(sharedMemView->errorNumber) += sharedMemView->size;
-			wcscpy_s(sharedMemView->errorMessage, L"找不到桌面列表视图");
-			logMessage.log(L"找不到桌面列表视图");
+			ControlData* control = this->controlView;
+			control->errorNumber = 0;
+			switch (control->command) {
+			case CommandID::COMMAND_IS_OK:
+				break;
+			case CommandID::COMMAND_CANCEL:
+				this->cancelRequested = true;
+				break;
+			default:
+				++control->errorNumber;
+				break;
+			}
+			control->activeCommand = this->activeCommand;
+			control->activeSinceTick = this->activeSinceTick;
+			control->progressDone = this->progressDone;
+			control->progressTotal = this->progressTotal;
+			control->progressErrors = this->progressErrors;
+			control->uiHung = this->backend && this->backend->IsHung() ? 1 : 0;
+			SetEvent(this->controlRspEvent);
+		}
+	}
+
+	// @brief 桌面有变化时重新发布桌面状态
+	// @note 先读到临时缓冲区，与已发布的数据相同时只更新 updateTick，读者不会因为空闲刷新而重试
+	// @note 界面线程无响应时不发布：updateTick 停止前进，客户端会认为状态失效而改用命令查询；
+	//			空闲刷新不重置看门狗，下一条命令重新判定之前都不再访问界面线程
+	// @note 按 DESKTOP_STATE_SLICE_BUDGET 分批读取，散列在本线程计算
+	void PublishDesktopState() {
+		DesktopState* state = this->desktopState;
+		DesktopBackend* desktop = this->GetDesktop();
+		this->stateDirty = false;
+		if (state == nullptr || desktop == nullptr || desktop->IsHung()) return;
+
+		const int count = max(desktop->GetItemCount(), 0);
+		const int stored = min(count, MAX_STATE_ICON_COUNT);
+		vector<wstring> names;
+		vector<DesktopPoint> points;
+		SliceScheduler scheduler(DESKTOP_STATE_SLICE_BUDGET);
+		if (!DesktopIcons(desktop).Read(stored, &names, &points, scheduler)) return;
+		this->stateBuffer.resize(stored);
+		for (int i = 0; i < stored; ++i)
+			this->stateBuffer[i] = { static_cast<int32_t>(points[i].x), static_cast<int32_t>(points[i].y), hashName(names[i].c_str(), names[i].size()) };
+
+		if (state->sequence != 0 && state->count == count && state->stored == stored &&
+			memcmp(state->positions, this->stateBuffer.data(), stored * sizeof(IconPositionHash)) == 0) {
+			state->updateTick = GetTickCount64(); // 没有变化，只表明状态仍然有效
 			return;
 		}
-		for (int i = 0; i < size; ++i) {
-			logMessage.log(L"处理移动请求");
-			//logMessage.log(L"目标图标: " + wstring(sharedMemView->iconPositionMove[i].targetName));
-			logMessage.log(L"目标位置: (" + to_wstring(sharedMemView->iconPositionMove[i].p.x) + L", " +
-				to_wstring(sharedMemView->iconPositionMove[i].p.y) + L")");
-			
-			if (sharedMemView->iconPositionMove[i].targetName[0] == '\0'
-				|| sharedMemView->iconPositionMove[i].p.x < 0
-				|| sharedMemView->iconPositionMove[i].p.y < 0
-				|| sharedMemView->iconPositionMove[i].p.x >= INT_MAX
-				|| sharedMemView->iconPositionMove[i].p.y >= INT_MAX) {
-				++(sharedMemView->errorNumber);
-				logMessage.log(L"请求内容不合法");
-				logMessage.log(wstring(sharedMemView->iconPositionMove[i].targetName) + L" " + to_wstring(sharedMemView->iconPositionMove[i].p.x) + L" " + to_wstring(sharedMemView->iconPositionMove[i].p.y));
-				continue;
-			}
 
-			// 查找图标索引
-			int index = FindItemIndex(hListView, sharedMemView->iconPositionMove[i].targetName);
-			if (index == -1) {
-				logMessage.log(L"找不到目标图标");
-				++(sharedMemView->errorNumber);
-				swprintf_s(sharedMemView->errorMessage, L"找不到图标: %s", sharedMemView->iconPositionMove[i].targetName);
+		publishDesktopState(state, [&](DesktopState* s) {
+			s->agentProcessId = GetCurrentProcessId();
+			s->count = count;
+			s->stored = stored;
+			memcpy(s->positions, this->stateBuffer.data(), stored * sizeof(IconPositionHash));
+		});
+		logMessage.log(L"桌面状态已更新: " + to_wstring(count) + L" 个图标");
+	}
+
+	// @brief 应用帧流中最新的一帧
+	// @note 在主通道线程上执行，与命令串行；查找与坐标换算在本线程完成，
+	//			只有 SetItemPosition 通过 DesktopIcons::Move 按批（每批最多 MAX_BATCH_ICONS 个，不超过时间片预算）交给界面线程
+	// @note 按名称散列找到图标；与上次应用到该图标的位置相同时跳过，静止的图标不产生 ListView 调用
+	// @note 图标数量变化或有图标找不到时重建散列表（找不到时最多每 DESKTOP_STATE_REFRESH 重建一次）
+	void ApplyStreamFrame() {
+		FrameStreamRegion* stream = this->frameStream;
+		DesktopBackend* desktop = this->GetDesktop();
+		if (stream == nullptr || !acquireStreamFrame(stream, this->streamFront) || desktop == nullptr) return;
+
+		const StreamFrame& frame = stream->frames[this->streamFront];
+		const int count = max(0, min<int>(frame.count, MAX_STREAM_ICON_COUNT));
+		desktop->ResetWatchdog();
+		const int items = desktop->GetItemCount();
+		const bool rebuild = items != this->streamItemCount
+			|| (this->streamMisses && GetTickCount64() - this->streamIndexTick >= DESKTOP_STATE_REFRESH);
+
+		// 重建散列表时按批读取名称，不与帧放在同一批
+		DesktopIcons icons(desktop);
+		if (rebuild) {
+			vector<wstring> names;
+			SliceScheduler scheduler(0);
+			icons.Read(items, &names, nullptr, scheduler);
+			this->streamIndex.clear();
+			this->streamIndex.reserve(names.size());
+			for (size_t i = 0; i < names.size(); ++i)
+				this->streamIndex.emplace(hashName(names[i].c_str(), names[i].size()), static_cast<int>(i));
+			this->streamApplied.assign(max(items, 0), { LONG_MIN, LONG_MIN });
+			this->streamItemCount = items;
+			this->streamIndexTick = GetTickCount64();
+		}
+
+		this->streamMisses = 0;
+		this->streamMoves.clear();
+		for (int i = 0; i < count; ++i) {
+			const IconPositionHash& icon = frame.positions[i];
+			auto found = this->streamIndex.find(icon.nameHash);
+			if (found == this->streamIndex.end()) {
+				++this->streamMisses;
 				continue;
 			}
+			const int index = found->second;
+			const DesktopPoint target = icons.ToDevicePoint(icon.x, icon.y, frame.byRate != 0);
+			const DesktopPoint& applied = this->streamApplied[index];
+			if (applied.x != target.x || applied.y != target.y) this->streamMoves.push_back({ index, target });
+		}
 
-			logMessage.log(L"找到图标索引: " + to_wstring(index));
-
-			// 移动图标
-			wstring result = this->MoveDesktopIcon(hListView, index, sharedMemView->iconPositionMove[i].p.x, sharedMemView->iconPositionMove[i].p.y, is_rate);
-			if (result != L"SUCCESS") {
-				++(sharedMemView->errorNumber);
-				logMessage.log(L"移动图标失败");
-				wcscpy_s(sharedMemView->errorMessage, L"移动图标失败");
+		this->streamFailed.clear();
+		SliceScheduler scheduler(this->streamSliceBudget);
+		const size_t done = icons.Move(this->streamMoves, scheduler, this->streamFailed);
+		int moved = 0;
+		for (size_t i = 0, f = 0; i < done; ++i) {
+			if (f < this->streamFailed.size() && this->streamFailed[f] == i) {
+				++f;
 				continue;
 			}
+			this->streamApplied[this->streamMoves[i].index] = this->streamMoves[i].point;
+			++moved;
 		}
-	}
 
-	// @brief 处理获取所有桌面图标请求
-	// @note 请求链：IPC -> ProcessGetAllIconsRequest -> GetAllIcons
-	bool ProcessGetAllIconsRequest(SharedData* sharedMemView) {
-		HWND hListView = GetLocalHListView();
-		if (hListView == nullptr) {
-			(sharedMemView->errorNumber) += sharedMemView->size;
-			wcscpy_s(sharedMemView->errorMessage, L"找不到桌面列表视图");
-			return false;
+		const LONGLONG latency = streamClockMicroseconds() - frame.submitMicroseconds;
+		stream->lastLatencyMicroseconds = latency;
+		if (latency > stream->maxLatencyMicroseconds) stream->maxLatencyMicroseconds = latency;
+		InterlockedExchange64(&stream->lastAppliedSequence, frame.sequence);
+		InterlockedIncrement64(&stream->applied);
+		SetEvent(this->streamAppliedEvent);
+		if (moved) this->stateDirty = true;
+		if (desktop->IsHung()) {
+			this->streamItemCount = -1;
+			logMessage.log(L"帧 " + to_wstring(frame.sequence) + L" 中止: " + desktop->GetHangReport());
 		}
-		sharedMemView->size = GetAllIcons(hListView, sharedMemView->iconPositionMove, sharedMemView->u_batchIndex, sharedMemView->size);
-		return true;
 	}
 
 	// @brief 处理获取桌面图标数量请求
 	// @note 请求链：IPC -> ProcessGetIconNumberRequest -> GetIconsNumber
 	bool ProcessGetIconNumberRequest(SharedData* sharedMemView) {
-		HWND hListView = GetLocalHListView();
-		if (hListView == nullptr)
+		DesktopBackend* desktop = this->GetDesktop();
+		if (desktop == nullptr)
 			return false;
-		int count = GetIconsNumber(hListView);
+		int count = GetIconsNumber(desktop);
 		logMessage.log(L"桌面图标数量: " + to_wstring(count));
 		if (count <= 0)
 			return false;
@@ -569,25 +952,19 @@ private:
 
 	// @brief 关闭桌面自动排序
 	bool DisableAutoArrange() {
-		HWND hListView = this->GetLocalHListView();
-		if (!hListView) {
+		DesktopBackend* desktop = this->GetDesktop();
+		if (!desktop) {
 			logMessage.log(L"无效的列表视图句柄");
 			return false;
 		}
 		// 获取当前窗口样式
-		LONG_PTR style = GetWindowLongPtr(hListView, GWL_STYLE);
-		if (!style) {
-			logMessage.log(L"获取窗口样式失败");
-			return false;
-		}
+		uint32_t style = 0;
+		if (!desktop->GetStyle(style)) return false;
 
 		// 移除LVS_AUTOARRANGE样式 (0x0100)
-		style &= ~LVS_AUTOARRANGE;
+		style &= ~DESKTOP_STYLE_AUTOARRANGE;
 		// 设置新样式
-		if (!SetWindowLongPtr(hListView, GWL_STYLE, style)) {
-			logMessage.log(L"设置窗口样式失败");
-			return false;
-		}
+		if (!desktop->SetStyle(style)) return false;
 		logMessage.log(L"已禁用桌面自动排序");
 		return true;
 	}
@@ -633,67 +1010,63 @@ private:
 		return a();
 	}
 
-	// @brief 移动图标函数 By 索引
-	// @param hListView 桌面窗口句柄
-	// @param index 图标索引
-	// @param x 目标X坐标
-	// @param y 目标Y坐标
-	// @param is_rate 是否按比例移动，默认 false
-	// @ret 移动结果，"SUCCESS" 表示成功，其他表示失败
-	const wstring MoveDesktopIcon(HWND hListView, int index, int x, int y, bool is_rate = false) {
-		if (!hListView || index < 0) {
-			logMessage.log(L"无效的列表视图或索引");
-			return L"无效的列表视图或索引";
-		}
-		if (is_rate)
-		{
-			const int cx = GetSystemMetrics(SM_CXSCREEN);
-			const int cy = GetSystemMetrics(SM_CYSCREEN);
-			x = static_cast<int>(cx * (static_cast<double>(x) / 1000));
-			y = static_cast<int>(cy * (static_cast<double>(y) / 1000));
+	// @brief 开始或继续一次分页枚举
+	// @param sharedMemView 请求：u_batchIndex 为起始索引，generation 为客户端持有的快照代号
+	// @ret 本次枚举使用的快照；抓取失败或客户端的代号已经过期时返回 nullptr
+	// @note u_batchIndex 为 0（或 generation 为 0）时重新抓取快照，之后的分页都从同一份快照读取
+	// @note 响应中总会带上当前快照的 generation 与 totalCount
+	// @note 代号过期不算错误（errorNumber 保持 0）：客户端看到 generation 变化后从头开始
+	const EnumerationSnapshot* BeginEnumerationPage(DesktopBackend* desktop, SharedData* sharedMemView) {
+		const size_t start = sharedMemView->u_batchIndex;
+		const uint32_t requested = sharedMemView->generation;
+		const bool fresh = start == 0 || start == SIZE_MAX || requested == 0;
+		if (fresh && !this->CaptureEnumerationSnapshot(desktop, sharedMemView->sliceBudget)) {
+			sharedMemView->generation = 0;
+			sharedMemView->totalCount = -1;
+			++sharedMemView->errorNumber;
+			swprintf_s(sharedMemView->errorMessage, L"%s", desktop->GetHangReport().c_str());
+			return nullptr;
 		}
 
-		// 获取当前DPI缩放比例
-		UINT dpi = GetDpiForWindow(hListView);
-		float scale = dpi / 96.0f;
-
-		// 应用缩放
-		int scaledX = static_cast<int>(x * scale);
-		int scaledY = static_cast<int>(y * scale);
-
-		logMessage.log(L"DPI缩放比例: " + to_wstring(scale));
-		logMessage.log(L"原始坐标: (" + to_wstring(x) + L", " + to_wstring(y) + L")");
-		logMessage.log(L"缩放后坐标: (" + to_wstring(scaledX) + L", " + to_wstring(scaledY) + L")");
-
-		// 获取当前图标位置
-		logMessage.log(L"原始位置: (" + to_wstring(this->GetIconPosition(hListView, index).x) + L", "
-			+ to_wstring(this->GetIconPosition(hListView, index).y) + L")");
-
-		// 移动图标
-		if (!ListView_SetItemPosition(hListView, index, scaledX, scaledY)) {
-			DWORD err = GetLastError();
-			logMessage.log(L"ListView_SetItemPosition 执行失败，错误代码: " + to_wstring(err));
-
-			return L"ListView_SetItemPosition 执行失败";
+		sharedMemView->generation = this->enumeration.generation;
+		sharedMemView->totalCount = static_cast<int>(this->enumeration.names.size());
+		if (!fresh && requested != this->enumeration.generation) {
+			logMessage.log(L"枚举快照已过期: 请求 " + to_wstring(requested) + L"，当前 " + to_wstring(this->enumeration.generation));
+			return nullptr;
 		}
+		return &this->enumeration;
+	}
 
-		logMessage.log(L"新位置: (" + to_wstring(this->GetIconPosition(hListView, index).x) + L", "
-			+ to_wstring(this->GetIconPosition(hListView, index).y) + L")");
+	// @brief 抓取所有图标的名称与坐标，并分配新的代号
+	// @param sliceBudget 时间片预算（微秒），按片交给界面线程
+	// @ret 是否完整抓取；界面线程无响应时返回 false，旧快照保持不变
+	bool CaptureEnumerationSnapshot(DesktopBackend* desktop, uint32_t sliceBudget) {
+		const int count = desktop->GetItemCount();
+		EnumerationSnapshot snapshot;
+		SliceScheduler scheduler(sliceBudget);
+		if (!DesktopIcons(desktop).Read(count, &snapshot.names, &snapshot.points, scheduler)) {
+			logMessage.log(L"枚举快照中止: " + desktop->GetHangReport());
+			return false;
+		}
+		this->enumeration.names.swap(snapshot.names);
+		this->enumeration.points.swap(snapshot.points);
 
-		logMessage.log(L"图标移动成功");
-		return L"SUCCESS";
+		// 0 保留给“尚未开始枚举”
+		if (++this->lastGeneration == 0) ++this->lastGeneration;
+		this->enumeration.generation = this->lastGeneration;
+		logMessage.log(L"枚举快照 " + to_wstring(this->enumeration.generation) + L": " + to_wstring(count) + L" 个图标");
+		return true;
 	}
 
-	// @brief 获取桌面所有图标信息
-	// @param hListView 桌面窗口句柄
+	// @brief 从枚举快照中取出一页图标信息
+	// @param icons 枚举快照
 	// @param IconPositionMove 图标位置信息数组，存储到这里
 	// @param j 起始索引
 	// @param size 本次最大查找数量（最大只能是 MAX_ICON_COUNT）
 	// @note IconPositionMove 数组大小必须大于等于 size
-	int GetAllIcons(HWND hListView, volatile IconPositionMove* IconPositionMove, size_t j, size_t maxSizeOnce = MAX_ICON_COUNT)
+	int GetAllIcons(const EnumerationSnapshot& icons, volatile IconPositionMove* IconPositionMove, size_t j, size_t maxSizeOnce = MAX_ICON_COUNT)
 	{
 		logMessage.log(L"获取桌面使用图标");
-		if (!hListView) return -1;
 
 		if (maxSizeOnce > MAX_ICON_COUNT)
 		{
@@ -701,33 +1074,104 @@ private:
 			return -1;
 		}
 
-		int count = ListView_GetItemCount(hListView); // 索引总数
+		const size_t count = icons.names.size(); // 索引总数
 		if (count == 0) {
 			logMessage.log(L"ListView中没有图标");
 			return -1;
 		}
+		if (j == SIZE_MAX) j = 0;
 
-		size_t localSize = min(maxSizeOnce, count - j); // 本次查找数量
+		size_t localSize = j < count ? min(maxSizeOnce, count - j) : 0; // 本次查找数量
 		for (size_t i = 0; i < localSize; ++i) { // 从 j 开始
-			wstring name = GetIconDisplayName(hListView, static_cast<int>(i + j));
-			POINT posi = GetIconPosition(hListView, static_cast<int>(i + j));
-			IconPositionMove[i].p.x = posi.x;
-			IconPositionMove[i].p.y = posi.y;
-			wsprintf((wchar_t*)IconPositionMove[i].targetName, L"%s", name.c_str());
+			IconPositionMove[i].p.x = icons.points[i + j].x;
+			IconPositionMove[i].p.y = icons.points[i + j].y;
+			wsprintf((wchar_t*)IconPositionMove[i].targetName, L"%s", icons.names[i + j].c_str());
 		}
 
 		return static_cast<int>(localSize);
 	}
 
 	// @brief 获取桌面图标数量
-	int GetIconsNumber(HWND hListView) {
-		if (!hListView) return 0;
-		return ListView_GetItemCount(hListView);
+	int GetIconsNumber(DesktopBackend* desktop) {
+		if (!desktop) return 0;
+		return desktop->GetItemCount();
 	}
 
 	// @var logMessage.log logMessage.log
 	// @brief 用于写入日志
 	LogMessage& logMessage;
 
-	HWND m_hListView;
+	// @var backend
+	// @brief 桌面后端，默认是 explorer 中的 SysListView32
+	unique_ptr<DesktopBackend> backend;
+
+	// @var enumeration
+	// @brief 当前分页枚举的快照
+	EnumerationSnapshot enumeration;
+
+	// @var desktopState
+	// @brief 桌面状态共享内存视图，创建失败时为 nullptr
+	DesktopState* desktopState = nullptr;
+
+	// @var stateReader
+	// @brief 读者心跳共享内存视图，创建失败时为 nullptr
+	DesktopStateReader* stateReader = nullptr;
+
+	// @var stateDirty
+	// @brief 执行过可能改变桌面的命令，桌面状态需要尽快更新
+	bool stateDirty = false;
+
+	// @var stateBuffer
+	// @brief 发布桌面状态前的临时缓冲区
+	vector<IconPositionHash> stateBuffer;
+
+	// @var frameStream streamReadyEvent streamAppliedEvent streamFront
+	// @brief 帧流共享内存、事件与 Agent 独占的缓冲区序号
+	FrameStreamRegion* frameStream = nullptr;
+	HANDLE streamReadyEvent = nullptr;
+	HANDLE streamAppliedEvent = nullptr;
+	LONG streamFront = 0;
+
+	// @var streamIndex streamApplied streamItemCount streamMisses streamIndexTick
+	// @brief 帧流：名称散列 -> 图标索引、每个图标上次应用的位置，以及重建散列表的依据
+	unordered_map<uint32_t, int> streamIndex;
+	vector<DesktopPoint> streamApplied;
+	int streamItemCount = -1;
+	int streamMisses = 0;
+	ULONGLONG streamIndexTick = 0;
+
+	// @var streamMoves streamFailed streamSliceBudget
+	// @brief 帧流：本帧需要移动的图标（复用容量）、移动失败的项，以及按批移动时的时间片预算
+	vector<IconMove> streamMoves;
+	vector<size_t> streamFailed;
+	uint32_t streamSliceBudget = 0;
+
+	// @var activeCommand activeSinceTick
+	// @brief 主通道正在执行的命令与开始时间，由控制通道报告
+	atomic<CommandID> activeCommand{ CommandID::COMMAND_INVALID };
+	atomic<ULONGLONG> activeSinceTick{ 0 };
+
+	// @var progressDone progressTotal progressErrors
+	// @brief 主通道当前命令的进度，由控制通道报告
+	atomic<int> progressDone{ 0 };
+	atomic<int> progressTotal{ 0 };
+	atomic<int> progressErrors{ 0 };
+
+	// @var cancelRequested
+	// @brief 控制通道收到取消请求，主通道在两个图标之间检查
+	atomic<bool> cancelRequested{ false };
+
+	// @var controlMapping controlView controlCmdEvent controlRspEvent controlStopEvent controlThread
+	// @brief 控制通道的共享内存、事件与线程
+	HANDLE controlMapping = nullptr;
+	ControlData* controlView = nullptr;
+	HANDLE controlCmdEvent = nullptr;
+	HANDLE controlRspEvent = nullptr;
+	HANDLE controlStopEvent = nullptr;
+	HANDLE controlThread = nullptr;
+
+	// @var lastGeneration
+	// @brief 最近分配的快照代号
+	// @note 以启动时间为种子，重新注入后的 Agent 不会沿用旧代号
+	uint32_t lastGeneration = GetTickCount();
 };
\ No newline at end of file
@@ -0,0 +1,202 @@
+﻿/**
+ * @file DesktopIcons.hpp
+ * @brief 按批读取、查找、移动桌面图标：只依赖 DesktopBackend 与标准库
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <thread>
+#include <cwctype>
+#include "backend/DesktopBackend.hpp"
+#include "tool/SliceScheduler.hpp"
+#include "common/fixedpoint.h"
+using namespace std;
+
+constexpr int MAX_BATCH_ICONS = 64;	// 每批交给界面线程的最多图标数，时间片预算为 0 时也按此分批
+
+// @enum IconMatch
+// @brief IconIndex::Find 的匹配方式
+enum class IconMatch : int {
+	MATCH_NONE = 0,				// 找不到
+	MATCH_EXACT = 1,			// 精确匹配
+	MATCH_CASE_INSENSITIVE = 2,	// 不区分大小写匹配
+	MATCH_PARTIAL = 3			// 部分匹配（忽略 .lnk 后缀）
+};
+
+// @class IconIndex
+// @brief 图标名称 -> 索引，一次建好，之后每次查找 O(1)
+// @note 依次尝试三种匹配方式，每种方式取索引最小的图标：
+//			1. 精确匹配
+//			2. 不区分大小写匹配
+//			3. 部分匹配（图标名称去掉 .lnk 后缀后不区分大小写匹配）
+class IconIndex
+{
+public:
+	// @brief 按 [0, names.size()) 的名称建表
+	void Build(const vector<wstring>& names) {
+		this->exact.clear();
+		this->folded.clear();
+		this->stripped.clear();
+		this->exact.reserve(names.size());
+		this->folded.reserve(names.size());
+		this->stripped.reserve(names.size());
+		for (size_t i = 0; i < names.size(); ++i) {
+			const int index = static_cast<int>(i);
+			const wstring& name = names[i];
+			wstring lower = Fold(name);
+			this->exact.emplace(name, index);
+			if (lower.size() > 4 && lower.compare(lower.size() - 4, 4, L".lnk") == 0)
+				this->stripped.emplace(lower.substr(0, lower.size() - 4), index);
+			this->folded.emplace(std::move(lower), index);
+		}
+	}
+
+	// @brief 查找图标索引
+	// @param how 输出：匹配方式，可以为 nullptr
+	// @ret 图标索引，找不到时返回 -1
+	int Find(const wchar_t* target, IconMatch* how = nullptr) const {
+		const wstring name(target);
+		auto found = this->exact.find(name);
+		IconMatch match = IconMatch::MATCH_EXACT;
+		if (found == this->exact.end()) {
+			const wstring lower = Fold(name);
+			found = this->folded.find(lower);
+			match = IconMatch::MATCH_CASE_INSENSITIVE;
+			if (found == this->folded.end()) {
+				found = this->stripped.find(lower);
+				match = found == this->stripped.end() ? IconMatch::MATCH_NONE : IconMatch::MATCH_PARTIAL;
+			}
+		}
+		if (how) *how = match;
+		return match == IconMatch::MATCH_NONE ? -1 : found->second;
+	}
+
+	// @brief 建表时的图标数
+	size_t Size() const {
+		return this->exact.size();
+	}
+
+private:
+	static wstring Fold(const wstring& name) {
+		wstring lower(name);
+		for (wchar_t& c : lower) c = static_cast<wchar_t>(towlower(c));
+		return lower;
+	}
+
+	unordered_map<wstring, int> exact;		// 名称 -> 第一个索引
+	unordered_map<wstring, int> folded;		// 小写名称 -> 第一个索引
+	unordered_map<wstring, int> stripped;	// .lnk 图标去掉后缀的小写名称 -> 第一个索引（其它图标在第 2 种方式就能找到）
+};
+
+// @struct IconMove
+// @brief 已解析的一次移动：图标索引与目标位置（设备像素）
+struct IconMove {
+	int index;
+	DesktopPoint point;
+};
+
+// @class DesktopIcons
+// @brief 在一个桌面后端上按批读取、移动图标
+// @note 每批最多 MAX_BATCH_ICONS 个图标，并且不超过调度器的一个时间片，通过 RunBatch 交给界面线程；
+//			批内只有 ListView 调用，查找、坐标换算、日志都由调用者在自己的线程上完成
+// @note 不写日志，可以配合 SimulatedDesktopBackend 在任意平台上运行
+class DesktopIcons
+{
+public:
+	// @note 构造时读取一次 DPI 与屏幕尺寸，之后的坐标换算都使用这一份
+	explicit DesktopIcons(DesktopBackend* desktop)
+		: desktop(desktop), dpi(desktop->GetDpi()), screen(desktop->GetScreenSize()) {}
+
+	// @brief 读取 [0, count) 的名称与坐标
+	// @param names 输出：名称，为 nullptr 时不读
+	// @param points 输出：坐标，为 nullptr 时不读；读取失败的坐标为 (0, 0)
+	// @param stop 每批开始前调用，返回 true 时停止，可以为空
+	// @ret 是否读完；界面线程无响应或被停止时返回 false，已读到的数据保留
+	bool Read(int count, vector<wstring>* names, vector<DesktopPoint>* points, SliceScheduler& scheduler,
+		const function<bool()>& stop = nullptr) {
+		count = max(count, 0);
+		if (names) {
+			names->clear();
+			names->reserve(count);
+		}
+		if (points) {
+			points->clear();
+			points->reserve(count);
+		}
+
+		return this->Batches(static_cast<size_t>(count), scheduler, stop, [&](size_t i) {
+			const int index = static_cast<int>(i);
+			if (names) names->push_back(this->desktop->GetItemText(index));
+			if (points) {
+				DesktopPoint point = { 0, 0 };
+				this->desktop->GetItemPosition(index, point);
+				points->push_back(point);
+			}
+		}, nullptr);
+	}
+
+	// @brief 移动图标
+	// @param failed 输出：SetItemPosition 失败的项在 moves 中的下标
+	// @param stop 每批开始前调用，返回 true 时停止，可以为空
+	// @param progress 每批结束后调用，参数为已处理的项数，可以为空
+	// @ret 已处理的项数；小于 moves.size() 表示被停止或界面线程无响应
+	size_t Move(const vector<IconMove>& moves, SliceScheduler& scheduler, vector<size_t>& failed,
+		const function<bool()>& stop = nullptr, const function<void(size_t)>& progress = nullptr) {
+		size_t done = 0;
+		this->Batches(moves.size(), scheduler, stop, [&](size_t i) {
+			if (!this->desktop->SetItemPosition(moves[i].index, moves[i].point)) failed.push_back(i);
+			done = i + 1;
+		}, progress);
+		return done;
+	}
+
+	// @brief 请求中的坐标 -> 设备像素
+	// @param is_rate 坐标是否为 Q16 比率，否则为逻辑像素
+	// @note 比率一步换算到屏幕并应用 DPI 缩放，全程整数运算
+	DesktopPoint ToDevicePoint(long x, long y, bool is_rate) const {
+		if (is_rate)
+			return { q16ToDevicePixel(x, this->screen.x, this->dpi), q16ToDevicePixel(y, this->screen.y, this->dpi) };
+		return { pixelToDevicePixel(x, this->dpi), pixelToDevicePixel(y, this->dpi) };
+	}
+
+	uint32_t GetDpi() const {
+		return this->dpi;
+	}
+
+	DesktopPoint GetScreenSize() const {
+		return this->screen;
+	}
+
+private:
+	// @brief 把 [0, count) 按批交给界面线程，item(i) 在批内执行
+	// @ret 是否全部执行完
+	// @note 本片用完预算时才 endSlice() 让出；否则批与批之间只让出时间片，预算为 0 时不会睡眠
+	bool Batches(size_t count, SliceScheduler& scheduler, const function<bool()>& stop,
+		const function<void(size_t)>& item, const function<void(size_t)>& progress) {
+		size_t i = 0;
+		while (i < count) {
+			if (stop && stop()) return false;
+			const size_t end = min(count, i + MAX_BATCH_ICONS);
+			this->desktop->RunBatch([&] {
+				do {
+					item(i);
+					++i;
+				} while (i < end && !scheduler.expired() && !this->desktop->IsHung());
+			});
+			if (progress) progress(i);
+			if (this->desktop->IsHung()) return false;
+			if (i >= count) break;
+			if (scheduler.expired()) scheduler.endSlice();
+			else this_thread::yield();
+		}
+		return true;
+	}
+
+	DesktopBackend* desktop;
+	uint32_t dpi;			// 设备 DPI
+	DesktopPoint screen;	// 屏幕尺寸（像素）
+};
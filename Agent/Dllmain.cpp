@@ -22,6 +22,8 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD reason, LPVOID lpReserved) {
 		CreateThread(nullptr, 0, IPCThreadAdapter, &mover, 0, nullptr);
 		break;
 	case DLL_PROCESS_DETACH:
+		// 卸下常驻的界面线程钩子，之后的消息不会再进入本模块；进程退出时不需要
+		if (lpReserved == nullptr) UiThreadDispatcher::Uninstall();
 		break;
 	}
 	return TRUE;
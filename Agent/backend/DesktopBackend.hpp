@@ -0,0 +1,91 @@
+﻿/**
+ * @file backend\DesktopBackend.hpp
+ * @brief 桌面后端接口：把对桌面 ListView 的访问与查找、移动、枚举逻辑分开
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <functional>
+using namespace std;
+
+constexpr uint32_t DESKTOP_STYLE_AUTOARRANGE = 0x0100;	// 与 LVS_AUTOARRANGE 相同
+
+// @struct DesktopPoint
+// @brief 后端使用的坐标 / 尺寸
+struct DesktopPoint
+{
+	long x;
+	long y;
+};
+
+// @class DesktopBackend
+// @brief 桌面图标列表的抽象
+// @note 只依赖标准库，实现可以是真实的 SysListView32，也可以是内存中的模拟列表
+// @note 索引与 ListView 一致：[0, GetItemCount())
+class DesktopBackend
+{
+public:
+	virtual ~DesktopBackend() = default;
+
+	// @brief 后端名称（用于日志）
+	virtual const wchar_t* GetName() const = 0;
+
+	// @brief 后端是否可用（真实后端会在句柄失效时重新查找）
+	virtual bool IsAvailable() = 0;
+
+	// @brief 图标数量
+	virtual int GetItemCount() = 0;
+
+	// @brief 图标显示名称，失败返回空字符串
+	virtual wstring GetItemText(int index) = 0;
+
+	// @brief 图标位置（设备像素）
+	virtual bool GetItemPosition(int index, DesktopPoint& point) = 0;
+
+	// @brief 移动图标（设备像素）
+	virtual bool SetItemPosition(int index, const DesktopPoint& point) = 0;
+
+	// @brief 图标间距
+	virtual bool GetItemSpacing(DesktopPoint& spacing) = 0;
+
+	// @brief 桌面窗口 DPI
+	virtual uint32_t GetDpi() = 0;
+
+	// @brief 屏幕尺寸（像素）
+	virtual DesktopPoint GetScreenSize() = 0;
+
+	// @brief 窗口样式
+	virtual bool GetStyle(uint32_t& style) = 0;
+	virtual bool SetStyle(uint32_t style) = 0;
+
+	// @brief 把一批操作放到一起执行
+	// @note 真实后端会把整批操作交给 ListView 所属的线程，批内的调用不再跨线程；默认直接执行
+	virtual void RunBatch(const function<void()>& work) {
+		work();
+	}
+
+	// @brief RunBatch 累计省下的跨线程调用次数
+	virtual unsigned long long GetSavedThreadSwitches() const {
+		return 0;
+	}
+
+	// @brief 看门狗：列表视图所在的界面线程是否已判定为无响应
+	// @note 判定后的调用立即失败，直到 ResetWatchdog()；可以从其它线程查询
+	virtual bool IsHung() const {
+		return false;
+	}
+
+	// @brief 判定无响应时的诊断信息（哪个操作、等了多久）
+	virtual wstring GetHangReport() const {
+		return L"";
+	}
+
+	// @brief 清除无响应判定与延迟统计，每条命令开始时调用
+	virtual void ResetWatchdog() {}
+
+	// @brief 自上次 ResetWatchdog() 以来单次操作的最长用时（微秒）
+	virtual uint32_t GetMaxCallMicroseconds() const {
+		return 0;
+	}
+};
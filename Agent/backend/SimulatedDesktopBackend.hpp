@@ -0,0 +1,138 @@
+﻿/**
+ * @file backend\SimulatedDesktopBackend.hpp
+ * @brief 模拟桌面后端：内存中的 ListView，可在任何平台上运行
+ */
+
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include "DesktopBackend.hpp"
+
+// @class SimulatedDesktopBackend
+// @brief 内存中的图标列表，每次调用可附加固定延迟以模拟跨进程消息的开销
+// @note 用于在没有 explorer 的环境下驱动查找、移动、枚举流程并计时
+class SimulatedDesktopBackend : public DesktopBackend
+{
+public:
+	// @param latency 每次调用附加的延迟（微秒），0 表示不延迟
+	explicit SimulatedDesktopBackend(long long latency = 0) : latency(latency) {}
+
+	// @brief 添加图标
+	void AddItem(const wstring& name, long x, long y) {
+		this->items.push_back({ name, { x, y } });
+	}
+
+	// @brief 生成 count 个按网格排列的图标，名称为 0、1、2...
+	void Populate(int count) {
+		this->items.clear();
+		this->items.reserve(count);
+		const long columns = max(1L, this->screen.x / this->spacing.x);
+		for (int i = 0; i < count; ++i)
+			this->AddItem(to_wstring(i), (i % columns) * this->spacing.x, (i / columns) * this->spacing.y);
+	}
+
+	void SetLatency(long long microseconds) { this->latency = microseconds; }
+	void SetDpi(uint32_t value) { this->dpi = value; }
+	void SetScreenSize(long cx, long cy) { this->screen = { cx, cy }; }
+
+	// @brief 自上次清零以来的调用次数
+	unsigned long long GetCallCount() const { return this->calls; }
+	void ResetCallCount() { this->calls = 0; }
+
+	// @brief 自上次清零以来 RunBatch 的次数（真实后端中每批是一次跨线程调用）
+	unsigned long long GetBatchCount() const { return this->batches; }
+	void ResetBatchCount() { this->batches = 0; }
+
+	const wchar_t* GetName() const override {
+		return L"Simulated";
+	}
+
+	bool IsAvailable() override {
+		this->simulateCall();
+		return true;
+	}
+
+	int GetItemCount() override {
+		this->simulateCall();
+		return static_cast<int>(this->items.size());
+	}
+
+	wstring GetItemText(int index) override {
+		this->simulateCall();
+		return this->isValidIndex(index) ? this->items[index].name : L"";
+	}
+
+	bool GetItemPosition(int index, DesktopPoint& point) override {
+		this->simulateCall();
+		if (!this->isValidIndex(index)) return false;
+		point = this->items[index].position;
+		return true;
+	}
+
+	bool SetItemPosition(int index, const DesktopPoint& point) override {
+		this->simulateCall();
+		if (!this->isValidIndex(index)) return false;
+		this->items[index].position = point;
+		return true;
+	}
+
+	bool GetItemSpacing(DesktopPoint& value) override {
+		this->simulateCall();
+		value = this->spacing;
+		return true;
+	}
+
+	uint32_t GetDpi() override {
+		this->simulateCall();
+		return this->dpi;
+	}
+
+	DesktopPoint GetScreenSize() override {
+		return this->screen;
+	}
+
+	bool GetStyle(uint32_t& value) override {
+		this->simulateCall();
+		value = this->style;
+		return true;
+	}
+
+	bool SetStyle(uint32_t value) override {
+		this->simulateCall();
+		this->style = value;
+		return true;
+	}
+
+	void RunBatch(const function<void()>& work) override {
+		++this->batches;
+		work();
+	}
+
+private:
+	struct Item {
+		wstring name;
+		DesktopPoint position;
+	};
+
+	bool isValidIndex(int index) const {
+		return index >= 0 && static_cast<size_t>(index) < this->items.size();
+	}
+
+	// @brief 计数并忙等 latency 微秒（sleep 的精度不够）
+	void simulateCall() {
+		++this->calls;
+		if (this->latency <= 0) return;
+		auto until = chrono::steady_clock::now() + chrono::microseconds(this->latency);
+		while (chrono::steady_clock::now() < until);
+	}
+
+	vector<Item> items;
+	long long latency;
+	unsigned long long calls = 0;
+	unsigned long long batches = 0;
+	uint32_t dpi = 96;
+	uint32_t style = DESKTOP_STYLE_AUTOARRANGE;
+	DesktopPoint screen = { 1920, 1080 };
+	DesktopPoint spacing = { 75, 100 };
+};
@@ -0,0 +1,154 @@
+﻿/**
+ * @file backend\UiThreadDispatcher.hpp
+ * @brief 把一整批 ListView 操作交给窗口所属的界面线程执行
+ */
+
+#pragma once
+#include <Windows.h>
+#include <functional>
+using namespace std;
+
+constexpr auto UI_DISPATCH_MESSAGE_NAME = L"DesktopIconMover.UiDispatch";	// 投递工作的注册消息
+constexpr WPARAM UI_DISPATCH_MAGIC = 0x52694B6B;								// 区分我们发出的消息
+constexpr UINT UI_DISPATCH_TIMEOUT = 5000;										// 等待界面线程开始执行的最长时间
+
+// @enum DispatchResult
+// @brief UiThreadDispatcher::Run 的结果
+enum class DispatchResult : int {
+	DISPATCH_DONE = 0,			// 已在界面线程上执行完
+	DISPATCH_UNAVAILABLE = 1,	// 无法挂钩子，工作没有执行，可以在当前线程上执行
+	DISPATCH_HUNG = 2			// 界面线程无响应，工作没有执行
+};
+
+// @class UiThreadDispatcher
+// @brief 在窗口所属线程上执行一项工作
+// @note 做法：给目标线程挂 WH_CALLWNDPROC 钩子，向窗口 SendMessage 一条注册消息，
+//			钩子在目标线程上收到这条消息时执行工作；工作中的 ListView_* 就都是同线程调用，
+//			一批操作只需要一次跨线程切换
+// @note 钩子在第一次 Run 时挂上并一直保留（目标线程变化时重新挂），之后每一片、每一帧都不再挂钩子；
+//			DLL 卸载前必须调用 Uninstall()，不留下指向已卸载代码的钩子
+// @note 同一时间只有一项工作，放在固定的工作槽中；槽的状态与消息都带票号，放弃的工作迟到的消息票号不符，
+//			钩子直接忽略，不需要为它保留内存
+// @note 只能在一个线程上调用 Run（Agent 只在主通道线程上访问桌面）
+// @note 消息用 SendMessageTimeout(SMTO_ABORTIFHUNG) 发送：界面线程无响应时不会一直阻塞
+class UiThreadDispatcher {
+public:
+	// @brief 在 window 所属的线程上执行 work，返回 DISPATCH_DONE 时 work 已经执行完
+	// @param waited 输出：等待界面线程的时间（毫秒）
+	static DispatchResult Run(HWND window, const function<void()>& work, DWORD* waited = nullptr) {
+		if (waited) *waited = 0;
+		if (!window) return DispatchResult::DISPATCH_UNAVAILABLE;
+		const DWORD owner = GetWindowThreadProcessId(window, nullptr);
+		if (owner == GetCurrentThreadId()) {
+			work();
+			return DispatchResult::DISPATCH_DONE;
+		}
+
+		const UINT message = DispatchMessageId();
+		if (!message || !Install(owner)) return DispatchResult::DISPATCH_UNAVAILABLE;
+
+		// 新票号：低位留给状态
+		Slot& slot = CurrentSlot();
+		const LONG ticket = static_cast<LONG>(++slot.sequence << WORK_STATE_BITS);
+		slot.work = &work;
+		InterlockedExchange(&slot.state, ticket | WORK_PENDING);
+
+		const DWORD start = GetTickCount();
+		DWORD_PTR result = 0;
+		SendMessageTimeoutW(window, message, UI_DISPATCH_MAGIC, static_cast<LPARAM>(ticket),
+			SMTO_ABORTIFHUNG | SMTO_BLOCK, UI_DISPATCH_TIMEOUT, &result);
+
+		// 还没开始就放弃；已经开始的一定会在界面线程上执行完（批内都是同线程调用），等它结束
+		const LONG state = InterlockedCompareExchange(&slot.state, ticket | WORK_ABANDONED, ticket | WORK_PENDING);
+		const bool abandoned = state == (ticket | WORK_PENDING);
+		while (!abandoned && slot.state != (ticket | WORK_DONE))
+			Sleep(1);
+		if (waited) *waited = GetTickCount() - start;
+		return abandoned ? DispatchResult::DISPATCH_HUNG : DispatchResult::DISPATCH_DONE;
+	}
+
+	// @brief 卸下钩子
+	// @note DLL 卸载前调用；之后的 Run 会重新挂上
+	static void Uninstall() {
+		Hook& hook = CurrentHook();
+		if (hook.handle) UnhookWindowsHookEx(hook.handle);
+		hook.handle = nullptr;
+		hook.thread = 0;
+	}
+
+private:
+	static constexpr LONG WORK_PENDING = 0;		// 等待执行
+	static constexpr LONG WORK_RUNNING = 1;		// 界面线程正在执行
+	static constexpr LONG WORK_DONE = 2;		// 执行完毕
+	static constexpr LONG WORK_ABANDONED = 3;	// 调用者已放弃，不要执行
+	static constexpr int WORK_STATE_BITS = 2;	// 状态占用的低位
+
+	// @struct Slot
+	// @brief 工作槽：state 为 票号 | 状态
+	struct Slot {
+		const function<void()>* work = nullptr;
+		volatile LONG state = 0;
+		ULONG sequence = 0;		// 只由 Run 的线程修改
+	};
+
+	// @struct Hook
+	// @brief 当前挂着的钩子
+	struct Hook {
+		HHOOK handle = nullptr;
+		DWORD thread = 0;
+	};
+
+	static Slot& CurrentSlot() {
+		static Slot slot;
+		return slot;
+	}
+
+	static Hook& CurrentHook() {
+		static Hook hook;
+		return hook;
+	}
+
+	// @brief 确保 owner 线程上挂着钩子
+	static bool Install(DWORD owner) {
+		Hook& hook = CurrentHook();
+		if (hook.handle && hook.thread == owner) return true;
+		Uninstall();
+		HMODULE module = CurrentModule();
+		if (!module) return false;
+		hook.handle = SetWindowsHookExW(WH_CALLWNDPROC, HookProc, module, owner);
+		hook.thread = hook.handle ? owner : 0;
+		return hook.handle != nullptr;
+	}
+
+	// @note 钩子常驻，explorer 界面线程上的每条同步消息都会经过这里，非本工具的消息只做一次比较
+	static LRESULT CALLBACK HookProc(int code, WPARAM wParam, LPARAM lParam) {
+		const CWPSTRUCT* message = reinterpret_cast<const CWPSTRUCT*>(lParam);
+		if (code == HC_ACTION && message->wParam == UI_DISPATCH_MAGIC && message->message == DispatchMessageId()) {
+			Slot& slot = CurrentSlot();
+			const LONG ticket = static_cast<LONG>(message->lParam);
+			if (InterlockedCompareExchange(&slot.state, ticket | WORK_RUNNING, ticket | WORK_PENDING) == (ticket | WORK_PENDING)) {
+				try {
+					(*slot.work)();
+				}
+				catch (...) {
+					// 不能让异常穿过 explorer 的窗口过程
+				}
+				InterlockedExchange(&slot.state, ticket | WORK_DONE);
+			}
+		}
+		return CallNextHookEx(nullptr, code, wParam, lParam);
+	}
+
+	static UINT DispatchMessageId() {
+		static const UINT message = RegisterWindowMessageW(UI_DISPATCH_MESSAGE_NAME);
+		return message;
+	}
+
+	// @brief 本 DLL 的模块句柄（钩子过程所在的模块）
+	static HMODULE CurrentModule() {
+		HMODULE module = nullptr;
+		GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+			reinterpret_cast<LPCWSTR>(&UiThreadDispatcher::HookProc), &module);
+		return module;
+	}
+};
@@ -0,0 +1,281 @@
+﻿/**
+ * @file backend\Win32DesktopBackend.hpp
+ * @brief 真实桌面后端：explorer 中的 SysListView32
+ */
+
+#pragma once
+#include <Windows.h>
+#include <CommCtrl.h>
+#include <atomic>
+#include <chrono>
+#include "DesktopBackend.hpp"
+#include "UiThreadDispatcher.hpp"
+#include "common/fixedpoint.h"
+#include "../tool/LogMessage.hpp"
+
+constexpr UINT LISTVIEW_MESSAGE_TIMEOUT = 2000;	// 单条 ListView 消息的最长等待时间
+
+// @class Win32DesktopBackend
+// @brief 通过 LVM_* 消息操作桌面 ListView
+// @note 看门狗：每条消息用 SendMessageTimeout 发送并记录用时；超时或 explorer 被系统判定为无响应时，
+//			后端进入“无响应”状态，之后的调用立即失败，调用者据此中止整批操作
+class Win32DesktopBackend : public DesktopBackend
+{
+public:
+	Win32DesktopBackend(LogMessage& logMessage) : logMessage(logMessage) {
+		this->hListView = this->GetHListView();
+	}
+
+	const wchar_t* GetName() const override {
+		return L"SysListView32";
+	}
+
+	// @note 句柄失效时重新查找
+	bool IsAvailable() override {
+		if (!this->hListView || !IsWindow(this->hListView))
+			this->hListView = this->GetHListView();
+		return this->hListView != nullptr;
+	}
+
+	int GetItemCount() override {
+		LRESULT count = 0;
+		if (!this->Send(LVM_GETITEMCOUNT, 0, 0, count, L"LVM_GETITEMCOUNT")) return 0;
+		return static_cast<int>(count);
+	}
+
+	wstring GetItemText(int index) override {
+		wchar_t buffer[256] = { 0 };
+		LVITEM lvi = { 0 };
+		lvi.iItem = index;
+		lvi.mask = LVIF_TEXT;
+		lvi.pszText = buffer;
+		lvi.cchTextMax = 256;
+
+		LRESULT result = 0;
+		if (this->Send(LVM_GETITEM, 0, reinterpret_cast<LPARAM>(&lvi), result, L"LVM_GETITEM") && result) {
+			return wstring(buffer);
+		}
+
+		return L"";
+	}
+
+	bool GetItemPosition(int index, DesktopPoint& point) override {
+		POINT pt = { 0 };
+		LRESULT result = 0;
+		if (index < 0 || !this->Send(LVM_GETITEMPOSITION, index, reinterpret_cast<LPARAM>(&pt), result, L"LVM_GETITEMPOSITION") || !result) return false;
+		point = { pt.x, pt.y };
+		return true;
+	}
+
+	bool SetItemPosition(int index, const DesktopPoint& point) override {
+		LRESULT result = 0;
+		if (this->Send(LVM_SETITEMPOSITION, index, MAKELPARAM(point.x, point.y), result, L"LVM_SETITEMPOSITION") && result) return true;
+		logMessage.log(L"LVM_SETITEMPOSITION 执行失败，错误代码: " + to_wstring(GetLastError()));
+		return false;
+	}
+
+	bool GetItemSpacing(DesktopPoint& spacing) override {
+		LRESULT value = 0;
+		if (!this->Send(LVM_GETITEMSPACING, FALSE, 0, value, L"LVM_GETITEMSPACING")) return false;
+		spacing = { LOWORD(value), HIWORD(value) };
+		return true;
+	}
+
+	uint32_t GetDpi() override {
+		UINT dpi = this->hListView ? GetDpiForWindow(this->hListView) : 0;
+		return dpi ? dpi : DPI_BASE;
+	}
+
+	DesktopPoint GetScreenSize() override {
+		return { GetSystemMetrics(SM_CXSCREEN), GetSystemMetrics(SM_CYSCREEN) };
+	}
+
+	bool GetStyle(uint32_t& style) override {
+		LONG_PTR value = GetWindowLongPtr(this->hListView, GWL_STYLE);
+		if (!value) {
+			logMessage.log(L"获取窗口样式失败");
+			return false;
+		}
+		style = static_cast<uint32_t>(value);
+		return true;
+	}
+
+	// @note 修改样式会向窗口同步发送 WM_STYLECHANGING / WM_STYLECHANGED，无响应时不再尝试
+	bool SetStyle(uint32_t style) override {
+		if (this->hung) return false;
+		SetLastError(0);
+		if (!SetWindowLongPtr(this->hListView, GWL_STYLE, static_cast<LONG_PTR>(style)) && GetLastError()) {
+			logMessage.log(L"设置窗口样式失败");
+			return false;
+		}
+		return true;
+	}
+
+	// @note 整批交给 ListView 所属的界面线程执行，批内的消息都是同线程调用；
+	//			挂钩子失败时退回逐条跨线程调用；界面线程无响应时整批不执行，并进入无响应状态
+	void RunBatch(const function<void()>& work) override {
+		if (this->hung) return;
+		const unsigned long long before = this->listViewCalls;
+		DWORD waited = 0;
+		switch (UiThreadDispatcher::Run(this->hListView, work, &waited)) {
+		case DispatchResult::DISPATCH_DONE:
+			break;
+		case DispatchResult::DISPATCH_UNAVAILABLE:
+			logMessage.log(L"无法在界面线程上执行，改为逐条跨线程调用");
+			work();
+			return;
+		case DispatchResult::DISPATCH_HUNG:
+			this->MarkHung(L"explorer 界面线程无响应：批量操作等待 " + to_wstring(waited) + L" ms 仍未开始执行");
+			return;
+		}
+		const unsigned long long calls = this->listViewCalls - before;
+		if (calls > 1) this->savedThreadSwitches += calls - 1; // 整批只需要一次切换
+	}
+
+	unsigned long long GetSavedThreadSwitches() const override {
+		return this->savedThreadSwitches;
+	}
+
+	bool IsHung() const override {
+		return this->hung;
+	}
+
+	wstring GetHangReport() const override {
+		return this->hung ? this->hangReport : L"";
+	}
+
+	void ResetWatchdog() override {
+		this->hung = false;
+		this->hangReport.clear();
+		this->maxCallMicroseconds = 0;
+	}
+
+	uint32_t GetMaxCallMicroseconds() const override {
+		return this->maxCallMicroseconds;
+	}
+
+private:
+	// @brief 向 ListView 发送一条消息，最多等待 LISTVIEW_MESSAGE_TIMEOUT
+	// @param result 输出：消息的返回值
+	// @param name 消息名称（用于诊断信息）
+	// @ret 消息是否被处理；已判定无响应时直接返回 false
+	// @note 在界面线程上（RunBatch 内）调用时直接进入窗口过程，不会等待
+	bool Send(UINT message, WPARAM wParam, LPARAM lParam, LRESULT& result, const wchar_t* name) {
+		if (!this->hListView || this->hung) return false;
+		++this->listViewCalls;
+
+		const auto start = chrono::steady_clock::now();
+		DWORD_PTR value = 0;
+		SetLastError(0);
+		const LRESULT sent = SendMessageTimeoutW(this->hListView, message, wParam, lParam,
+			SMTO_ABORTIFHUNG | SMTO_BLOCK, LISTVIEW_MESSAGE_TIMEOUT, &value);
+		const DWORD error = GetLastError();
+		const uint32_t elapsed = static_cast<uint32_t>(
+			chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count());
+		if (elapsed > this->maxCallMicroseconds) this->maxCallMicroseconds = elapsed;
+
+		if (!sent) {
+			if (error == ERROR_TIMEOUT || IsHungAppWindow(this->hListView))
+				this->MarkHung(L"explorer 界面线程无响应：" + wstring(name) + L" 等待 " + to_wstring(elapsed / 1000) + L" ms 未返回");
+			return false;
+		}
+		result = static_cast<LRESULT>(value);
+		return true;
+	}
+
+	// @brief 进入无响应状态，只记录第一次的诊断信息
+	void MarkHung(const wstring& report) {
+		if (this->hung) return;
+		this->hangReport = report;
+		this->hung = true;
+		logMessage.log(report);
+	}
+
+	// @brief 查找桌面 ListView 窗口
+	HWND FindDesktopListView() {
+		logMessage.log(L"开始查找桌面ListView窗口...");
+
+		// 标准方法
+		HWND hWorker = nullptr;
+		while ((hWorker = FindWindowEx(nullptr, hWorker, L"WorkerW", nullptr))) {
+			HWND hShell = FindWindowEx(hWorker, nullptr, L"SHELLDLL_DefView", nullptr);
+			if (hShell) {
+				HWND hList = FindWindowEx(hShell, nullptr, L"SysListView32", L"FolderView");
+				if (hList && IsWindowVisible(hList)) {
+					logMessage.log(L"通过WorkerW找到桌面ListView窗口");
+					return hList;
+				}
+			}
+		}
+
+		// 备用方法（针对特殊桌面配置）
+		HWND hProgman = FindWindow(L"Progman", L"Program Manager");
+		if (hProgman) {
+			// 尝试通过Progman直接查找桌面窗口
+			HWND hDesktop = FindWindowEx(hProgman, nullptr, L"SHELLDLL_DefView", nullptr);
+			if (!hDesktop) {
+				// 尝试桌面子窗口
+				hDesktop = FindWindowEx(hProgman, nullptr, nullptr, L"FolderView");
+			}
+			if (hDesktop) {
+				HWND hList = FindWindowEx(hDesktop, nullptr, L"SysListView32", nullptr);
+				if (hList && IsWindowVisible(hList)) {
+					logMessage.log(L"通过Progman找到桌面ListView窗口");
+					return hList;
+				}
+			}
+		}
+
+		// 枚举所有窗口
+		logMessage.log(L"尝试枚举所有窗口查找桌面ListView");
+		HWND hDesktop = GetDesktopWindow();
+		HWND hChild = GetWindow(hDesktop, GW_CHILD);
+		while (hChild) {
+			wchar_t className[256];
+			GetClassName(hChild, className, 256);
+
+			if (wcscmp(className, L"SysListView32") == 0) {
+				wchar_t windowText[256];
+				GetWindowText(hChild, windowText, 256);
+
+				if (wcscmp(windowText, L"FolderView") == 0) {
+					logMessage.log(L"通过枚举找到桌面ListView窗口");
+					return hChild;
+				}
+			}
+			hChild = GetWindow(hChild, GW_HWNDNEXT);
+		}
+
+		logMessage.log(L"无法找到桌面ListView窗口");
+		return nullptr;
+	}
+
+	// @brief 查找桌面 ListView
+	HWND GetHListView() {
+		// 查找桌面列表视图
+		HWND hListView = FindDesktopListView();
+		if (!hListView) {
+			logMessage.log(L"找不到桌面ListView窗口");
+			return nullptr;
+		}
+
+		// 获取 ListView 信息
+		wchar_t className[256];
+		GetClassName(hListView, className, 256);
+		DWORD pid = 0;
+		GetWindowThreadProcessId(hListView, &pid);
+
+		logMessage.log(L"ListView 类名: " + wstring(className));
+		logMessage.log(L"ListView 进程ID: " + to_wstring(pid));
+
+		return hListView;
+	}
+
+	LogMessage& logMessage;
+	HWND hListView;
+	unsigned long long listViewCalls = 0;		// ListView 消息次数
+	unsigned long long savedThreadSwitches = 0;	// RunBatch 累计省下的跨线程调用次数
+	atomic<bool> hung{ false };					// 界面线程已判定为无响应（控制通道会读取）
+	wstring hangReport;							// 无响应时的诊断信息，在 hung 置位之前写入
+	uint32_t maxCallMicroseconds = 0;			// 单条消息的最长用时（微秒）
+};
@@ -0,0 +1,114 @@
+﻿/**
+ * @file tool\Animator.hpp
+ * @brief 按目标帧率播放图标动画：帧节奏控制与丢帧统计
+ */
+
+#pragma once
+#include <chrono>
+#include <thread>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include "common/animation.h"
+using namespace std;
+
+// @class Animator
+// @brief 动画时钟：按时间计算每帧的进度，按帧率排定下一帧
+// @note 进度由实际经过的时间决定，某一帧绘制过慢时跳过错过的帧（计为丢帧），动画仍按时结束
+// @note 最后一帧的进度总是 RATIO_Q16_ONE，图标精确停在终点
+// @note 只依赖标准库计时，可以配合 SimulatedDesktopBackend 测量不同图标数量下可达到的帧率
+class Animator {
+public:
+	typedef chrono::steady_clock clock;
+
+	// @param durationMilliseconds 时长（毫秒），0 表示只绘制终点一帧
+	// @param framesPerSecond 目标帧率，限制在 1 ~ ANIMATION_MAX_FPS
+	Animator(uint32_t durationMilliseconds, uint32_t framesPerSecond, Easing easing)
+		: duration(min(durationMilliseconds, ANIMATION_MAX_DURATION) * 1000ULL),
+		interval(1000000ULL / max<uint32_t>(1, min(framesPerSecond, ANIMATION_MAX_FPS))),
+		easing(easing) {}
+
+	// @brief 按计划应绘制的帧数（含起点与终点）
+	uint32_t plannedFrames() const {
+		return static_cast<uint32_t>(this->duration / this->interval + 1);
+	}
+
+	// @brief 播放
+	// @param render 绘制一帧，参数为缓动后的进度（0 ~ RATIO_Q16_ONE）
+	// @param stop 每帧之前调用，返回 true 时提前结束
+	// @ret 是否播放到终点
+	template <class Render, class Stop>
+	bool play(Render render, Stop stop) {
+		const clock::time_point start = clock::now();
+		uint64_t slot = 0;	// 当前帧在帧率时间轴上的序号
+		while (true) {
+			if (stop()) {
+				this->elapsed = this->microsecondsSince(start);
+				return false;
+			}
+
+			const uint64_t now = this->microsecondsSince(start);
+			const bool last = now >= this->duration;
+			const RatioQ16 t = last ? RATIO_Q16_ONE : static_cast<RatioQ16>((now << RATIO_Q16_SHIFT) / this->duration);
+
+			const clock::time_point frameStart = clock::now();
+			render(easeQ16(this->easing, t));
+			this->frames.push_back(static_cast<uint32_t>(this->microsecondsSince(frameStart)));
+			if (last) {
+				this->elapsed = this->microsecondsSince(start);
+				return true;
+			}
+
+			// 排定下一帧：已经错过的时刻不再补画
+			uint64_t next = slot + 1;
+			const uint64_t current = this->microsecondsSince(start) / this->interval;
+			if (current > next) {
+				this->dropped += static_cast<uint32_t>(current - next);
+				next = current;
+			}
+			slot = next;
+			const uint64_t due = min(slot * this->interval, this->duration);
+			this_thread::sleep_until(start + chrono::microseconds(due));
+		}
+	}
+
+	// @brief 已绘制的帧数
+	uint32_t framesRendered() const {
+		return static_cast<uint32_t>(this->frames.size());
+	}
+
+	// @brief 因绘制过慢而跳过的帧数
+	uint32_t framesDropped() const {
+		return this->dropped;
+	}
+
+	// @brief 最慢一帧的绘制用时（微秒）
+	uint32_t maxFrameMicroseconds() const {
+		return this->frames.empty() ? 0 : *max_element(this->frames.begin(), this->frames.end());
+	}
+
+	// @brief 实际帧率（帧/秒）
+	double achievedFps() const {
+		return this->elapsed ? this->frames.size() * 1000000.0 / this->elapsed : 0.0;
+	}
+
+	// @brief 统计摘要，用于日志
+	wstring summary() const {
+		return to_wstring(this->framesRendered()) + L" / " + to_wstring(this->plannedFrames()) + L" 帧，丢帧 " +
+			to_wstring(this->dropped) + L"，实际 " + to_wstring(static_cast<int>(this->achievedFps() + 0.5)) +
+			L" 帧/秒，最慢一帧 " + to_wstring(this->maxFrameMicroseconds()) + L" us";
+	}
+
+private:
+	static uint64_t microsecondsSince(clock::time_point start) {
+		return static_cast<uint64_t>(chrono::duration_cast<chrono::microseconds>(clock::now() - start).count());
+	}
+
+	uint64_t duration;			// 时长（微秒）
+	uint64_t interval;			// 帧间隔（微秒）
+	Easing easing;				// 缓动曲线
+	uint64_t elapsed = 0;		// 实际播放时长（微秒）
+	uint32_t dropped = 0;		// 丢帧数
+	vector<uint32_t> frames;	// 每帧的绘制用时（微秒）
+};
@@ -6,6 +6,7 @@ constexpr auto LOGMESSAGE_DEFAULT = L"D:\\DLL_Mover.log";
 #include <fstream>
 #include <string>
 #include <iomanip>
+#include <mutex>
 using namespace std;
 
 /*#if _DEBUG
@@ -91,6 +92,7 @@ public:
 	// @note 不改变 enable 状态
 	// @note 不会移动或 copy 旧的日志文件
 	bool changeLogFilePath(const wstring& logFilePath) {
+		lock_guard<mutex> guard(this->logMutex);
 		if (this->isFileOpen())
 			this->logFile.close();
 		this->logFile.open(logFilePath, ios::app);
@@ -110,6 +112,7 @@ public:
 
 	// @brief 清理日志文件
 	bool clearLogFile() {
+		lock_guard<mutex> guard(this->logMutex);
 		if (!this->isFileOpen()) return false;
 		this->logFile.seekp(0);	// 把光标移到开头
 		this->logFile << std::flush; // 截断
@@ -154,6 +157,7 @@ private:
 		SYSTEMTIME st;
 		GetLocalTime(&st);
 
+		lock_guard<mutex> guard(this->logMutex); // 可能被多个线程同时调用
 		this->logFile.clear();
 		this->logFile << L"[" << to_wstring(st.wYear) << L"-"
 			<< setw(2) << setfill(L'0') << st.wMonth << L"-"
@@ -169,4 +173,8 @@ private:
 
 	// @var wofstream logFile
 	wofstream logFile;
+
+	// @var mutex logMutex
+	// @brief 保护 logFile
+	mutex logMutex;
 };
@@ -0,0 +1,96 @@
+﻿/**
+ * @file tool\SliceScheduler.hpp
+ * @brief 按时间片执行批量工作，片与片之间让出时间给 explorer 的界面线程
+ */
+
+#pragma once
+#include <chrono>
+#include <thread>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+using namespace std;
+
+constexpr uint32_t SLICE_YIELD_MILLISECONDS = 1;	// 每片结束后让出的时间
+
+// @class SliceScheduler
+// @brief 时间片调度：在两个工作项之间调用 checkpoint()，本片用时超过预算就让出一次
+// @note 工作项不能在当前线程让出时（如整片交给其它线程执行），用 expired() 结束一片，再在当前线程 endSlice()
+// @note 预算为 0 时不分片（吞吐量优先），只统计总耗时
+// @note 只依赖标准库计时，可以配合 SimulatedDesktopBackend 在任意平台上测量
+class SliceScheduler {
+public:
+	typedef chrono::steady_clock clock;
+
+	// @param budgetMicroseconds 每片的时间预算（微秒），0 表示不分片
+	// @param yieldMilliseconds 每片结束后让出的时间，0 表示只让出时间片
+	explicit SliceScheduler(uint32_t budgetMicroseconds, uint32_t yieldMilliseconds = SLICE_YIELD_MILLISECONDS)
+		: budget(budgetMicroseconds), yield(yieldMilliseconds), sliceStart(clock::now()) {}
+
+	// @brief 两个工作项之间调用
+	// @ret 是否在这里让出了一次
+	bool checkpoint() {
+		if (!this->expired()) return false;
+		this->endSlice();
+		return true;
+	}
+
+	// @brief 本片是否已经用完预算
+	bool expired() const {
+		return this->budget != 0 && this->elapsedMicroseconds() >= this->budget;
+	}
+
+	// @brief 结束本片并让出，然后开始下一片
+	void endSlice() {
+		this->slices.push_back(this->elapsedMicroseconds());
+		if (this->yield) this_thread::sleep_for(chrono::milliseconds(this->yield));
+		else this_thread::yield();
+		this->sliceStart = clock::now();
+	}
+
+	// @brief 结束最后一片
+	void finish() {
+		this->slices.push_back(this->elapsedMicroseconds());
+		this->sliceStart = clock::now();
+	}
+
+	// @brief 已结束的片数
+	size_t sliceCount() const {
+		return this->slices.size();
+	}
+
+	// @brief 最长一片的用时（微秒），即界面线程最长被占用的时间
+	uint32_t maxSliceMicroseconds() const {
+		return this->slices.empty() ? 0 : *max_element(this->slices.begin(), this->slices.end());
+	}
+
+	// @brief 片用时的百分位数（微秒）
+	// @param percent 0 ~ 100
+	uint32_t percentileMicroseconds(double percent) const {
+		if (this->slices.empty()) return 0;
+		vector<uint32_t> sorted(this->slices);
+		size_t rank = static_cast<size_t>(percent / 100.0 * (sorted.size() - 1) + 0.5);
+		rank = min(rank, sorted.size() - 1);
+		nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+		return sorted[rank];
+	}
+
+	// @brief 统计摘要，用于日志
+	wstring summary() const {
+		return to_wstring(this->sliceCount()) + L" 片，预算 " + to_wstring(this->budget) +
+			L" us，p50 " + to_wstring(this->percentileMicroseconds(50)) +
+			L" us，p95 " + to_wstring(this->percentileMicroseconds(95)) +
+			L" us，最长 " + to_wstring(this->maxSliceMicroseconds()) + L" us";
+	}
+
+private:
+	uint32_t elapsedMicroseconds() const {
+		return static_cast<uint32_t>(chrono::duration_cast<chrono::microseconds>(clock::now() - this->sliceStart).count());
+	}
+
+	uint32_t budget;			// 每片的时间预算（微秒）
+	uint32_t yield;				// 每片结束后让出的时间（毫秒）
+	clock::time_point sliceStart;	// 当前片的开始时间
+	vector<uint32_t> slices;	// 每片的用时（微秒）
+};
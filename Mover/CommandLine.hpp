@@ -7,20 +7,45 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <functional>
 #include <iostream>
 #include <algorithm>
 #include <cctype>
 #include <locale>
+#include <chrono>
+#include <sstream>
 #include "tool/LogMessage.hpp"
+#include "tool/FairMutex.hpp"
+#include "tool/PipeServer.hpp"
+#include "tool/EnvironmentProbe.hpp"
+#include "tool/PhaseTimer.hpp"
+#include "tool/TaskGraph.hpp"
+#include "tool/MappedFile.hpp"
+#include "tool/KeyframePlayer.hpp"
+#include "tool/FrameStream.hpp"
+#include "tool/LayoutDiff.hpp"
 #include "Mover.hpp"
 #include "DataManager.hpp"
 
+// @brief 移动失败时把 Agent 回传的诊断信息（界面线程无响应、取消时停在哪里等）显示给用户并写入日志
+inline void reportAgentError(LogMessage& logger, const Mover& mover) {
+	const wstring& detail = mover.GetLastAgentError();
+	if (detail.empty()) return;
+	wcerr << L"Agent: " << detail << endl;
+	logger.error(L"Agent: " + detail);
+}
+
  // 命令模式基类
 class Command {
 public:
 	virtual ~Command() = default;
 	virtual bool execute(LogMessage& logger, Mover& mover, DataManager& dm) = 0;
+
+	// @brief 命令是否自己在合适的时机注入（与其它准备工作并行）
+	// @param inject 本次是否需要注入
+	// @ret true 表示由命令接管注入，Application 不再提前注入
+	virtual bool takeOverInjection(bool inject) { return false; }
 };
 
 // 保存图标布局
@@ -36,28 +61,20 @@ public:
 	bool execute(LogMessage& logger, Mover& mover, DataManager& dm) override {
 		logger.log(L"开始保存图标布局...");
 
-		// 获取图标数量
-		int iconCount = mover.GetIconsNumber();
-		if (iconCount <= 0) {
-			logger.error(L"错误: 未找到桌面图标");
-			return false;
-		}
-
-		// 分配内存并获取图标位置
-		auto iconPositions = mover.SafeNewIconPositionMove();
-		if (!iconPositions) {
-			logger.error(L"错误: 内存分配失败");
+		// 获取图标位置
+		IconSnapshot snapshot;
+		if (!mover.GetSnapshot(snapshot)) {
+			logger.error(L"错误: 获取图标数据失败");
 			return false;
 		}
-
-		if (mover.GetAllIcons(iconPositions.get(), iconCount) != iconCount) {
-			logger.error(L"错误: 获取图标数据失败");
+		if (snapshot.empty()) {
+			logger.error(L"错误: 未找到桌面图标");
 			return false;
 		}
 
 		// 转换为比率点向量
 		RatioPointVector ratioPoints;
-		dm.iconPositionMoveToRatioPointVector(ratioPoints, iconPositions.get(), iconCount);
+		dm.snapshotToRatioPointVector(ratioPoints, snapshot);
 
 		// 可选排序
 		if (!sortMode.empty()) {
@@ -69,7 +86,7 @@ public:
 		if (outputToConsole) {
 			wcout << L"布局数据:\n";
 			for (const auto& point : ratioPoints) {
-				wcout << point.first << L" " << point.second << L"\n";
+				wcout << q16ToRatio(point.x) << L" " << q16ToRatio(point.y) << L"\n";
 			}
 		}
 
@@ -143,43 +160,35 @@ public:
 	bool execute(LogMessage& logger, Mover& mover, DataManager& dm) override {
 		logger.log(L"开始保存完整图标数据...");
 
-		// 获取图标数量
-		int iconCount = mover.GetIconsNumber();
-		if (iconCount <= 0) {
-			logger.error(L"错误: 未找到桌面图标");
-			return false;
-		}
-
-		// 分配内存并获取图标数据
-		auto iconPositions = mover.SafeNewIconPositionMove();
-		if (!iconPositions) {
-			logger.error(L"错误: 内存分配失败");
+		// 获取图标数据
+		IconSnapshot snapshot;
+		if (!mover.GetSnapshot(snapshot)) {
+			logger.error(L"错误: 获取图标数据失败");
 			return false;
 		}
-
-		if (mover.GetAllIcons(iconPositions.get(), iconCount) != iconCount) {
-			logger.error(L"错误: 获取图标数据失败");
+		if (snapshot.empty()) {
+			logger.error(L"错误: 未找到桌面图标");
 			return false;
 		}
 
 		// 可选排序
 		if (!sortMode.empty()) {
-			dm.sort(iconPositions.get(), iconCount, sortMode);
+			dm.sort(snapshot, sortMode);
 			logger.log(L"已按 " + sortMode + L" 排序布局");
 		}
 
 		// 输出到控制台
 		if (outputToConsole) {
 			wcout << L"图标数据:\n";
-			for (int i = 0; i < iconCount; ++i) {
-				wcout << iconPositions[i].targetName << L": ("
-					<< iconPositions[i].p.x << L", "
-					<< iconPositions[i].p.y << L")\n";
+			for (size_t i = 0; i < snapshot.size(); ++i) {
+				wcout << snapshot.name(i) << L": ("
+					<< snapshot[i].p.x << L", "
+					<< snapshot[i].p.y << L")\n";
 			}
 		}
 
 		// 保存到文件
-		if (!dm.writeIconPositionMoveToFile(iconPositions.get(), iconCount, filePath.c_str())) {
+		if (!dm.writeSnapshotToFile(snapshot, filePath.c_str())) {
 			logger.error(L"错误: 文件保存失败");
 			return false;
 		}
@@ -191,70 +200,589 @@ public:
 };
 
 // 移动图标
+// @note 各步骤组成阶段图并行执行，总耗时约等于关键路径：
+//			读取布局 -> 转换坐标
+//			读取布局 + 注入 -> 核对指纹 -> 创建文件、禁用排列
+//			创建文件 + 禁用排列 -> 显示桌面
+//			显示桌面 + 转换坐标 -> 移动图标
+// @note 桌面的布局指纹与文件一致时（见 common/fingerprint.h）不创建文件、不移动，几毫秒内返回
+// @note animation.duration 不为 0 时图标从当前位置平滑移动到目标位置
 class MoveIconsCommand : public Command {
 	wstring filePath;
+	AnimationParams animation;
+	bool inject = false;	// 是否由本命令注入
 
 public:
-	explicit MoveIconsCommand(const wstring& path) : filePath(path) {}
+	explicit MoveIconsCommand(const wstring& path, const AnimationParams& animation = AnimationParams())
+		: filePath(path), animation(animation) {}
+
+	bool takeOverInjection(bool inject) override {
+		this->inject = inject;
+		return true;
+	}
 
 	bool execute(LogMessage& logger, Mover& mover, DataManager& dm) override {
 		logger.log(L"开始移动图标操作...");
 
-		// 读取布局文件
 		RatioPointVector ratioPoints;
-		if (!dm.readRatioPointVectorFromFile(ratioPoints, filePath.c_str())) {
+		IconSnapshot moveData;
+		TaskGraph graph;
+
+		// 读取布局文件
+		auto read = graph.add(L"读取布局", [&] {
+			if (!dm.readRatioPointVectorFromFile(ratioPoints, filePath.c_str())) {
+				wcout << L"无法读取布局文件: " << filePath << endl;
+				logger.error(L"错误: 布局文件读取失败: " + filePath);
+				return false;
+			}
+			if (ratioPoints.empty()) {
+				logger.error(L"错误: 文件中无有效数据");
+				wcout << L"没有有效数据" << endl;
+				return false;
+			}
+			logger.log(L"成功读取布局文件: " + filePath + L"，包含 " +
+				to_wstring(ratioPoints.size()) + L" 个点");
+			return true;
+		});
+
+		// 注入 DLL（未被接管时 Application 已经注入过）
+		auto injection = graph.add(L"注入", [&] {
+			if (!this->inject) return true;
+			if (!mover.InjectDLLEx()) {
+				logger.error(L"错误: DLL 注入失败");
+				return false;
+			}
+			return true;
+		});
+
+		// 核对布局指纹：桌面已经是目标布局时，后续阶段全部跳过
+		bool applied = false;
+		auto fingerprint = graph.add(L"核对指纹", [&] {
+			LayoutFingerprint live, target;
+			if (!mover.GetLayoutFingerprint(static_cast<uint32_t>(ratioPoints.size()), live))
+				return true; // 取不到指纹时照常移动
+			target = live; // 使用 Agent 的量化网格
+			dm.ratioPointVectorFingerprint(target, ratioPoints);
+			applied = target.matches(live);
+			if (applied) logger.log(L"布局指纹一致，桌面已经是目标布局");
+			return true;
+		}, { read, injection });
+
+		// 禁用桌面排列功能
+		auto arrange = graph.add(L"禁用排列", [&] {
+			if (applied) return true;
+			if (!mover.DisableAutoArrange()) logger.warning(L"警告: 禁用自动排列失败，操作可能受影响");
+			if (!mover.DisableSnapToGrid()) logger.warning(L"警告: 禁用对齐网格失败，操作可能受影响");
+			return true;
+		}, { fingerprint });
+
+		// 创建临时桌面文件
+		auto placeholders = graph.add(L"创建文件", [&] {
+			if (applied) return true;
+			if (!dm.addFileOnDesktop(ratioPoints.size())) {
+				wcout << L"无法在桌面创建临时文件" << endl;
+				logger.error(L"错误: 无法在桌面创建临时文件");
+				return false;
+			}
+			Sleep(3000); // 等待文件创建
+			logger.log(L"已在桌面创建 " + to_wstring(ratioPoints.size()) + L" 个临时文件");
+			return true;
+		}, { fingerprint });
+
+		// 准备移动数据
+		auto convert = graph.add(L"转换坐标", [&] {
+			dm.ratioPointVectorToRateSnapshot(moveData, ratioPoints);
+			return true;
+		}, { read });
+
+		// 刷新桌面以确保新文件可见
+		auto show = graph.add(L"显示桌面", [&] {
+			if (applied) return true;
+			mover.ShowDesktop();
+			logger.log(L"已刷新桌面");
+			return true;
+		}, { placeholders, arrange });
+
+		// 执行移动操作
+		graph.add(L"移动图标", [&] {
+			if (applied) return true;
+			logger.log(L"开始移动图标...");
+			AnimationParams params = this->animation;
+			params.byRate = 1; // 使用比率坐标
+			if (!(params.duration ? mover.AnimateIcon(moveData, params) : mover.MoveIcon(moveData, true))) { // true 表示使用比率坐标
+				logger.error(L"错误: 图标移动失败");
+				reportAgentError(logger, mover);
+				return false;
+			}
+			logger.log(L"图标移动完成");
+			return true;
+		}, { show, convert });
+
+		const bool result = graph.run();
+		logger.log(L"移动图标各阶段耗时:\n" + graph.report());
+		wcout << L"各阶段耗时:\n" << graph.report();
+		if (!result) return false;
+
+		if (applied) {
+			wcout << L"桌面已经是目标布局，无需移动: " << filePath << L"\n";
+			return true;
+		}
+		wcout << L"成功应用图标布局: " << filePath << L"\n";
+		wcout << L"移动了 " << moveData.size() << L" 个图标\n";
+
+		return true;
+	}
+};
+
+// 保持图标布局：定期检查图标是否偏离目标位置，只纠正偏离的图标
+// @note 按 Ctrl+C 退出
+class WatchLayoutCommand : public Command {
+	wstring filePath;
+	DWORD interval;		// 最短轮询间隔
+	DWORD maxInterval;	// 空闲时退避到的最长轮询间隔
+	int tolerance;		// 允许的偏差（像素）
+
+public:
+	WatchLayoutCommand(const wstring& path, DWORD interval, DWORD maxInterval, int tolerance)
+		: filePath(path), interval(max<DWORD>(interval, 50)), maxInterval(max(this->interval, maxInterval)), tolerance(tolerance) {
+	}
+
+	bool execute(LogMessage& logger, Mover& mover, DataManager& dm) override {
+		logger.log(L"开始保持图标布局...");
+
+		// 目标布局常驻内存
+		RatioPointVector target;
+		if (!dm.readRatioPointVectorFromFile(target, filePath.c_str()) || target.empty()) {
 			wcout << L"无法读取布局文件: " << filePath << endl;
 			logger.error(L"错误: 布局文件读取失败: " + filePath);
 			return false;
 		}
 
-		logger.log(L"成功读取布局文件: " + filePath + L"，包含 " +
-			to_wstring(ratioPoints.size()) + L" 个点");
-
-		// 禁用桌面排列功能
 		if (!mover.DisableAutoArrange()) logger.warning(L"警告: 禁用自动排列失败，操作可能受影响");
 		if (!mover.DisableSnapToGrid()) logger.warning(L"警告: 禁用对齐网格失败，操作可能受影响");
 
-		// 创建临时桌面文件
-		size_t iconCount = ratioPoints.size();
-		if (!dm.addFileOnDesktop(iconCount)) {
-			wcout << L"无法在桌面创建临时文件" << endl;
+		// 只在开始时创建一次占位文件
+		if (!dm.addFileOnDesktop(target.size())) {
 			logger.error(L"错误: 无法在桌面创建临时文件");
 			return false;
 		}
 		Sleep(3000); // 等待文件创建
 
-		logger.log(L"已在桌面创建 " + to_wstring(iconCount) + L" 个临时文件");
+		// 按 Agent 的网格换算目标位置，与 Agent 摆放图标时相同
+		LayoutFingerprint grid;
+		if (!mover.GetLayoutFingerprint(static_cast<uint32_t>(target.size()), grid)) {
+			logger.error(L"错误: 获取桌面网格失败");
+			return false;
+		}
+		const LayoutDiff diff(target, tolerance, grid);
+
+		// 目标布局的指纹：Agent 的指纹与它一致时，桌面就是目标布局
+		// 容差小于指纹的分格时，格内的偏离也要纠正，只能每次读取全部坐标
+		LayoutFingerprint expected = grid;
+		dm.ratioPointVectorFingerprint(expected, target);
+		const bool useFingerprint = pixelToDevicePixel(this->tolerance, grid.dpi) + 1 >= grid.quantum;
+
+		HANDLE stop = stopEvent();
+		ResetEvent(stop);
+		SetConsoleCtrlHandler(onConsoleCtrl, TRUE);
+		mover.SetConsoleTrace(false);
+		wcout << L"正在保持布局 " << filePath << L"（" << target.size() << L" 个图标），按 Ctrl+C 退出" << endl;
+
+		DWORD wait = 0;						// 首次立即检查
+		LayoutFingerprint current, lastFingerprint;	// 上次确认未偏离时的指纹（图标可能在容差内偏离网格）
+		bool haveFingerprint = false;
+		size_t checks = 0, corrections = 0;
+		vector<IconPositionHash> icons;	// 循环中复用，避免反复分配
+		LayoutDiff::Result result;
+		while (WaitForSingleObject(stop, wait) == WAIT_TIMEOUT) {
+			++checks;
+
+			// 指纹由 Agent 计算，只传回几十个字节；与目标或上次确认的指纹一致时不读取全部坐标
+			if (useFingerprint) {
+				if (!mover.GetLayoutFingerprint(static_cast<uint32_t>(target.size()), current)) {
+					logger.warning(L"watch: 获取布局指纹失败，稍后重试");
+					wait = min(wait * 2 + interval, maxInterval);
+					continue;
+				}
+				if (current.matches(expected) || (haveFingerprint && current.matches(lastFingerprint))) {
+					wait = min(max(wait, interval) * 2, maxInterval); // 空闲退避
+					continue;
+				}
+			}
 
-		// 刷新桌面以确保新文件可见
-		mover.ShowDesktop();
-		logger.log(L"已刷新桌面");
+			// 指纹不一致：获取当前位置（只要坐标与名称散列），优先读取 Agent 发布的桌面状态，不占用命令通道
+			if (!(mover.ReadDesktopState(icons) || mover.GetAllPositions(icons)) || icons.empty()) {
+				logger.warning(L"watch: 获取图标位置失败，稍后重试");
+				wait = min(wait * 2 + interval, maxInterval);
+				continue;
+			}
 
-		// 准备移动数据
-		vector<IconPositionMove> moveData(iconCount);
-		dm.ratioPointVectorToRateIconPositionMove(moveData.data(), iconCount, ratioPoints);
+			// 找出偏离的图标
+			diff.compare(icons, result);
+			const IconSnapshot& drifted = result.moves;
+			const size_t missing = result.missing;
+
+			if (drifted.empty()) {
+				lastFingerprint = current;
+				haveFingerprint = useFingerprint;
+				wait = min(max(wait, interval) * 2, maxInterval);
+				if (missing) logger.warning(L"watch: " + to_wstring(missing) + L" 个占位图标不存在");
+				continue;
+			}
+
+			// 只移动偏离的图标
+			++corrections;
+			bool moved = mover.MoveIcon(drifted, true);
+			logger.log(L"watch: 第 " + to_wstring(checks) + L" 次检查发现 " + to_wstring(drifted.size()) +
+				L" 个图标偏离，" + to_wstring(missing) + L" 个缺失，纠正" + (moved ? L"成功" : L"失败"));
+			wcout << L"检测到 " << drifted.size() << L" 个图标偏离，" << missing << L" 个缺失，" << (moved ? L"已纠正" : L"纠正失败") << endl;
+			if (!moved) reportAgentError(logger, mover);
+
+			// 读回确认：刚应用的布局应当读回为未偏离；仍有偏离说明纠正没有生效，退避而不是反复移动
+			if (moved && mover.GetAllPositions(icons)) {
+				diff.compare(icons, result);
+				if (result.moves.empty()) {
+					haveFingerprint = useFingerprint && mover.GetLayoutFingerprint(static_cast<uint32_t>(target.size()), lastFingerprint);
+					wait = interval;	// 有变化时恢复最短间隔
+					continue;
+				}
+				logger.warning(L"watch: 纠正后仍有 " + to_wstring(result.moves.size()) + L" 个图标偏离，延长检查间隔");
+			}
+			haveFingerprint = false;	// 下次重新比较
+			wait = min(max(wait, interval) * 2, maxInterval);
+		}
+
+		SetConsoleCtrlHandler(onConsoleCtrl, FALSE);
+		mover.SetConsoleTrace(true);
+		wcout << L"已停止保持布局：共检查 " << checks << L" 次，纠正 " << corrections << L" 次" << endl;
+		logger.log(L"停止保持布局：共检查 " + to_wstring(checks) + L" 次，纠正 " + to_wstring(corrections) + L" 次");
+		return true;
+	}
+
+private:
+	// @brief 退出事件（手动重置）
+	static HANDLE stopEvent() {
+		static HANDLE event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		return event;
+	}
+
+	static BOOL WINAPI onConsoleCtrl(DWORD type) {
+		if (type != CTRL_C_EVENT && type != CTRL_BREAK_EVENT) return FALSE;
+		SetEvent(stopEvent());
+		return TRUE;
+	}
+};
+
+// 按差异应用布局：先批量获取当前位置，只移动偏离目标超过容差的图标
+// @note 重复应用相同的布局时几乎不产生 ListView 写入
+class ApplyLayoutCommand : public Command {
+	wstring filePath;
+	int tolerance;		// 允许的偏差（像素）
 
-		if (moveData.empty()) {
-			logger.error(L"错误: 文件中无有效数据");
-			wcout << L"没有有效数据" << endl;
+public:
+	ApplyLayoutCommand(const wstring& path, int tolerance)
+		: filePath(path), tolerance(tolerance) {
+	}
+
+	bool execute(LogMessage& logger, Mover& mover, DataManager& dm) override {
+		logger.log(L"开始按差异应用布局...");
+
+		RatioPointVector target;
+		if (!dm.readRatioPointVectorFromFile(target, filePath.c_str()) || target.empty()) {
+			wcout << L"无法读取布局文件: " << filePath << endl;
+			logger.error(L"错误: 布局文件读取失败: " + filePath);
 			return false;
 		}
 
-		// 执行移动操作
-		logger.log(L"开始移动图标...");
-		if (!mover.MoveIcon(moveData.data(), iconCount, true)) { // true 表示使用比率坐标
+		if (!mover.DisableAutoArrange()) logger.warning(L"警告: 禁用自动排列失败，操作可能受影响");
+		if (!mover.DisableSnapToGrid()) logger.warning(L"警告: 禁用对齐网格失败，操作可能受影响");
+
+		// 按 Agent 的网格换算目标位置，与 Agent 摆放图标时相同
+		LayoutFingerprint grid;
+		if (!mover.GetLayoutFingerprint(static_cast<uint32_t>(target.size()), grid)) {
+			logger.error(L"错误: 获取桌面网格失败");
+			return false;
+		}
+		const LayoutDiff diff(target, tolerance, grid);
+		LayoutDiff::Result result;
+		vector<IconPositionHash> icons;
+		if (!this->compare(mover, diff, icons, result)) {
+			logger.error(L"错误: 获取图标位置失败");
+			return false;
+		}
+
+		// 只有缺少占位图标时才创建文件，已存在的图标不受影响
+		if (result.missing) {
+			logger.log(L"apply: " + to_wstring(result.missing) + L" 个占位图标不存在，创建临时文件");
+			if (!dm.addFileOnDesktop(target.size())) {
+				wcout << L"无法在桌面创建临时文件" << endl;
+				logger.error(L"错误: 无法在桌面创建临时文件");
+				return false;
+			}
+			Sleep(3000); // 等待文件创建
+			mover.ShowDesktop();
+			if (!this->compare(mover, diff, icons, result)) {
+				logger.error(L"错误: 获取图标位置失败");
+				return false;
+			}
+		}
+
+		// 只移动偏离的图标
+		if (!result.moves.empty() && !mover.MoveIcon(result.moves, true)) {
+			wcout << L"移动图标失败" << endl;
 			logger.error(L"错误: 图标移动失败");
+			reportAgentError(logger, mover);
 			return false;
 		}
-		logger.log(L"图标移动完成");
 
-		wcout << L"成功应用图标布局: " << filePath << L"\n";
-		wcout << L"移动了 " << iconCount << L" 个图标\n";
+		logger.log(L"apply: 共 " + to_wstring(diff.size()) + L" 个图标，跳过 " + to_wstring(result.inPlace) +
+			L" 个，移动 " + to_wstring(result.moves.size()) + L" 个，缺失 " + to_wstring(result.missing) + L" 个");
+		wcout << L"已应用布局 " << filePath << L"：跳过 " << result.inPlace << L" 个，移动 " << result.moves.size()
+			<< L" 个，缺失 " << result.missing << L" 个" << endl;
+		return true;
+	}
+
+private:
+	// @brief 批量获取当前位置并与目标比较
+	// @note 一次性命令要求位置是最新的，优先直接向 Agent 查询，发布的桌面状态只作后备
+	static bool compare(Mover& mover, const LayoutDiff& diff, vector<IconPositionHash>& icons, LayoutDiff::Result& result) {
+		if (!(mover.GetAllPositions(icons) || mover.ReadDesktopState(icons))) return false;
+		diff.compare(icons, result);
+		return true;
+	}
+};
+
+// 对比两个布局文件，diff 与 merge 共用
+// @note [IconPositionMove Data] 文件按名称配对，无名的 RatioPointVector 文件按最近邻配对
+class LayoutPairCommand : public Command {
+protected:
+	wstring basePath;	// 旧布局 / 基础布局
+	wstring filePath;	// 新布局 / 部分布局
+	int tolerance;		// 视为未移动的偏差（像素）
+	int radius;			// 无名布局中视为同一个图标移动的最大距离（像素）
+
+	bool named = false;	// 是否为带名称的布局
+	IconSnapshot baseIcons, otherIcons;
+	RatioPointVector basePoints, otherPoints;
+	LayoutChanges changes;
+
+	LayoutPairCommand(const wstring& base, const wstring& path, int tolerance, int radius)
+		: basePath(base), filePath(path), tolerance(tolerance), radius(radius) {
+	}
+
+	// @brief 读取两个文件并对比
+	bool compare(LogMessage& logger, DataManager& dm) {
+		if (dm.readSnapshotFromFile(this->baseIcons, this->basePath.c_str())) {
+			this->named = true;
+			if (!dm.readSnapshotFromFile(this->otherIcons, this->filePath.c_str())) {
+				wcout << L"无法读取布局文件，或两个文件的格式不同: " << this->filePath << endl;
+				logger.error(L"错误: 布局文件读取失败: " + this->filePath);
+				return false;
+			}
+			dm.diffSnapshots(this->baseIcons, this->otherIcons, this->tolerance, this->changes);
+			return true;
+		}
+
+		if (!dm.readRatioPointVectorFromFile(this->basePoints, this->basePath.c_str()) ||
+			!dm.readRatioPointVectorFromFile(this->otherPoints, this->filePath.c_str())) {
+			wcout << L"无法读取布局文件，或两个文件的格式不同" << endl;
+			logger.error(L"错误: 布局文件读取失败: " + this->basePath + L", " + this->filePath);
+			return false;
+		}
+		// 比率坐标的容差与半径：X 按屏幕宽、Y 按屏幕高换算
+		const int cx = GetSystemMetrics(SM_CXSCREEN);
+		const int cy = GetSystemMetrics(SM_CYSCREEN);
+		dm.diffRatioPointVectors(this->basePoints, this->otherPoints,
+			{ pixelToQ16(this->tolerance, cx), pixelToQ16(this->tolerance, cy) },
+			{ pixelToQ16(this->radius, cx), pixelToQ16(this->radius, cy) }, this->changes);
+		return true;
+	}
+
+	wstring summary() const {
+		return L"未变 " + to_wstring(this->changes.unchanged) + L" 个，移动 " + to_wstring(this->changes.moved.size()) +
+			L" 个，新增 " + to_wstring(this->changes.added.size()) + L" 个，删除 " + to_wstring(this->changes.removed.size()) + L" 个";
+	}
+};
+
+// 对比布局：输出从 --base 到 --file 的移动、新增、删除
+class DiffLayoutCommand : public LayoutPairCommand {
+	wstring outPath;		// 差异写入的文件，为空时不写
+	bool outputToConsole;	// 是否逐项输出到控制台
+
+public:
+	DiffLayoutCommand(const wstring& base, const wstring& path, int tolerance, int radius, const wstring& out, bool output)
+		: LayoutPairCommand(base, path, tolerance, radius), outPath(out), outputToConsole(output) {
+	}
+
+	bool execute(LogMessage& logger, Mover&, DataManager& dm) override {
+		logger.log(L"开始对比布局文件...");
+		PhaseTimer timer;
+		if (!this->compare(logger, dm)) return false;
+
+		if (this->outputToConsole || !this->outPath.empty()) {
+			wstring text;
+			if (this->named) dm.describeChanges(text, this->baseIcons, this->otherIcons, this->changes);
+			else dm.describeChanges(text, this->basePoints, this->otherPoints, this->changes);
+			if (this->outputToConsole) wcout << text;
+			if (!this->outPath.empty() && !dm.writeTextToFile(text, this->outPath.c_str())) {
+				logger.error(L"错误: 差异保存失败: " + this->outPath);
+				return false;
+			}
+		}
+
+		logger.log(L"布局对比完成: " + this->summary() + L"，用时 " + to_wstring(static_cast<int>(timer.total())) + L" ms");
+		wcout << this->basePath << L" -> " << this->filePath << L"：" << this->summary() << endl;
+		return true;
+	}
+};
+
+// 合并布局：把 --file 中的部分布局合并进 --base，写入 --out
+// @note 两边都有的图标取 --file 中的位置，只在 --file 中的图标追加，只在 --base 中的图标保留
+class MergeLayoutCommand : public LayoutPairCommand {
+	wstring outPath;
+
+public:
+	MergeLayoutCommand(const wstring& base, const wstring& path, int tolerance, int radius, const wstring& out)
+		: LayoutPairCommand(base, path, tolerance, radius), outPath(out) {
+	}
 
+	bool execute(LogMessage& logger, Mover&, DataManager& dm) override {
+		logger.log(L"开始合并布局文件...");
+		PhaseTimer timer;
+		if (!this->compare(logger, dm)) return false;
+
+		bool written;
+		size_t total;
+		if (this->named) {
+			IconSnapshot merged;
+			dm.mergeSnapshots(merged, this->baseIcons, this->otherIcons, this->changes);
+			written = dm.writeSnapshotToFile(merged, this->outPath.c_str());
+			total = merged.size();
+		}
+		else {
+			RatioPointVector merged;
+			dm.mergeRatioPointVectors(merged, this->basePoints, this->otherPoints, this->changes);
+			written = dm.writeRatioPointVectorToFile(merged, this->outPath.c_str());
+			total = merged.size();
+		}
+		if (!written) {
+			wcout << L"无法写入: " << this->outPath << endl;
+			logger.error(L"错误: 合并结果保存失败: " + this->outPath);
+			return false;
+		}
+
+		logger.log(L"布局合并完成: " + this->summary() + L"，共 " + to_wstring(total) + L" 个图标，用时 " +
+			to_wstring(static_cast<int>(timer.total())) + L" ms");
+		wcout << L"已合并到 " << this->outPath << L"（共 " << total << L" 个图标）：" << this->summary() << endl;
 		return true;
 	}
 };
 
+// 打包关键帧：把多个布局文件依次作为关键帧写入一个动画文件
+class PackKeyframesCommand : public Command {
+	wstring filePath;
+	wstring frames;		// 布局文件列表，以 ; 分隔
+	DWORD frameTime;	// 每帧持续时间（毫秒）
+
+public:
+	PackKeyframesCommand(const wstring& path, const wstring& frames, DWORD frameTime)
+		: filePath(path), frames(frames), frameTime(frameTime) {
+	}
+
+	bool execute(LogMessage& logger, Mover&, DataManager& dm) override {
+		vector<wstring> layouts;
+		wstringstream stream(frames);
+		wstring layout;
+		while (getline(stream, layout, L';'))
+			if (!layout.empty()) layouts.push_back(layout);
+
+		if (!dm.writeKeyframesToFile(layouts, frameTime, filePath.c_str())) {
+			wcout << L"打包失败：布局文件无法读取或图标数量不一致" << endl;
+			logger.error(L"错误: 关键帧打包失败: " + frames);
+			return false;
+		}
+		logger.log(L"已将 " + to_wstring(layouts.size()) + L" 个布局打包为关键帧文件: " + filePath);
+		wcout << L"已将 " << layouts.size() << L" 个布局打包到: " << filePath << endl;
+		return true;
+	}
+};
+
+// 播放关键帧动画
+// @note 文件以内存映射方式打开，边播放边解码；按 Ctrl+C 停止
+// @note stream 为 true 时通过帧流推送整帧（不占用主通道，Agent 跟不上时只应用最新的一帧），
+//			帧流不可用时退回逐帧发送移动命令
+class PlayKeyframesCommand : public Command {
+	wstring filePath;
+	bool stream;
+
+public:
+	explicit PlayKeyframesCommand(const wstring& path, bool stream = false) : filePath(path), stream(stream) {}
+
+	bool execute(LogMessage& logger, Mover& mover, DataManager& dm) override {
+		MappedFile file;
+		KeyframeDecoder decoder;
+		if (!file.open(filePath.c_str()) || !decoder.open(file.data(), file.size())) {
+			wcout << L"无法读取关键帧文件: " << filePath << endl;
+			logger.error(L"错误: 关键帧文件无效: " + filePath);
+			return false;
+		}
+		const KeyframeHeader& header = decoder.header();
+		logger.log(L"关键帧文件: " + filePath + L"，" + to_wstring(header.iconCount) + L" 个图标，" +
+			to_wstring(header.frameCount) + L" 帧，" + to_wstring(file.size()) + L" 字节");
+
+		if (!mover.DisableAutoArrange()) logger.warning(L"警告: 禁用自动排列失败，操作可能受影响");
+		if (!mover.DisableSnapToGrid()) logger.warning(L"警告: 禁用对齐网格失败，操作可能受影响");
+		if (!dm.addFileOnDesktop(header.iconCount)) {
+			logger.error(L"错误: 无法在桌面创建临时文件");
+			return false;
+		}
+		Sleep(3000); // 等待文件创建
+		mover.ShowDesktop();
+
+		// 帧流：维护整帧，每次发送时把变化并入后推送
+		FrameStream frameStream(logger);
+		vector<IconPositionHash> frame;
+		if (this->stream) {
+			if (header.iconCount > MAX_STREAM_ICON_COUNT || !frameStream.open()) {
+				logger.warning(L"警告: 帧流不可用，改为逐帧发送移动命令");
+			}
+			else {
+				frame.resize(header.iconCount);
+				for (uint32_t i = 0; i < header.iconCount; ++i) {
+					const wstring name = to_wstring(i);
+					frame[i] = { 0, 0, hashName(name.c_str(), name.size()) };
+				}
+			}
+		}
+		auto sendFrame = [&](const IconSnapshot& changed) {
+			if (!frameStream.isOpen()) return mover.MoveIcon(changed, true);
+			for (size_t i = 0; i < changed.size(); ++i) {
+				IconPositionHash& icon = frame[_wtoi(changed.name(i))];
+				icon.x = changed[i].p.x;
+				icon.y = changed[i].p.y;
+			}
+			return frameStream.submit(frame.data(), frame.size(), true) != FrameStream::SubmitResult::SUBMIT_FAILED;
+		};
+
+		wcout << L"正在播放 " << filePath << L"（" << header.frameCount << L" 帧，" << header.iconCount << L" 个图标" <<
+			(frameStream.isOpen() ? L"，帧流" : L"") << L"）" << endl;
+		mover.SetConsoleTrace(false);
+		KeyframePlayer player(decoder);
+		const bool result = player.play(sendFrame, [&] { return mover.IsCancelled(); });
+		mover.SetConsoleTrace(true);
+
+		logger.log(L"播放结束: " + player.summary());
+		wcout << L"播放" << (result ? L"完成" : L"中止") << L"：" << player.summary() << endl;
+		if (frameStream.isOpen()) {
+			if (!frameStream.waitApplied(CURRENT_OPERATION_TIMEOUT)) logger.warning(L"警告: 最后一帧没有及时应用");
+			logger.log(L"帧流: " + frameStream.summary());
+			wcout << L"帧流：" << frameStream.summary() << endl;
+		}
+		if (player.isCorrupted()) wcout << L"关键帧文件不完整" << endl;
+		return result;
+	}
+};
+
 // 清理桌面
 class ClearDesktopCommand : public Command {
 public:
@@ -336,6 +864,20 @@ public:
 	}
 };
 
+// 等待一段时间（主要用于脚本）
+class WaitCommand : public Command {
+	DWORD milliseconds;
+
+public:
+	explicit WaitCommand(DWORD ms) : milliseconds(ms) {}
+
+	bool execute(LogMessage& logger, Mover&, DataManager&) override {
+		logger.log(L"等待 " + to_wstring(milliseconds) + L" 毫秒");
+		Sleep(milliseconds);
+		return true;
+	}
+};
+
 // 卸载DLL
 class UnsetCommand : public Command {
 public:
@@ -357,6 +899,25 @@ public:
 		wstring filePath = L".\\rikka.bin";
 		wstring sortMode;
 		wstring injectMode = L"auto";
+		wstring scriptPath;
+		wstring sendRequest;
+		DWORD waitTime = 1000;
+		DWORD watchInterval = 1000;
+		DWORD watchMaxInterval = 30000;
+		int tolerance = LAYOUT_TOLERANCE;
+		int radius = 64;
+		wstring basePath;
+		wstring outPath;
+		uint32_t sliceBudget = DEFAULT_SLICE_BUDGET;
+		DWORD animate = 0;
+		uint32_t framesPerSecond = ANIMATION_DEFAULT_FPS;
+		wstring easing = L"ease-in-out";
+		wstring frames;
+		DWORD frameTime = 100;
+		bool stream = false;
+		bool serve = false;
+		bool probeCache = false;
+		bool showTiming = false;
 		bool outputToConsole = false;
 		bool showHelp = false;
 		bool noFootprint = false;
@@ -372,18 +933,93 @@ public:
 		if (options.injectMode == L"unset")					return unique_ptr<Command>(new UnsetCommand());
 		if (options.operationMode == L"save")				return unique_ptr<Command>(new SaveLayoutCommand(options.filePath, options.sortMode, options.outputToConsole));
 		if (options.operationMode == L"save-full")			return unique_ptr<Command>(new SaveFullLayoutCommand(options.filePath, options.sortMode, options.outputToConsole));
-		if (options.operationMode == L"move")				return unique_ptr<Command>(new MoveIconsCommand(options.filePath));
+		if (options.operationMode == L"move")				return unique_ptr<Command>(new MoveIconsCommand(options.filePath, animationParams()));
 		if (options.operationMode == L"sort")				return unique_ptr<Command>(new SortLayoutCommand(options.filePath, options.sortMode));
 		if (options.operationMode == L"clear")				return unique_ptr<Command>(new ClearDesktopCommand());
 		if (options.operationMode == L"666")				return unique_ptr<Command>(new Special666Command());
 		if (options.operationMode == L"windows")			return unique_ptr<Command>(new SpecialWindowsCommand());
 		if (options.operationMode == L"clearlog")			return unique_ptr<Command>(new ClearLogFileCommand());
 		if (options.operationMode == L"restart-explorer")	return unique_ptr<Command>(new RestartExplorerCommand());
+		if (options.operationMode == L"wait")				return unique_ptr<Command>(new WaitCommand(options.waitTime));
+		if (options.operationMode == L"watch")				return unique_ptr<Command>(new WatchLayoutCommand(options.filePath, options.watchInterval, options.watchMaxInterval, options.tolerance));
+		if (options.operationMode == L"apply")				return unique_ptr<Command>(new ApplyLayoutCommand(options.filePath, options.tolerance));
+		if (options.operationMode == L"diff")				return unique_ptr<Command>(new DiffLayoutCommand(options.basePath, options.filePath, options.tolerance, options.radius, options.outPath, options.outputToConsole));
+		if (options.operationMode == L"merge")				return unique_ptr<Command>(new MergeLayoutCommand(options.basePath, options.filePath, options.tolerance, options.radius, options.outPath));
+		if (options.operationMode == L"play")				return unique_ptr<Command>(new PlayKeyframesCommand(options.filePath, options.stream));
+		if (options.operationMode == L"pack")				return unique_ptr<Command>(new PackKeyframesCommand(options.filePath, options.frames, options.frameTime));
 		return nullptr;
 	}
 
+	// @brief 该操作模式在 auto 注入模式下是否需要注入 DLL
+	static bool needsInjection(const wstring& operationMode) {
+		return operationMode == L"save"
+			|| operationMode == L"save-full"
+			|| operationMode == L"move"
+			|| operationMode == L"watch"
+			|| operationMode == L"apply"
+			|| operationMode == L"play"
+			|| operationMode == L"clearlog";
+	}
+
+	// @brief 把一行命令解析为命令对象（脚本、服务模式使用）
+	// @param line 一行命令，写法与命令行参数相同
+	// @param options 输出解析后的选项
+	// @ret 命令对象；参数无效或无法创建命令时返回 nullptr
+	static unique_ptr<Command> parseLine(const wstring& line, Options& options) {
+		vector<wstring> args = splitArguments(line);
+		if (args.empty()) return nullptr;
+
+		// 组装成 argv，argv[0] 为占位的程序名
+		vector<wchar_t*> argv;
+		wstring program = L"Mover";
+		argv.push_back(&program[0]);
+		for (auto& arg : args) argv.push_back(&arg[0]);
+
+		try {
+			CommandLineParser parser(static_cast<int>(argv.size()), argv.data());
+			options = parser.getOptions();
+			return parser.createCommand();
+		}
+		catch (const runtime_error&) {
+			return nullptr;
+		}
+	}
+
+	// @brief 把一行命令拆分为参数，支持双引号包裹含空格的参数
+	static vector<wstring> splitArguments(const wstring& line) {
+		vector<wstring> args;
+		wstring current;
+		bool inQuotes = false, hasToken = false;
+		for (wchar_t c : line) {
+			if (c == L'"') {
+				inQuotes = !inQuotes;
+				hasToken = true;
+			}
+			else if (iswspace(c) && !inQuotes) {
+				if (hasToken) args.push_back(current);
+				current.clear();
+				hasToken = false;
+			}
+			else {
+				current += c;
+				hasToken = true;
+			}
+		}
+		if (hasToken) args.push_back(current);
+		return args;
+	}
+
 	const Options& getOptions() const { return options; }
 
+	// @brief 由 --animate、--fps、--easing 组成的动画参数
+	AnimationParams animationParams() const {
+		AnimationParams params;
+		params.duration = options.animate;
+		params.framesPerSecond = options.framesPerSecond;
+		easingFromName(options.easing.c_str(), params.easing);
+		return params;
+	}
+
 	const int& getArgc() const { return argc; }
 
 	const wchar_t* getArgv() const { return *argv; }
@@ -395,25 +1031,61 @@ public:
 		wcout << L"      save       保存当前图标布局到文件\n";
 		wcout << L"      save-full  保存完整图标数据到文件\n"; // 添加 save-full 说明
 		wcout << L"      move       从文件加载布局并移动图标\n";
+		wcout << L"      apply      从文件加载布局，只移动偏离的图标\n";
+		wcout << L"      diff       对比 --base 与 --file，列出移动、新增、删除的图标\n";
+		wcout << L"      merge      把 --file 中的部分布局合并进 --base，写入 --out\n";
 		wcout << L"      sort       对布局文件进行排序\n";
 		wcout << L"      clear      清理桌面临时文件\n";
 		wcout << L"      clearlog   清理日志文件\n";
+		wcout << L"      watch      保持文件中的布局，自动纠正偏离的图标\n";
+		wcout << L"      wait       等待 --time 毫秒（用于脚本）\n";
+		wcout << L"      play       播放关键帧动画文件\n";
+		wcout << L"      pack       把 --frames 中的布局文件依次打包为关键帧动画文件\n";
 		wcout << L"  --file=路径    设置布局文件路径(默认: .\\rikka.bin)\n";
 		wcout << L"	     mover::    使用内置文件\n";
 		wcout << L"			happy birthday\n";
 		wcout << L"  --output       输出数据到控制台(save/save-full模式)\n";
+		wcout << L"  --script=路径  依次执行脚本中的命令，只注入一次\n";
+		wcout << L"                 每行一条命令，写法同命令行参数，# 开头为注释\n";
+		wcout << L"  --serve        常驻服务，通过命名管道 " << PIPE_NAME << L" 接收命令\n";
+		wcout << L"  --send=命令    把命令交给正在运行的服务执行，如 --send=\"--mode=save --file=a.bin\"\n";
+		wcout << L"                 --send=shutdown 停止服务\n";
 
 		wcout << L"\n高级选项:\n";
 		wcout << L"  --sort=模式    排序模式(X_ASC, X_DESC, Y_ASC, Y_DESC)\n";
 		wcout << L"  --inject=模式  DLL注入模式(true/false/auto/unset)\n";
+		wcout << L"  --time=毫秒    wait 模式的等待时间(默认: 1000)\n";
+		wcout << L"  --interval=毫秒      watch 模式的轮询间隔(默认: 1000)\n";
+		wcout << L"  --max-interval=毫秒  watch 模式空闲时退避到的最长间隔(默认: 30000)\n";
+		wcout << L"  --tolerance=像素     watch/apply/diff/merge 模式允许的位置偏差(默认: 2)\n";
+		wcout << L"  --slice-budget=微秒  批量移动每个时间片的预算，片间让出给 explorer(默认: " << DEFAULT_SLICE_BUDGET << L"，0 为不分片)\n";
+		wcout << L"  --animate=毫秒       move 模式平滑移动图标的时长(默认: 0，直接移动)\n";
+		wcout << L"  --fps=帧率           平滑移动的目标帧率(默认: " << ANIMATION_DEFAULT_FPS << L"，最高 " << ANIMATION_MAX_FPS << L")\n";
+		wcout << L"  --easing=曲线        平滑移动的缓动曲线(linear, ease-out, ease-in-out，默认: ease-in-out)\n";
+		wcout << L"  --frames=文件1;文件2 pack 模式的布局文件，每个文件为一帧\n";
+		wcout << L"  --frame-time=毫秒    pack 模式每帧的持续时间(默认: 100)\n";
+		wcout << L"  --stream             play 模式通过帧流推送整帧，Agent 跟不上时只应用最新的一帧\n";
+		wcout << L"  --base=路径          diff/merge 模式的基础布局\n";
+		wcout << L"  --out=路径           merge 模式的输出文件；diff 模式把差异写入该文件\n";
+		wcout << L"  --radius=像素        diff/merge 无名布局中视为同一个图标移动的最大距离(默认: 64)\n";
+		wcout << L"  --probe-cache  缓存系统版本探测结果（本次开机内有效）\n";
+		wcout << L"  --timing       输出启动各阶段耗时\n";
 		wcout << L"  --help        显示帮助信息\n";
 
 		wcout << L"\n示例:\n";
 		wcout << L"  MoverApp --mode=save --file=my_layout.bin --output\n";
 		wcout << L"  MoverApp --mode=save-full --file=full_data.bin\n"; // 添加示例
 		wcout << L"  MoverApp --mode=move --file=my_layout.bin\n";
+		wcout << L"  MoverApp --mode=move --file=mover::happybirthday --animate=800\n";
 		wcout << L"  MoverApp --mode=sort --sort=X_ASC --file=layout.bin\n";
 		wcout << L"  MoverApp --mode=clear\n";
+		wcout << L"  MoverApp --mode=watch --file=my_layout.bin --interval=500\n";
+		wcout << L"  MoverApp --mode=apply --file=my_layout.bin --tolerance=4\n";
+		wcout << L"  MoverApp --mode=diff --base=team_v1.bin --file=team_v2.bin --output\n";
+		wcout << L"  MoverApp --mode=merge --base=team.bin --file=mine.bin --out=merged.bin\n";
+		wcout << L"  MoverApp --mode=pack --file=anim.dimk --frames=a.bin;b.bin;c.bin --frame-time=200\n";
+		wcout << L"  MoverApp --mode=play --file=anim.dimk --stream\n";
+		wcout << L"  MoverApp --script=batch.txt --no-footprint\n";
 	}
 
 private:
@@ -460,6 +1132,63 @@ private:
 			else if (key == L"--no-footprint") {
 				options.noFootprint = true;
 			}
+			else if (key == L"--script") {
+				options.scriptPath = value;
+			}
+			else if (key == L"--serve") {
+				options.serve = true;
+			}
+			else if (key == L"--send") {
+				options.sendRequest = value;
+			}
+			else if (key == L"--probe-cache") {
+				options.probeCache = true;
+			}
+			else if (key == L"--timing") {
+				options.showTiming = true;
+			}
+			else if (key == L"--time") {
+				options.waitTime = static_cast<DWORD>(_wtoi(value.c_str()));
+			}
+			else if (key == L"--interval") {
+				options.watchInterval = static_cast<DWORD>(_wtoi(value.c_str()));
+			}
+			else if (key == L"--max-interval") {
+				options.watchMaxInterval = static_cast<DWORD>(_wtoi(value.c_str()));
+			}
+			else if (key == L"--tolerance") {
+				options.tolerance = max(0, _wtoi(value.c_str()));
+			}
+			else if (key == L"--slice-budget") {
+				options.sliceBudget = static_cast<uint32_t>(max(0, _wtoi(value.c_str())));
+			}
+			else if (key == L"--animate") {
+				options.animate = static_cast<DWORD>(max(0, _wtoi(value.c_str())));
+			}
+			else if (key == L"--fps") {
+				options.framesPerSecond = static_cast<uint32_t>(max(0, _wtoi(value.c_str())));
+			}
+			else if (key == L"--easing") {
+				options.easing = toLower(value);
+			}
+			else if (key == L"--frames") {
+				options.frames = value;
+			}
+			else if (key == L"--base") {
+				options.basePath = value;
+			}
+			else if (key == L"--out") {
+				options.outPath = value;
+			}
+			else if (key == L"--radius") {
+				options.radius = max(0, _wtoi(value.c_str()));
+			}
+			else if (key == L"--stream") {
+				options.stream = true;
+			}
+			else if (key == L"--frame-time") {
+				options.frameTime = static_cast<DWORD>(max(0, _wtoi(value.c_str())));
+			}
 		}
 
 		try {
@@ -487,7 +1216,8 @@ private:
 
 		// 验证操作模式
 		static const vector<wstring> validModes = {
-			L"save", L"save-full", L"move", L"sort", L"clear", L"666", L"windows", L"clearlog", L"restart-explorer"
+			L"save", L"save-full", L"move", L"sort", L"clear", L"666", L"windows", L"clearlog", L"restart-explorer", L"wait", L"watch",
+			L"play", L"pack", L"apply", L"diff", L"merge"
 		};
 
 		if (!options.operationMode.empty() &&
@@ -495,6 +1225,33 @@ private:
 			throw runtime_error("无效的操作模式");
 		}
 
+		if (options.operationMode == L"pack" && options.frames.empty()) {
+			throw runtime_error("pack 模式需要 --frames");
+		}
+		if ((options.operationMode == L"diff" || options.operationMode == L"merge") && options.basePath.empty()) {
+			throw runtime_error(toNarrow(options.operationMode) + " 模式需要 --base");
+		}
+		if (options.operationMode == L"merge" && options.outPath.empty()) {
+			throw runtime_error("merge 模式需要 --out");
+		}
+
+		// 验证动画参数
+		Easing easing;
+		if (!easingFromName(options.easing.c_str(), easing)) {
+			throw runtime_error("无效的缓动曲线");
+		}
+		if (options.framesPerSecond == 0 || options.framesPerSecond > ANIMATION_MAX_FPS) {
+			throw runtime_error("帧率必须在 1 ~ " + to_string(ANIMATION_MAX_FPS) + " 之间");
+		}
+		if (options.animate > ANIMATION_MAX_DURATION) {
+			throw runtime_error("动画时长不能超过 " + to_string(ANIMATION_MAX_DURATION) + " 毫秒");
+		}
+
+		// 脚本、服务、单条命令互斥
+		if ((!options.scriptPath.empty()) + options.serve + (!options.sendRequest.empty()) + (!options.operationMode.empty()) > 1) {
+			throw runtime_error("--mode、--script、--serve、--send 只能使用其中一个");
+		}
+
 		// 验证注入模式
 		static const vector<wstring> validInjectModes = {
 			L"true", L"false", L"auto", L"unset"
@@ -545,20 +1302,204 @@ private:
 	DataManager& dm;
 };
 
+// 批处理脚本：预先解析全部命令，在同一进程中依次执行，只注入一次
+// @note 脚本格式：每行一条命令，写法与命令行参数相同；空行与 # 开头的行被忽略
+//			--mode=save --file=a.bin
+//			--mode=wait --time=500
+//			--mode=move --file="my layout.bin"
+class ScriptCommand : public Command {
+	struct Step {
+		wstring line;
+		unique_ptr<Command> command;
+		bool needsInjection;
+	};
+
+	wstring filePath;
+	vector<Step> steps;
+
+public:
+	// @brief 读取并解析脚本
+	// @note 任意一行解析失败都会抛出 runtime_error，不会执行任何命令
+	explicit ScriptCommand(const wstring& path) : filePath(path) {
+		wifstream file(path, ios::in);
+		if (!file.is_open()) throw runtime_error("无法打开脚本文件");
+
+		wstring line;
+		for (size_t lineNumber = 1; getline(file, line); ++lineNumber) {
+			vector<wstring> args = CommandLineParser::splitArguments(line);
+			if (args.empty() || args[0][0] == L'#') continue;
+
+			CommandLineParser::Options options;
+			unique_ptr<Command> command = CommandLineParser::parseLine(line, options);
+			if (!command) {
+				wcout << L"脚本第 " << lineNumber << L" 行无效: " << line << endl;
+				throw runtime_error("脚本解析失败");
+			}
+
+			bool injection = options.injectMode == L"true" ||
+				(options.injectMode == L"auto" && CommandLineParser::needsInjection(options.operationMode));
+			steps.push_back({ line, move(command), injection });
+		}
+	}
+
+	// @brief 脚本中是否有命令需要注入 DLL
+	bool needsInjection() const {
+		return any_of(steps.begin(), steps.end(), [](const Step& step) { return step.needsInjection; });
+	}
+
+	size_t size() const { return steps.size(); }
+
+	bool execute(LogMessage& logger, Mover& mover, DataManager& dm) override {
+		logger.log(L"开始执行脚本: " + filePath + L"，共 " + to_wstring(steps.size()) + L" 条命令");
+		CommandExecutor executor(mover, logger, dm);
+
+		using clock = chrono::steady_clock;
+		const auto scriptStart = clock::now();
+		size_t executed = 0;
+		bool result = true;
+		for (auto& step : steps) {
+			const auto start = clock::now();
+			bool success = executor.execute(move(step.command));
+			const double ms = chrono::duration<double, milli>(clock::now() - start).count();
+			++executed;
+
+			wcout << L"[" << executed << L"/" << steps.size() << L"] " << step.line
+				<< L" -> " << (success ? L"成功" : L"失败") << L"，用时 " << ms << L" ms" << endl;
+			logger.log(L"脚本命令 " + step.line + (success ? L" 成功" : L" 失败") + L"，用时 " + to_wstring(ms) + L" ms");
+
+			if (!success) { // 遇到失败立即停止，后续命令可能依赖它的结果
+				result = false;
+				break;
+			}
+		}
+
+		const double total = chrono::duration<double, milli>(clock::now() - scriptStart).count();
+		wcout << L"脚本执行完成: " << executed << L" 条命令，总用时 " << total << L" ms，平均每条 "
+			<< (executed ? total / executed : 0.0) << L" ms" << endl;
+		return result;
+	}
+};
+
+// 常驻服务：保持 Mover 与注入会话，通过命名管道接收命令并复用各个 Command 执行
+// @note 每个请求是一行命令（写法同命令行参数），"shutdown" 停止服务
+// @note 多个客户端的请求按到达顺序串行执行，输出（wcout）随响应返回给客户端
+class ServeCommand : public Command {
+	FairMutex executionLock;
+
+public:
+	bool execute(LogMessage& logger, Mover& mover, DataManager& dm) override {
+		PipeServer server(logger);
+		CommandExecutor executor(mover, logger, dm);
+
+		wcout << L"服务已启动: " << PIPE_NAME << endl;
+		logger.log(L"服务已启动: " + wstring(PIPE_NAME));
+
+		bool result = server.serve([&](const wstring& request, wstring& response) -> int {
+			if (request == L"shutdown") {
+				logger.log(L"收到停止服务请求");
+				response = L"服务已停止";
+				server.stopAfterReply();
+				return EXIT_SUCCESS;
+			}
+			return this->dispatch(request, response, logger, executor);
+		});
+
+		logger.log(L"服务已停止");
+		return result;
+	}
+
+private:
+	// @brief 执行一条请求
+	int dispatch(const wstring& request, wstring& response, LogMessage& logger, CommandExecutor& executor) {
+		lock_guard<FairMutex> turn(this->executionLock);
+
+		// 在锁内把 wcout 重定向到缓冲区，参数错误的提示也能返回给客户端
+		struct OutputCapture {
+			wostringstream buffer;
+			wstreambuf* previous;
+			OutputCapture() : previous(wcout.rdbuf(buffer.rdbuf())) {}
+			~OutputCapture() { wcout.rdbuf(previous); }
+		} capture;
+
+		const auto start = chrono::steady_clock::now();
+		CommandLineParser::Options options;
+		unique_ptr<Command> command = CommandLineParser::parseLine(request, options);
+		if (!command && !options.scriptPath.empty())
+			command = make_unique<ScriptCommand>(options.scriptPath);
+
+		bool success = false;
+		if (!command) wcout << L"无效的请求: " << request << endl;
+		else success = executor.execute(move(command));
+
+		const double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		logger.log(L"服务请求 " + request + (success ? L" 成功" : L" 失败") + L"，用时 " + to_wstring(ms) + L" ms");
+
+		response = capture.buffer.str();
+		return success ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+};
+
 // 主程序集成
 class Application {
 public:
-	Application(int argc, wchar_t* argv[])
-		: parser(argc, argv), executor(mover, logger, dm) {
+	// @param logger、mover、probe、startup 由 Main 创建，与环境检测共用
+	Application(int argc, wchar_t* argv[], LogMessage& logger, Mover& mover, EnvironmentProbe& probe, PhaseTimer& startup)
+		: logger(logger), mover(mover), probe(probe), startup(startup), parser(argc, argv) {
+		if (parser.getOptions().probeCache) probe.EnableDiskCache();
+		mover.SetSliceBudget(parser.getOptions().sliceBudget);
 	}
 
 	int run() {
+		int result = this->runCommand();
+		startup.mark(L"执行命令");
+		logger.info(L"启动耗时: " + startup.report());
+		if (parser.getOptions().showTiming)
+			wcout << L"耗时: " << startup.report() << endl;
+		return result;
+	}
+
+private:
+	int runCommand() {
 		try {
 			if (parser.getOptions().showHelp) {
 				parser.printHelp();
 				return EXIT_SUCCESS;
 			}
 
+			// 客户端：把命令交给常驻服务，不需要注入
+			if (!parser.getOptions().sendRequest.empty()) {
+				wstring response;
+				int status = SendPipeRequest(parser.getOptions().sendRequest, response);
+				if (status < 0) {
+					wcout << L"无法连接到服务，请先运行 --serve" << endl;
+					logger.error(L"无法连接到服务");
+					return EXIT_FAILURE;
+				}
+				wcout << response;
+				return status;
+			}
+
+			// 创建命令；脚本在这里一次性解析完毕
+			unique_ptr<Command> command;
+			bool commandNeedsInjection = false;
+			if (parser.getOptions().serve) {
+				command = make_unique<ServeCommand>();
+				commandNeedsInjection = true;
+			}
+			else if (!parser.getOptions().scriptPath.empty()) {
+				auto script = make_unique<ScriptCommand>(parser.getOptions().scriptPath);
+				commandNeedsInjection = script->needsInjection();
+				command = move(script);
+			}
+			else {
+				command = parser.createCommand();
+				commandNeedsInjection = CommandLineParser::needsInjection(parser.getOptions().operationMode);
+			}
+			if (!command) {
+				logger.error(L"无法创建命令");
+				return EXIT_FAILURE;
+			}
+
 			// 根据注入模式设置注入状态
 			bool injectDLL = false;
 			if (parser.getOptions().injectMode == L"true") {
@@ -568,27 +1509,30 @@ public:
 				logger.log(L"跳过 DLL 注入");
 			}
 			else if (parser.getOptions().injectMode == L"auto") {
-				// save, save-full, move, clearlog
-				if (parser.getOptions().operationMode == L"save"
-					|| parser.getOptions().operationMode == L"save-full"
-					|| parser.getOptions().operationMode == L"move"
-					|| parser.getOptions().operationMode == L"clearlog")
-					injectDLL = true;
+				// save, save-full, move, clearlog，或包含它们的脚本
+				injectDLL = commandNeedsInjection;
 				logger.log(injectDLL ? L"自动模式: 需要注入DLL" : L"自动模式: 无需注入DLL");
 			}
-			if (injectDLL) wcout << L"准备注入 DLL" << endl;
-
-			// 执行注入（如果需要）
-			if (injectDLL && !mover.InjectDLLEx()) {
-				logger.error(L"错误: DLL 注入失败");
-				return EXIT_FAILURE;
+			// 命令可以接管注入，与自己的准备工作并行
+			if (command->takeOverInjection(injectDLL)) {
+				logger.log(L"注入由命令在执行时完成");
+				injectDLL = false;
 			}
 
-			auto command = parser.createCommand();
-			if (!command) {
-				logger.error(L"无法创建命令");
-				return EXIT_FAILURE;
+			// 执行注入（如果需要）
+			if (injectDLL) {
+				const bool online = probe.IsAgentOnline();
+				wcout << (online ? L"预检查：DLL 在线" : L"预检查：DLL 不在线") << endl;
+				if (!online) {
+					wcout << L"准备注入 DLL" << endl;
+					if (!mover.InjectDLLEx(true)) {
+						logger.error(L"错误: DLL 注入失败");
+						return EXIT_FAILURE;
+					}
+					probe.SetAgentOnline(true);
+				}
 			}
+			startup.mark(L"注入");
 
 			int result = command->execute(logger, mover, dm) ? EXIT_SUCCESS : EXIT_FAILURE;
 
@@ -605,10 +1549,10 @@ public:
 		}
 	}
 
-private:
-	LogMessage logger;
-	Mover mover{ logger };
+	LogMessage& logger;
+	Mover& mover;
+	EnvironmentProbe& probe;
+	PhaseTimer& startup;
 	DataManager dm;
 	CommandLineParser parser;
-	CommandExecutor executor{ mover, logger, dm };
 };
\ No newline at end of file
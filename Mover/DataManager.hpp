@@ -11,8 +11,14 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include <memory>
+#include <cstdlib>
+#include <cwchar>
 #include "BuiltIn-Data.h"  
 #include "common/communication.h"
+#include "common/snapshot.h"
+#include "common/keyframes.h"
+#include "tool/PointGrid.hpp"
 using namespace std;
 
 // @enum RatioPointVectorSort
@@ -23,6 +29,30 @@ enum class RatioPointVectorSort : int {
 	Y_ASC = 2,		// 按Y坐标升序 (小->大)
 	Y_DESC = 3		// 按Y坐标降序 (大->小)
 };
+
+// @struct LayoutChanges
+// @brief 两个布局之间的差异，下标分别指向旧布局（base）与新布局（other）
+struct LayoutChanges {
+	// @struct Move
+	// @brief 两边都有、位置改变的图标
+	struct Move {
+		size_t from;	// 在旧布局中的下标
+		size_t to;		// 在新布局中的下标
+	};
+
+	vector<Move> moved;
+	vector<size_t> added;	// 只在新布局中的图标（新布局下标）
+	vector<size_t> removed;	// 只在旧布局中的图标（旧布局下标）
+	size_t unchanged = 0;	// 两边都有、位置在容差内的图标数
+
+	void clear() {
+		this->moved.clear();
+		this->added.clear();
+		this->removed.clear();
+		this->unchanged = 0;
+	}
+};
+
 // @class DataManager
 // @brief 管理 IconPositionMove 数据：清洗，排序，转换等；管理桌面文件
 class DataManager {
@@ -32,13 +62,14 @@ public:
 	// -------------------------------
 
 	// @brief RatioPointVector 转 (rate)iconPositionMove，targetName 为编号，0、1、2、3...
+	// @note p 中直接存放 Q16 比率，不做任何缩放
 	bool ratioPointVectorToRateIconPositionMove(IconPositionMove* iconPositionMove, size_t size, const RatioPointVector& ratioPointVector)
 	{
 		if (size < ratioPointVector.size()) return false;
 		for (int i = 0; i < ratioPointVector.size(); ++i) {
 			wsprintf(iconPositionMove[i].targetName, L"%d", i);
-			iconPositionMove[i].p.x = static_cast<int>(ratioPointVector[i].first * 1000); // 固定 1000 缩放
-			iconPositionMove[i].p.y = static_cast<int>(ratioPointVector[i].second * 1000);
+			iconPositionMove[i].p.x = ratioPointVector[i].x;
+			iconPositionMove[i].p.y = ratioPointVector[i].y;
 		}
 		return true;
 	}
@@ -49,7 +80,34 @@ public:
 	{
 		ratioPointVector.clear();
 		for (int i = 0; i < size; ++i) {
-			ratioPointVector.push_back(pair<double, double>(iconPositionMove[i].p.x, iconPositionMove[i].p.y));
+			ratioPointVector.push_back(RatioPoint(iconPositionMove[i].p.x, iconPositionMove[i].p.y));
+		}
+	}
+
+	// @brief RatioPointVector 转 (rate)IconSnapshot，名称为编号，0、1、2、3...
+	// @note p 中直接存放 Q16 比率，不做任何缩放
+	// @note snapshot 会被清空
+	void ratioPointVectorToRateSnapshot(IconSnapshot& snapshot, const RatioPointVector& ratioPointVector)
+	{
+		snapshot.clear();
+		snapshot.reserve(ratioPointVector.size(), 5);
+		wchar_t name[16];
+		for (size_t i = 0; i < ratioPointVector.size(); ++i) {
+			int length = wsprintf(name, L"%d", static_cast<int>(i));
+			snapshot.add(name, length, { ratioPointVector[i].x, ratioPointVector[i].y });
+		}
+	}
+
+	// @brief IconSnapshot 转 RatioPointVector，丢弃名称
+	// @note ratioPointVector 会被清空
+	void snapshotToRatioPointVector(RatioPointVector& ratioPointVector, const IconSnapshot& snapshot)
+	{
+		ratioPointVector.clear();
+		ratioPointVector.reserve(snapshot.size());
+		const int cx = GetSystemMetrics(SM_CXSCREEN);
+		const int cy = GetSystemMetrics(SM_CYSCREEN);
+		for (const auto& icon : snapshot.getRecords()) {
+			ratioPointVector.push_back(RatioPoint(pixelToQ16(icon.p.x, cx), pixelToQ16(icon.p.y, cy)));
 		}
 	}
 
@@ -61,8 +119,21 @@ public:
 		const int cx = GetSystemMetrics(SM_CXSCREEN);
 		const int cy = GetSystemMetrics(SM_CYSCREEN);
 		for (int i = 0; i < size; ++i) {
-			ratioPointVector.push_back(pair<double, double>((static_cast<double>(iconPositionMove[i].p.x) / cx),
-				(static_cast<double>(iconPositionMove[i].p.y) / cy)));
+			ratioPointVector.push_back(RatioPoint(pixelToQ16(iconPositionMove[i].p.x, cx),
+				pixelToQ16(iconPositionMove[i].p.y, cy)));
+		}
+	}
+
+	// @brief 计算 RatioPointVector 的布局指纹，名称为编号，0、1、2、3...（与占位文件相同）
+	// @param fingerprint [IN/OUT] 使用其中的量化网格，原有的值被清空
+	// @note 与桌面比较时，网格取自 Mover::GetLayoutFingerprint 的结果
+	void ratioPointVectorFingerprint(LayoutFingerprint& fingerprint, const RatioPointVector& ratioPointVector)
+	{
+		fingerprint.clear();
+		wchar_t name[16];
+		for (size_t i = 0; i < ratioPointVector.size(); ++i) {
+			int length = wsprintf(name, L"%d", static_cast<int>(i));
+			fingerprint.addRatio(hashName(name, length), ratioPointVector[i].x, ratioPointVector[i].y);
 		}
 	}
 
@@ -115,6 +186,28 @@ public:
 		return true;
 	}
 
+	// @brief IconSnapshot 排序，wstring 参数版
+	// @note 只移动 16 字节的记录，名称留在字符池中
+	bool sort(IconSnapshot& snapshot, wstring sortType = L"X_ASC")
+	{
+		RatioPointVectorSort rpvs;
+		if (sortType == L"X_ASC") rpvs = RatioPointVectorSort::X_ASC;
+		else if (sortType == L"X_DESC") rpvs = RatioPointVectorSort::X_DESC;
+		else if (sortType == L"Y_ASC") rpvs = RatioPointVectorSort::Y_ASC;
+		else if (sortType == L"Y_DESC") rpvs = RatioPointVectorSort::Y_DESC;
+		else return false;
+
+		// 比较器组；常量对应下标，所有不能改
+		const static function<bool(const CompactIcon&, const CompactIcon&)> comparators[4] = {
+			[](const auto& a, const auto& b) { return a.p.x < b.p.x; }, // Mode 0 X_ASC
+			[](const auto& a, const auto& b) { return a.p.x > b.p.x; }, // Mode 1 X_DESC
+			[](const auto& a, const auto& b) { return a.p.y < b.p.y; }, // Mode 2 Y_ASC
+			[](const auto& a, const auto& b) { return a.p.y > b.p.y; }  // Mode 3 Y_DESC
+		};
+		std::sort(snapshot.getRecords().begin(), snapshot.getRecords().end(), comparators[static_cast<int>(rpvs)]);
+		return true;
+	}
+
 	// @brief 对 RatioPointVector 进行按 X/Y 的排序
 	// @param rpv 待排序数据
 	// @param sortType 排序规则
@@ -128,11 +221,11 @@ public:
 			) return false;
 
 		// 定义比较器组（常量对应下标）
-		static const std::function<bool(const pair<double, double>&, const pair<double, double>&)> comparators[4] = {
-			[](const auto& a, const auto& b) { return a.first < b.first; }, // X_ASC
-			[](const auto& a, const auto& b) { return a.first > b.first; }, // X_DESC
-			[](const auto& a, const auto& b) { return a.second < b.second; }, // Y_ASC
-			[](const auto& a, const auto& b) { return a.second > b.second; }  // Y_DESC
+		static const std::function<bool(const RatioPoint&, const RatioPoint&)> comparators[4] = {
+			[](const auto& a, const auto& b) { return a.x < b.x; }, // X_ASC
+			[](const auto& a, const auto& b) { return a.x > b.x; }, // X_DESC
+			[](const auto& a, const auto& b) { return a.y < b.y; }, // Y_ASC
+			[](const auto& a, const auto& b) { return a.y > b.y; }  // Y_DESC
 		};
 
 		std::sort(rpv.begin(), rpv.end(), comparators[static_cast<int>(sortType)]);
@@ -150,11 +243,11 @@ public:
 		else return false;
 
 		// 定义比较器组（常量对应下标）
-		static const std::function<bool(const pair<double, double>&, const pair<double, double>&)> comparators[4] = {
-			[](const auto& a, const auto& b) { return a.first < b.first; }, // X_ASC
-			[](const auto& a, const auto& b) { return a.first > b.first; }, // X_DESC
-			[](const auto& a, const auto& b) { return a.second < b.second; }, // Y_ASC
-			[](const auto& a, const auto& b) { return a.second > b.second; }  // Y_DESC
+		static const std::function<bool(const RatioPoint&, const RatioPoint&)> comparators[4] = {
+			[](const auto& a, const auto& b) { return a.x < b.x; }, // X_ASC
+			[](const auto& a, const auto& b) { return a.x > b.x; }, // X_DESC
+			[](const auto& a, const auto& b) { return a.y < b.y; }, // Y_ASC
+			[](const auto& a, const auto& b) { return a.y > b.y; }  // Y_DESC
 		};
 
 		std::sort(rpv.begin(), rpv.end(), comparators[static_cast<int>(rpvs)]);
@@ -186,6 +279,57 @@ public:
 		return true;
 	}
 
+	// @brief 写出 IconSnapshot 到文件，格式同 writeIconPositionMoveToFile
+	bool writeSnapshotToFile(const IconSnapshot& snapshot, const wchar_t* fileName)
+	{
+		wofstream file(fileName, ios::out);
+		if (!file.is_open()) return false;
+
+		file << L"[IconPositionMove Data]" << endl;
+		for (size_t i = 0; i < snapshot.size(); ++i)
+			file << L"/" << snapshot.name(i) << L"/ "
+			<< static_cast<double>(snapshot[i].p.x) << L" "
+			<< static_cast<double>(snapshot[i].p.y) << endl;
+
+		file.close();
+		return true;
+	}
+
+	// @brief 从文件读入 IconSnapshot，格式同 writeSnapshotToFile
+	// @note 整个文件一次读入后就地解析，百万行的文件也只需几十毫秒
+	// @note snapshot 会被清空
+	bool readSnapshotFromFile(IconSnapshot& snapshot, const wchar_t* fileName)
+	{
+		string text;
+		if (!readFileText(fileName, text)) return false;
+		size_t cursor = 0;
+		if (nextLine(text, cursor) != "[IconPositionMove Data]") return false;
+
+		const wstring body = toWide(text.c_str() + cursor, text.size() - cursor);
+		snapshot.clear();
+		snapshot.reserve(count(body.begin(), body.end(), L'\n') + 1);
+
+		const wchar_t* line = body.c_str();
+		const wchar_t* const end = line + body.size();
+		while (line < end) {
+			const wchar_t* lineEnd = wmemchr(line, L'\n', end - line);
+			if (!lineEnd) lineEnd = end;
+
+			// /name/ x y
+			const wchar_t* first = (*line == L'#') ? nullptr : wmemchr(line, L'/', lineEnd - line);
+			const wchar_t* second = first ? wmemchr(first + 1, L'/', lineEnd - first - 1) : nullptr;
+			if (second) {
+				wchar_t* next = nullptr;
+				IconPoint p;
+				p.x = static_cast<int>(wcstod(second + 1, &next));
+				p.y = static_cast<int>(wcstod(next, &next));
+				snapshot.add(first + 1, second - first - 1, p);
+			}
+			line = lineEnd + 1;
+		}
+		return true;
+	}
+
 	// @brief 从文件读入 IconPositionMove
 	// @note 文件第一行必须为 "[IconPositionMove Data]"
 	bool readIconPositionMoveFromFile(vector<IconPositionMove>& iconPositionMove, const wchar_t* fileName) {
@@ -216,27 +360,31 @@ public:
 	}
 
 	// @brief 写出 RatioPointVector 到文件
-	// @note 数据格式
-	// 			[RatioPointVector Data]
+	// @note 数据格式（Q16 定点整数）
+	// 			[RatioPointVector Q16 Data]
 	//			x1 y1
 	//			x2 y2
 	//			...
 	bool writeRatioPointVectorToFile(const RatioPointVector& ratioPointVector, const wchar_t* fileName)
 	{
-		wofstream file(fileName, ios::out);
-		if (!file.is_open()) return false;
-
-		file << L"[RatioPointVector Data]" << endl;
-
-		for (const auto& point : ratioPointVector)
-			file << static_cast<double>(point.first) << L" " << static_cast<double>(point.second) << endl;
+		// 先格式化到内存再一次写出，百万个点也只需一次写入
+		string text = "[RatioPointVector Q16 Data]\n";
+		text.reserve(text.size() + ratioPointVector.size() * 14);
+		for (const auto& point : ratioPointVector) {
+			text += to_string(point.x);
+			text += ' ';
+			text += to_string(point.y);
+			text += '\n';
+		}
 
-		file.close();
-		return true;
+		ofstream file(fileName, ios::out);
+		if (!file.is_open()) return false;
+		file.write(text.data(), text.size());
+		return file.good();
 	}
 
 	// @brief 从文件读入 RatioPointVector
-	// @note 文件第一行必须为 "[RatioPointVector Data]"
+	// @note 文件第一行必须为 "[RatioPointVector Q16 Data]"，或旧版的 "[RatioPointVector Data]"（double 比率）
 	// @note 支持特殊路径：mover::，表示使用内置数据
 	bool readRatioPointVectorFromFile(RatioPointVector& ratioPointVector, const wchar_t* fileName)
 	{
@@ -251,20 +399,218 @@ public:
 			return false;
 		}
 
-		wifstream file(fileName, ios::in);
+		// 整个文件一次读入后就地解析
+		string text;
+		if (!readFileText(fileName, text)) return false;
+		size_t cursor = 0;
+		const string header = nextLine(text, cursor);
+		const char* p = text.c_str() + cursor;
+		char* next = nullptr;
+		if (header == "[RatioPointVector Q16 Data]") {
+			ratioPointVector.reserve(ratioPointVector.size() + text.size() / 12);
+			for (;;) {
+				const long x = strtol(p, &next, 10);
+				if (next == p) break;
+				p = next;
+				const long y = strtol(p, &next, 10);
+				if (next == p) break;
+				p = next;
+				ratioPointVector.push_back(RatioPoint(static_cast<RatioQ16>(x), static_cast<RatioQ16>(y)));
+			}
+		}
+		else if (header == "[RatioPointVector Data]") {
+			for (;;) {
+				const double x = strtod(p, &next);
+				if (next == p) break;
+				p = next;
+				const double y = strtod(p, &next);
+				if (next == p) break;
+				p = next;
+				ratioPointVector.push_back(pair<double, double>(x, y));
+			}
+		}
+		else return false;
+
+		return true;
+	}
+
+	// @brief 把多个布局文件依次作为关键帧，写出关键帧动画文件
+	// @param layouts 布局文件（同 readRatioPointVectorFromFile，支持 mover::），图标数量必须相同
+	// @param frameTime 每帧持续时间（毫秒）
+	// @note 文件格式见 common/keyframes.h
+	bool writeKeyframesToFile(const vector<wstring>& layouts, uint32_t frameTime, const wchar_t* fileName)
+	{
+		if (layouts.empty()) return false;
+
+		RatioPointVector frame;
+		unique_ptr<KeyframeEncoder> encoder;
+		for (const wstring& layout : layouts) {
+			frame.clear();
+			if (!readRatioPointVectorFromFile(frame, layout.c_str()) || frame.empty()) return false;
+			if (!encoder) encoder.reset(new KeyframeEncoder(static_cast<uint32_t>(frame.size())));
+			if (!encoder->add(frame, frameTime)) return false; // 图标数量不一致
+		}
+
+		const vector<uint8_t>& bytes = encoder->finish();
+		ofstream file(fileName, ios::out | ios::binary);
 		if (!file.is_open()) return false;
+		file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+		return file.good();
+	}
 
-		wstring line;
-		getline(file, line);
-		if (line != L"[RatioPointVector Data]") return false;
+	// -------------------------------
+	// 布局对比与合并
+	// -------------------------------
 
-		double x, y;
-		while (file >> x >> y) {
-			ratioPointVector.push_back(pair<double, double>(x, y));
+	// @brief 按名称对比两个快照
+	// @param tolerance x、y 各自允许的偏差，单位与文件中的坐标相同
+	// @note 名称经散列放入开放寻址表，同名图标按出现顺序一一配对
+	void diffSnapshots(const IconSnapshot& base, const IconSnapshot& other, long tolerance, LayoutChanges& changes)
+	{
+		changes.clear();
+
+		// 槽中存放 base 下标 + 1，0 表示空槽
+		size_t capacity = 16;
+		while (capacity < base.size() * 2) capacity <<= 1;
+		const size_t mask = capacity - 1;
+		vector<uint32_t> slots(capacity, 0);
+		vector<uint32_t> hashes(base.size());
+		for (size_t i = 0; i < base.size(); ++i) {
+			hashes[i] = hashName(base.name(i), base[i].nameLength);
+			size_t slot = hashes[i] & mask;
+			while (slots[slot]) slot = (slot + 1) & mask;
+			slots[slot] = static_cast<uint32_t>(i + 1);
 		}
 
-		file.close();
-		return true;
+		vector<bool> matched(base.size(), false);
+		for (size_t j = 0; j < other.size(); ++j) {
+			const uint32_t length = other[j].nameLength;
+			const uint32_t hash = hashName(other.name(j), length);
+			size_t found = SIZE_MAX;
+			for (size_t slot = hash & mask; slots[slot]; slot = (slot + 1) & mask) {
+				const size_t i = slots[slot] - 1;
+				if (hashes[i] == hash && !matched[i] && base[i].nameLength == length &&
+					wmemcmp(base.name(i), other.name(j), length) == 0) {
+					found = i;
+					break;
+				}
+			}
+
+			if (found == SIZE_MAX) {
+				changes.added.push_back(j);
+				continue;
+			}
+			matched[found] = true;
+			if (abs(base[found].p.x - other[j].p.x) > tolerance || abs(base[found].p.y - other[j].p.y) > tolerance)
+				changes.moved.push_back({ found, j });
+			else
+				++changes.unchanged;
+		}
+
+		for (size_t i = 0; i < base.size(); ++i)
+			if (!matched[i]) changes.removed.push_back(i);
+	}
+
+	// @brief 按最近邻对比两个无名布局
+	// @param tolerance 视为未移动的最大距离（Q16），X、Y 分别按屏幕宽、高换算
+	// @param radius 视为同一个图标移动的最大距离（Q16），X、Y 分别按屏幕宽、高换算，更远的视为删除 + 新增
+	// @note 旧布局放入空间散列（见 tool/PointGrid.hpp）；先占住容差内的点，再为其余的点找 radius 内最近的点
+	void diffRatioPointVectors(const RatioPointVector& base, const RatioPointVector& other, const RatioPoint& tolerance, const RatioPoint& radius, LayoutChanges& changes)
+	{
+		changes.clear();
+		PointGrid grid(base);
+		vector<size_t> queries;
+		grid.orderByCell(other, queries);
+
+		// 第一遍：容差内的点视为未移动，避免被附近移动过来的点抢走
+		vector<size_t> pending;
+		for (size_t j : queries) {
+			if (grid.take(other[j], tolerance) != SIZE_MAX) ++changes.unchanged;
+			else pending.push_back(j);
+		}
+
+		// 第二遍：radius 内最近的点视为同一个图标
+		for (size_t j : pending) {
+			const size_t i = grid.take(other[j], radius);
+			if (i == SIZE_MAX) changes.added.push_back(j);
+			else changes.moved.push_back({ i, j });
+		}
+		std::sort(changes.added.begin(), changes.added.end());
+		std::sort(changes.moved.begin(), changes.moved.end(), [](const LayoutChanges::Move& a, const LayoutChanges::Move& b) {
+			return a.to < b.to;
+		});
+
+		for (size_t i = 0; i < base.size(); ++i)
+			if (!grid.isTaken(i)) changes.removed.push_back(i);
+	}
+
+	// @brief 把部分布局合并进基础布局
+	// @param changes diffSnapshots(base, partial) 的结果
+	// @note 匹配到的图标取部分布局中的位置，只在部分布局中的图标追加到末尾，基础布局中多出的图标保留
+	void mergeSnapshots(IconSnapshot& merged, const IconSnapshot& base, const IconSnapshot& partial, const LayoutChanges& changes)
+	{
+		merged = base;
+		for (const LayoutChanges::Move& move : changes.moved)
+			merged[move.from].p = partial[move.to].p;
+		for (size_t j : changes.added)
+			merged.add(partial.name(j), partial[j].nameLength, partial[j].p);
+	}
+
+	// @brief 同 mergeSnapshots，用于无名布局
+	// @param changes diffRatioPointVectors(base, partial) 的结果
+	void mergeRatioPointVectors(RatioPointVector& merged, const RatioPointVector& base, const RatioPointVector& partial, const LayoutChanges& changes)
+	{
+		merged = base;
+		for (const LayoutChanges::Move& move : changes.moved)
+			merged[move.from] = partial[move.to];
+		for (size_t j : changes.added)
+			merged.push_back(partial[j]);
+	}
+
+	// @brief 差异转为文本
+	// @note 每行一项：
+	//			M /name/ x1 y1 x2 y2	移动
+	//			A /name/ x y			新增
+	//			D /name/ x y			删除
+	void describeChanges(wstring& text, const IconSnapshot& base, const IconSnapshot& other, const LayoutChanges& changes)
+	{
+		text = L"[Layout Changes]\n";
+		for (const LayoutChanges::Move& move : changes.moved) {
+			text += L"M /" + wstring(base.name(move.from)) + L"/ " + to_wstring(base[move.from].p.x) + L" " + to_wstring(base[move.from].p.y)
+				+ L" " + to_wstring(other[move.to].p.x) + L" " + to_wstring(other[move.to].p.y) + L"\n";
+		}
+		for (size_t j : changes.added)
+			text += L"A /" + wstring(other.name(j)) + L"/ " + to_wstring(other[j].p.x) + L" " + to_wstring(other[j].p.y) + L"\n";
+		for (size_t i : changes.removed)
+			text += L"D /" + wstring(base.name(i)) + L"/ " + to_wstring(base[i].p.x) + L" " + to_wstring(base[i].p.y) + L"\n";
+	}
+
+	// @brief 差异转为文本，用于无名布局
+	// @note 没有名称，以下标代替：
+	//			M 旧下标 新下标 x1 y1 x2 y2
+	//			A 新下标 x y
+	//			D 旧下标 x y
+	void describeChanges(wstring& text, const RatioPointVector& base, const RatioPointVector& other, const LayoutChanges& changes)
+	{
+		text = L"[Layout Changes Q16]\n";
+		for (const LayoutChanges::Move& move : changes.moved) {
+			text += L"M " + to_wstring(move.from) + L" " + to_wstring(move.to) + L" " + to_wstring(base[move.from].x) + L" " + to_wstring(base[move.from].y)
+				+ L" " + to_wstring(other[move.to].x) + L" " + to_wstring(other[move.to].y) + L"\n";
+		}
+		for (size_t j : changes.added)
+			text += L"A " + to_wstring(j) + L" " + to_wstring(other[j].x) + L" " + to_wstring(other[j].y) + L"\n";
+		for (size_t i : changes.removed)
+			text += L"D " + to_wstring(i) + L" " + to_wstring(base[i].x) + L" " + to_wstring(base[i].y) + L"\n";
+	}
+
+	// @brief 写出文本文件（ANSI 代码页，与其它布局文件一致）
+	bool writeTextToFile(const wstring& text, const wchar_t* fileName)
+	{
+		const string bytes = toNarrow(text);
+		ofstream file(fileName, ios::out);
+		if (!file.is_open()) return false;
+		file.write(bytes.data(), bytes.size());
+		return file.good();
 	}
 
 	// -------------------------------
@@ -342,6 +688,47 @@ public:
 	}
 
 private:
+	// @brief 把整个文件读入内存
+	static bool readFileText(const wchar_t* fileName, string& text) {
+		ifstream file(fileName, ios::in | ios::binary);
+		if (!file.is_open()) return false;
+		file.seekg(0, ios::end);
+		const streamoff size = file.tellg();
+		if (size < 0) return false;
+		file.seekg(0, ios::beg);
+		text.resize(static_cast<size_t>(size));
+		if (size > 0) file.read(&text[0], size);
+		return !file.bad();
+	}
+
+	// @brief 从 cursor 处取出一行（不含换行符），cursor 移到下一行
+	static string nextLine(const string& text, size_t& cursor) {
+		size_t end = text.find('\n', cursor);
+		if (end == string::npos) end = text.size();
+		string line = text.substr(cursor, end - cursor);
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		cursor = min(end + 1, text.size());
+		return line;
+	}
+
+	// @brief ANSI 代码页 -> UTF-16（与 wifstream 的默认行为一致）
+	static wstring toWide(const char* text, size_t length) {
+		if (length == 0) return wstring();
+		const int size = MultiByteToWideChar(CP_ACP, 0, text, static_cast<int>(length), nullptr, 0);
+		wstring result(size, L'\0');
+		MultiByteToWideChar(CP_ACP, 0, text, static_cast<int>(length), &result[0], size);
+		return result;
+	}
+
+	// @brief UTF-16 -> ANSI 代码页
+	static string toNarrow(const wstring& text) {
+		if (text.empty()) return string();
+		const int size = WideCharToMultiByte(CP_ACP, 0, text.c_str(), static_cast<int>(text.size()), nullptr, 0, nullptr, nullptr);
+		string result(size, '\0');
+		WideCharToMultiByte(CP_ACP, 0, text.c_str(), static_cast<int>(text.size()), &result[0], size, nullptr, nullptr);
+		return result;
+	}
+
 	// @brief 删除指定文件
 	static bool deleteFile(const wstring& filePath) {
 		if (DeleteFileW(filePath.c_str())) return true;
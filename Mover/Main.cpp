@@ -8,6 +8,8 @@
 #include <Windows.h>
 #include "tool/LogMessage.hpp"
 #include "tool/EnvironmentChecker.hpp"
+#include "tool/EnvironmentProbe.hpp"
+#include "tool/PhaseTimer.hpp"
 #include "Mover.hpp"
 #include "CommandLine.hpp"
 using namespace std;
@@ -21,10 +23,23 @@ wstring string2wstring(const string& str) {
 	return wstring(buffer.get());
 }
 
+// @brief Ctrl+C 时要取消命令的 Mover
+static Mover* cancelTarget = nullptr;
+
+// @brief Ctrl+C / Ctrl+Break：先请求取消正在执行的命令，让 Agent 停在一致的位置
+// @note 没有命令在执行，或者已经请求过取消（再按一次）时，交给默认处理结束进程
+BOOL WINAPI onCancelRequest(DWORD type) {
+	if (type != CTRL_C_EVENT && type != CTRL_BREAK_EVENT) return FALSE;
+	if (!cancelTarget || !cancelTarget->RequestCancel()) return FALSE;
+	wcout << L"\n正在取消，再按一次 Ctrl+C 强制退出" << endl;
+	return TRUE;
+}
+
 // @brief 应用环境检测
-void initializeApplication(Mover& mover, LogMessage& logger) {
+// @note Agent 状态不在这里探测，等到确实需要注入时再由 Application 探测
+void initializeApplication(EnvironmentProbe& probe, LogMessage& logger) {
 	// 检查管理员权限
-	if (!EnvironmentChecker().IsRunningAsAdmin()) {
+	if (!probe.IsRunningAsAdmin()) {
 		logger.warning(L"未以管理员权限运行");
 		wcout << L"推荐以管理员身份运行此程序!\n";
 	}
@@ -32,7 +47,7 @@ void initializeApplication(Mover& mover, LogMessage& logger) {
 		logger.info(L"当前以管理员权限运行");
 	}
 
-	if (EnvironmentChecker().getWindowsMajorVersion() < 10 &&
+	if (probe.GetWindowsMajorVersion() < 10 &&
 		MessageBox(NULL,
 			(L"额...那个，打扰您一下\n"
 				L"这个程序只在 Windows 10 系统上得到了测试\n"
@@ -53,14 +68,12 @@ void initializeApplication(Mover& mover, LogMessage& logger) {
 	wcout << L"3. 第三方桌面工具可能导致功能异常\n";
 	wcout << L"- Rikka Software 制作 -\n";
 	wcout << L"----------------------------------\n";
-
-	if (mover.IsInjected()) wcout << L"预检查：DLL 在线\n";
-	else wcout << L"预检查：DLL 不在线\n";
 }
 
 
 // @brief 主函数
 int wmain(int argc, wchar_t* argv[]) {
+	PhaseTimer startup;
 	locale::global(locale(""));
 	wcout.imbue(locale(""));
 	wcerr.imbue(locale(""));
@@ -69,13 +82,21 @@ int wmain(int argc, wchar_t* argv[]) {
 	LogMessage logger;
 	logger.log(L"应用程序启动");
 	Mover mover(logger);
+	cancelTarget = &mover;
+	SetConsoleCtrlHandler(onCancelRequest, TRUE);
+	EnvironmentProbe probe(logger, [&mover] { return mover.IsInjected(); });
+	startup.mark(L"初始化");
 
 	try {
+		// 解析命令行参数
+		Application app(argc, argv, logger, mover, probe, startup);
+		startup.mark(L"参数解析");
+
 		// 应用环境检测
-		initializeApplication(mover, logger);
+		initializeApplication(probe, logger);
+		startup.mark(L"环境检测");
 
 		// 执行命令行参数
-		Application app(argc, argv);
 		int result = app.run();
 		if (result)
 			logger.log(L"命令行参数执行成功");
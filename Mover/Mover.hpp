@@ -7,11 +7,26 @@
 #include <Windows.h>
 #include <TlHelp32.h>
 #include <string>
+#include <functional>
+#include <atomic>
 #include "DataManager.hpp"
+#include "common/snapshot.h"
+#include "common/desktopstate.h"
+#include "common/control.h"
 #include "tool/LogMessage.hpp"
+#include "tool/ExplorerLifecycle.hpp"
+#include "tool/BufferPool.hpp"
 constexpr auto SURIVIVAL_TIMEOUT = 300;				// 存活检测超时时间	
 constexpr auto CURRENT_OPERATION_TIMEOUT = 25000;	// 操作超时时间
 constexpr auto MUTEX_TIMEOUT = 10000;				// 互斥锁超时时间
+constexpr auto READY_TIMEOUT = 5000;				// 注入后等待 Agent 就绪的超时时间
+constexpr auto REINJECT_ATTEMPTS = 6;				// explorer 重启后重新注入的最大尝试次数
+constexpr auto REINJECT_BACKOFF = 500;				// 重新注入的初始退避时间，每次翻倍
+constexpr auto EXPLORER_RELAUNCH_TIMEOUT = 5000;	// explorer 退出后多久没有自动重启就手动启动
+constexpr auto PROGRESS_INTERVAL = 250;			// 长命令执行期间查询进度的间隔
+constexpr auto HUNG_GRACE = 3000;					// Agent 报告界面线程无响应后，最多再等多久它回复诊断信息
+constexpr uint32_t DEFAULT_SLICE_BUDGET = 8000;	// 批量命令默认的时间片预算（微秒），约半帧
+constexpr auto ENUMERATION_RETRIES = 3;				// 分页枚举期间快照过期时最多从头重来的次数
 using std::wstring;
 using std::unique_ptr;
 using std::make_unique;
@@ -37,10 +52,22 @@ public:
 	// @param _logMessage 传个 LogMessage 来记录日志
 	Mover(LogMessage& logMessage) : logMessage(logMessage) {}
 
+	~Mover() {
+		if (this->stateView) UnmapViewOfFile(this->stateView);
+		if (this->stateMapping) CloseHandle(this->stateMapping);
+		if (this->readerView) UnmapViewOfFile(this->readerView);
+		if (this->readerMapping) CloseHandle(this->readerMapping);
+	}
+
+	Mover(const Mover&) = delete;
+	Mover& operator=(const Mover&) = delete;
+
 	// @brief 向 explorer 注入 DLL
-	bool InjectDLLEx() {
-		if (this->IsInjected()) {
+	// @param skipCheck 调用者已确认 DLL 不在线时传 true，省去一次存活检测
+	bool InjectDLLEx(bool skipCheck = false) {
+		if (!skipCheck && this->IsInjected()) {
 			logMessage.info(L"InjectDLLEx: DLL 已经注入，跳过本次操作");
+			this->lifecycle.Watch(this->GetTargetExplorerPID());
 			return true; // 已经注入过了
 		}
 
@@ -72,16 +99,45 @@ public:
 		}
 
 		logMessage.success(L"InjectDLLEx: DLL 注入成功");
+		this->lifecycle.Watch(pid);
+		return true;
+	}
+
+	// @brief 请求取消正在执行的命令
+	// @ret 是否有命令正在执行；没有命令或已经请求过取消时返回 false，调用者按默认方式处理（如结束进程）
+	// @note 可以从其它线程调用（如 Ctrl+C 处理函数）。Agent 在两个图标之间停下，多批次的操作在两批之间停下
+	bool RequestCancel() {
+		if (!this->busy || this->cancelRequested.exchange(true)) return false;
+
+		ControlData control;
+		control.command = CommandID::COMMAND_CANCEL;
+		bool delivered = this->runControl(control);
+		logMessage.warning(L"RequestCancel: 已请求取消" + wstring(delivered ? L"" : L"（Agent 未响应，将在本批结束后停止）"));
 		return true;
 	}
 
+	// @brief 设置批量命令每个时间片的预算
+	// @param microseconds 预算（微秒）；0 表示不分片，吞吐量最大，但 explorer 界面可能短暂卡顿
+	void SetSliceBudget(uint32_t microseconds) {
+		this->sliceBudget = microseconds;
+	}
+
+	// @brief 当前操作是否已被取消
+	bool IsCancelled() const {
+		return this->cancelRequested;
+	}
+
 	// @brief 检查 DLL 是否已经注入
+	// @note 走控制通道，主通道正在执行大批量命令时也能立即得到结果
 	bool IsInjected() {
-		unique_ptr<SharedData> pSharedData = make_unique<SharedData>();
-		pSharedData->command = CommandID::COMMAND_IS_OK;
-
-		bool result = this->run(pSharedData.get());
-		if (result)
+		ControlData control;
+		control.command = CommandID::COMMAND_IS_OK;
+
+		bool result = this->runControl(control);
+		if (result && control.activeCommand != CommandID::COMMAND_INVALID)
+			logMessage.info(L"IsInjected: 存活状态：DLL 在线，正在执行命令 " + to_wstring(static_cast<int>(control.activeCommand)) +
+				L"（已 " + to_wstring(GetTickCount64() - control.activeSinceTick) + L" ms）");
+		else if (result)
 			logMessage.info(L"IsInjected: 存活状态：DLL 在线");
 		else
 			logMessage.info(L"IsInjected: 存活状态：DLL 不在线");
@@ -92,8 +148,7 @@ public:
 	// @brief 卸载 DLL
 	bool UnInjectDLL() {
 		logMessage.log(L"UnInjectDLL: 准备卸载 DLL");
-		unique_ptr<SharedData> pSharedData = make_unique<SharedData>();
-		pSharedData->command = CommandID::COMMAND_EXIT;
+		auto pSharedData = this->NewCommand(CommandID::COMMAND_EXIT);
 
 		if (!this->run(pSharedData.get())) {
 			logMessage.error(L"UnInjectDLL: DLL 卸载失败");
@@ -107,8 +162,7 @@ public:
 	// @brief 强制卸载 DLL
 	bool ForceUnInjectDLL() {
 		logMessage.log(L"ForceUnInjectDLL: 准备强制卸载 DLL");
-		unique_ptr<SharedData> pSharedData = make_unique<SharedData>();
-		pSharedData->command = CommandID::COMMAND_FORCE_EXIT;
+		auto pSharedData = this->NewCommand(CommandID::COMMAND_FORCE_EXIT);
 
 		return this->run(pSharedData.get());
 	}
@@ -116,8 +170,7 @@ public:
 	// @brief 暴力卸载 DLL
 	bool F_ckWindows() {
 		logMessage.log(L"F_ckWindows: 准备暴力卸载 DLL");
-		unique_ptr<SharedData> pSharedData = make_unique<SharedData>();
-		pSharedData->command = CommandID::COMMAND_F_CK_WINDOWS;
+		auto pSharedData = this->NewCommand(CommandID::COMMAND_F_CK_WINDOWS);
 
 		return this->run(pSharedData.get());
 	}
@@ -163,8 +216,8 @@ public:
 	// @param is_rate 是否按比例移动，默认 false
 	// @remark	按比例移动
 	//				1. 意思就是坐标是根据屏幕分辨率，按比率计算，可实现在不同分辨率的屏幕上有相同的效果
-	// 				2. 坐标计算规则：屏幕（长/宽）乘以 (（长宽）比率/1000)
-	//				3. 传进来的比率需要在使用时先*1000
+	// 				2. 坐标计算规则：屏幕（长/宽）乘以（长宽）比率，再乘以 DPI 缩放，由 Agent 一步换算
+	//				3. 传进来的比率为 Q16 定点数（见 common/fixedpoint.h）
 	// @ret 对方是否响应并执行全部命令（不是对方命令执行的结果）
 	bool MoveIcon(const IconPositionMove* ipm, size_t size, bool isRate = false) {
 		logMessage.log(L"MoveIcon: 准备移动 " + to_wstring(size) + L" 个图标");
@@ -173,20 +226,25 @@ public:
 		if (size > MAX_ICON_COUNT)
 			logMessage.info(L"MoveIcon: 数目过大，将分批次处理");
 
+		const CommandID command = isRate ? CommandID::COMMAND_MOVE_ICON_BY_RATE : CommandID::COMMAND_MOVE_ICON;
+		auto pSharedData = this->NewCommand(command); // 各批次复用同一块缓冲区
+
 		bool result = true;
 		for (size_t i = 0; i < size; i += MAX_ICON_COUNT)
 		{
+			if (this->cancelRequested) {
+				logMessage.warning(L"MoveIcon: 已取消，完成 " + to_wstring(i) + L" / " + to_wstring(size) + L" 个");
+				return false;
+			}
 			size_t localSize = min(size - i, (size_t)MAX_ICON_COUNT); // 本次处理数量，不会超过 MAX_ICON_COUNT，不会偏移
 			logMessage.info(L"MoveIcon: 第 " + to_wstring(i / MAX_ICON_COUNT + 1) + L" 次处理，" + L"处理 " + to_wstring(localSize) + L" 个图标");
-			unique_ptr<SharedData> pSharedData = make_unique<SharedData>();
-
+			ResetCommand(pSharedData.get(), command);
 
 			// 复制本次处理的数据
 			for (int j = 0; j < localSize; ++j) {
 				pSharedData->iconPositionMove[j] = ipm[i + j];
 			}
 			pSharedData->size = static_cast<int>(localSize);
-			pSharedData->command = isRate ? CommandID::COMMAND_MOVE_ICON_BY_RATE : CommandID::COMMAND_MOVE_ICON;
 
 			result = this->run(pSharedData.get()) && result; // 只要有一次处理异常，result 就是 false
 			if (pSharedData->errorNumber == 0)
@@ -208,49 +266,198 @@ public:
 	int GetAllIcons(IconPositionMove* ipm, size_t size, size_t maxSizeOnce = MAX_ICON_COUNT)
 	{
 		logMessage.log(L"GetAllIcons: 获取所有图标位置");
-		unique_ptr<SharedData> pSharedData = make_unique<SharedData>();
-		pSharedData->command = CommandID::COMMAND_GET_ICON;
+
+		size_t j = 0; // 已获取的数量
+		bool result = this->EnumeratePages(CommandID::COMMAND_GET_ICON, static_cast<int>(min(maxSizeOnce, (size_t)MAX_ICON_COUNT)),
+			[&](int total) {
+				j = 0;
+				if (static_cast<size_t>(total) > size) { // 超限
+					logMessage.warning(L"GetAllIcons: 所给的缓冲区过小：提供 IconPositionMove 数组大小仅为 " +
+						to_wstring(size) + L"，但实际已经需要 " + to_wstring(total) + L" 个");
+					return false;
+				}
+				return true;
+			},
+			[&](const SharedData* page) {
+				for (int i = 0; i < page->size; ++i) // 拷回数据
+					ipm[j + i] = page->iconPositionMove[i];
+				j += page->size;
+			});
+		if (!result) {
+			logMessage.warning(L"GetAllIcons: 在获取图标位置时发生错误");
+			return -1;
+		}
+
+		logMessage.success(L"GetAllIcons: 成功获取" + to_wstring(j) + L" 个");
+
+		return static_cast<int>(j);
+	}
+
+	// @brief 获取所有图标，存入紧凑快照
+	// @param snapshot 结果，会被清空
+	// @ret 是否成功
+	// @note 不需要事先知道图标数量；每批数据从共享内存缓冲区直接转存到快照
+	bool GetSnapshot(IconSnapshot& snapshot)
+	{
+		logMessage.log(L"GetSnapshot: 获取所有图标位置");
+		snapshot.clear();
+		bool result = this->EnumeratePages(CommandID::COMMAND_GET_ICON, MAX_ICON_COUNT,
+			[&](int total) {
+				snapshot.clear();
+				snapshot.reserve(static_cast<size_t>(total));
+				return true;
+			},
+			[&](const SharedData* page) {
+				for (int i = 0; i < page->size; ++i)
+					snapshot.add(page->iconPositionMove[i]);
+			});
+		if (!result) {
+			logMessage.warning(L"GetSnapshot: 在获取图标位置时发生错误");
+			return false;
+		}
+		const size_t j = snapshot.size();
+
+		logMessage.success(L"GetSnapshot: 成功获取" + to_wstring(j) + L" 个，占用 " +
+			to_wstring(snapshot.memoryFootprint()) + L" 字节（IconPositionMove 需要 " +
+			to_wstring(IconSnapshot::legacyFootprint(j)) + L" 字节）");
+		return true;
+	}
+
+	// @brief 获取所有图标的坐标与名称散列
+	// @param positions 结果，会被清空
+	// @ret 是否成功
+	// @note 每个图标只传 12 字节，一次往返最多 MAX_POSITION_COUNT 个；只需比较位置时用它代替 GetSnapshot
+	bool GetAllPositions(vector<IconPositionHash>& positions)
+	{
+		positions.clear();
+		bool result = this->EnumeratePages(CommandID::COMMAND_GET_POSITIONS, MAX_POSITION_COUNT,
+			[&](int total) {
+				positions.clear();
+				positions.reserve(static_cast<size_t>(total));
+				return true;
+			},
+			[&](const SharedData* page) {
+				const IconPositionHash* batch = positionsOf(page);
+				positions.insert(positions.end(), batch, batch + page->size);
+			});
+		if (!result)
+			logMessage.warning(L"GetAllPositions: 在获取图标位置时发生错误");
+		return result;
+	}
+
+	// @brief 获取桌面上占位图标 0 ~ count-1 的布局指纹
+	// @param count 占位图标数量（布局中的点数）
+	// @param fingerprint [OUT] 桌面的布局指纹，量化网格为 Agent 使用的屏幕与 DPI
+	// @ret 是否成功
+	// @note 只回传一个指纹，不传坐标；用 fingerprint 的网格计算文件的指纹再比较
+	bool GetLayoutFingerprint(uint32_t count, LayoutFingerprint& fingerprint) {
+		auto pSharedData = this->NewCommand(CommandID::COMMAND_GET_FINGERPRINT);
+		pSharedData->size = static_cast<int>(count);
+		if (!this->run(pSharedData.get())) {
+			logMessage.warning(L"GetLayoutFingerprint: 获取布局指纹失败");
+			return false;
+		}
+		fingerprint = pSharedData->fingerprint;
+		logMessage.log(L"GetLayoutFingerprint: 找到 " + to_wstring(fingerprint.count) + L" / " + to_wstring(count) + L" 个占位图标");
+		return true;
+	}
+
+	// @brief 从 Agent 发布的桌面状态读取所有图标的坐标与名称散列
+	// @param positions 结果，会被清空
+	// @ret 是否读到有效数据；状态不可用、已过期或被截断时返回 false，调用者应改用 GetAllPositions
+	// @note 不加锁、不发命令，可以与其它客户端的命令同时进行
+	bool ReadDesktopState(vector<IconPositionHash>& positions) {
+		positions.clear();
+		const DesktopState* state = this->OpenDesktopState();
+		if (!state) return false;
+		this->MarkDesktopStateRead();
+
+		bool complete = false;
+		bool consistent = readDesktopState(state, [&](const DesktopState* s) {
+			complete = s->stored == s->count;
+			positions.assign(s->positions, s->positions + s->stored);
+		});
+		if (!consistent || !complete || !this->IsDesktopStateFresh(state)) {
+			positions.clear();
+			return false;
+		}
+		return true;
+	}
+
+	// @brief 从 Agent 发布的桌面状态读取图标数量
+	// @ret 是否读到有效数据
+	bool ReadDesktopIconCount(int& count) {
+		const DesktopState* state = this->OpenDesktopState();
+		if (!state) return false;
+		this->MarkDesktopStateRead();
+		return readDesktopState(state, [&count](const DesktopState* s) { count = s->count; })
+			&& this->IsDesktopStateFresh(state);
+	}
+
+	// @brief 移动快照中的全部图标
+	// @note 同 MoveIcon(const IconPositionMove*, size_t, bool)，数据在填入共享内存缓冲区时才转换
+	bool MoveIcon(const IconSnapshot& snapshot, bool isRate = false) {
+		logMessage.log(L"MoveIcon: 准备移动 " + to_wstring(snapshot.size()) + L" 个图标");
+
+		const CommandID command = isRate ? CommandID::COMMAND_MOVE_ICON_BY_RATE : CommandID::COMMAND_MOVE_ICON;
+		auto pSharedData = this->NewCommand(command);
 
 		bool result = true;
-		size_t j = 0; // 索引
-		do {
-			pSharedData->size = static_cast<int>(maxSizeOnce); // 本次获取的最大数量
-			pSharedData->u_batchIndex = j;
-
-			result = this->run(pSharedData.get()) && result;  // 只要有一次处理异常，result 就是 false
-			// run 之后，pSharedData->size 为实际获取的数量
-			if (!result) {
-				logMessage.warning(L"GetAllIcons: 在获取图标位置时发生错误：run 执行失败");
-				return -1;
-			}
-			if (j + pSharedData->size > size) { // 超限
-				logMessage.warning(L"GetAllIcons: 所给的缓冲区过小：提供 IconPositionMove 数组大小仅为 " +
-					to_wstring(size) +
-					L"，但实际已经需要 " +
-					to_wstring(j + pSharedData->size) + L" 个");
-				return -1;
+		for (size_t i = 0; i < snapshot.size(); i += MAX_ICON_COUNT)
+		{
+			if (this->cancelRequested) {
+				logMessage.warning(L"MoveIcon: 已取消，完成 " + to_wstring(i) + L" / " + to_wstring(snapshot.size()) + L" 个");
+				return false;
 			}
-			for (int i = 0; i < pSharedData->size; ++i) // 拷回数据
-				ipm[j + i] = pSharedData->iconPositionMove[i];
+			size_t localSize = min(snapshot.size() - i, (size_t)MAX_ICON_COUNT);
+			ResetCommand(pSharedData.get(), command);
+			for (size_t j = 0; j < localSize; ++j)
+				snapshot.toLegacy(i + j, pSharedData->iconPositionMove[j]);
+			pSharedData->size = static_cast<int>(localSize);
+
+			result = this->run(pSharedData.get()) && result;
+			this->ReportAgentError(L"MoveIcon", pSharedData.get());
+		}
+
+		return result;
+	}
+
+	// @brief 平滑移动快照中的全部图标
+	// @param params 动画参数；params.byRate 表示快照中是否为比率坐标
+	// @ret 对方是否响应并执行全部命令（不是对方命令执行的结果）
+	// @note 起点为图标的当前位置，由 Agent 按帧率插值；超过 MAX_ICON_COUNT 个时分批依次播放
+	bool AnimateIcon(const IconSnapshot& snapshot, const AnimationParams& params) {
+		logMessage.log(L"AnimateIcon: 准备平滑移动 " + to_wstring(snapshot.size()) + L" 个图标，时长 " + to_wstring(params.duration) + L" ms");
+
+		auto pSharedData = this->NewCommand(CommandID::COMMAND_ANIMATE);
 
-			j += pSharedData->size;
-			if (j >= INT_MAX) {
-				logMessage.warning(L"GetAllIcons: j >= INT_MAX，请检查程序运行情况");
-				return -1;
+		bool result = true;
+		for (size_t i = 0; i < snapshot.size(); i += MAX_ICON_COUNT)
+		{
+			if (this->cancelRequested) {
+				logMessage.warning(L"AnimateIcon: 已取消，完成 " + to_wstring(i) + L" / " + to_wstring(snapshot.size()) + L" 个");
+				return false;
 			}
-		} while (pSharedData->size == maxSizeOnce);
+			size_t localSize = min(snapshot.size() - i, (size_t)MAX_ICON_COUNT);
+			ResetCommand(pSharedData.get(), CommandID::COMMAND_ANIMATE);
+			for (size_t j = 0; j < localSize; ++j)
+				snapshot.toLegacy(i + j, pSharedData->iconPositionMove[j]);
+			pSharedData->size = static_cast<int>(localSize);
+			pSharedData->animation = params;
 
-		logMessage.success(L"GetAllIcons: 成功获取" + to_wstring(j) + L" 个");
+			result = this->run(pSharedData.get()) && result;
+			logMessage.info(L"AnimateIcon: 绘制 " + to_wstring(pSharedData->framesRendered) + L" 帧，丢帧 " + to_wstring(pSharedData->framesDropped));
+			this->ReportAgentError(L"AnimateIcon", pSharedData.get());
+		}
 
-		return static_cast<int>(j);
+		return result;
 	}
 
 	// @brief 刷新桌面
 	// @ret 对方是否响应并执行命令（不是对方命令执行的结果）
 	bool RefreshDesktop() {
 		logMessage.log(L"RefreshDesktop: 刷新桌面：消息已发送");
-		unique_ptr<SharedData> pSharedData = make_unique<SharedData>();
-		pSharedData->command = CommandID::COMMAND_REFRESH_DESKTOP;
+		auto pSharedData = this->NewCommand(CommandID::COMMAND_REFRESH_DESKTOP);
 
 		return this->run(pSharedData.get());
 	}
@@ -259,8 +466,7 @@ public:
 	// @ret 对方是否响应并执行命令（不是对方命令执行的结果）
 	bool ShowDesktop() {
 		logMessage.log(L"ShowDesktop: 显示桌面：按键模拟");
-		unique_ptr<SharedData> pSharedData = make_unique<SharedData>();
-		pSharedData->command = CommandID::COMMAND_SHOW_DESKTOP;
+		auto pSharedData = this->NewCommand(CommandID::COMMAND_SHOW_DESKTOP);
 
 		return this->run(pSharedData.get());
 	}
@@ -268,8 +474,7 @@ public:
 	// @brief 禁用对齐网格
 	// @ret 是否成功禁用对齐网格
 	bool DisableSnapToGrid() {
-		unique_ptr<SharedData> pSharedData = make_unique<SharedData>();
-		pSharedData->command = CommandID::COMMAND_DISABLE_SNAP_TO_GRID;
+		auto pSharedData = this->NewCommand(CommandID::COMMAND_DISABLE_SNAP_TO_GRID);
 		if (!this->run(pSharedData.get())) {
 			logMessage.warning(L"DisableSnapToGrid: 禁用对齐网格失败");
 			return false;
@@ -282,8 +487,7 @@ public:
 	// @ret 是否成功禁用自动排列
 	bool DisableAutoArrange()
 	{
-		unique_ptr<SharedData> pSharedData = make_unique<SharedData>();
-		pSharedData->command = CommandID::COMMAND_DISABLE_AUTO_ARRANGE;
+		auto pSharedData = this->NewCommand(CommandID::COMMAND_DISABLE_AUTO_ARRANGE);
 		if (!this->run(pSharedData.get())) {
 			logMessage.warning(L"DisableAutoArrange: 禁用自动排列失败");
 		}
@@ -296,8 +500,12 @@ public:
 	int GetIconsNumber()
 	{
 		logMessage.log(L"GetIconsNumber: 准备获取桌面图标数量");
-		unique_ptr<SharedData> pSharedData = make_unique<SharedData>();
-		pSharedData->command = CommandID::COMMAND_GET_ICON_NUMBER;
+		int count = 0;
+		if (this->ReadDesktopIconCount(count)) {
+			logMessage.success(L"GetIconsNumber: 从桌面状态读取图标数量：数量为 " + to_wstring(count) + L" 个");
+			return count;
+		}
+		auto pSharedData = this->NewCommand(CommandID::COMMAND_GET_ICON_NUMBER);
 		if (!this->run(pSharedData.get())) {
 			logMessage.warning(L"GetIconsNumber: 获取桌面图标数量失败");
 			return -1;
@@ -309,8 +517,7 @@ public:
 	// @brief 清除远程线程的日志
 	bool ClearLogFile()
 	{
-		unique_ptr<SharedData> pSharedData = make_unique<SharedData>();
-		pSharedData->command = CommandID::COMMAND_CLEAR_LOG_FILE;
+		auto pSharedData = this->NewCommand(CommandID::COMMAND_CLEAR_LOG_FILE);
 		if (!this->run(pSharedData.get())) {
 			logMessage.warning(L"ClearLogFile: 清除远程线程日志失败");
 		}
@@ -329,17 +536,415 @@ public:
 		return make_unique<IconPositionMove[]>(iconNumber);
 	}
 
+	// @brief 命令缓冲区累计分配次数
+	// @note 缓冲区用完归还到池中，稳定运行时这个数字不再增长
+	size_t GetCommandBufferAllocations() const {
+		return this->commandBuffers.allocations();
+	}
+
+	// @brief 当前操作中 Agent 最后回传的错误（如界面线程无响应、取消时停在哪里），没有错误时为空
+	// @note 每个操作开始时清空
+	const wstring& GetLastAgentError() const {
+		return this->lastAgentError;
+	}
+
+	// @brief 是否在控制台打印每次通信的数据（默认打印）
+	// @note 长时间运行的模式（如 watch）应关闭，避免刷屏
+	void SetConsoleTrace(bool enable) {
+		this->consoleTrace = enable;
+	}
+
 private:
-	// @brief 通过共享内存发送命令
+	// @brief 从池中取一块命令缓冲区并重置
+	// @note 每个操作都从 NewCommand 开始，所以在这里清除上一个操作的取消请求
+	BufferPool<SharedData>::Lease NewCommand(CommandID command) {
+		this->cancelRequested = false;
+		this->lastAgentError.clear();
+		auto commandData = this->commandBuffers.acquire();
+		ResetCommand(commandData.get(), command);
+		return commandData;
+	}
+
+	// @brief 打开桌面状态共享内存（只读）
+	// @ret 状态视图；Agent 还没有创建时返回 nullptr，下次再试
+	const DesktopState* OpenDesktopState() {
+		if (this->stateView) return this->stateView;
+
+		this->stateMapping = OpenFileMappingW(FILE_MAP_READ, FALSE, DESKTOP_STATE_NAME);
+		if (!this->stateMapping) return nullptr;
+		this->stateView = reinterpret_cast<const DesktopState*>(MapViewOfFile(this->stateMapping, FILE_MAP_READ, 0, 0, sizeof(DesktopState)));
+		if (!this->stateView) {
+			CloseHandle(this->stateMapping);
+			this->stateMapping = nullptr;
+		}
+		return this->stateView;
+	}
+
+	// @brief 写一次读者心跳，让 Agent 继续在空闲时刷新桌面状态
+	// @note 心跳在单独的共享内存中，打开失败时下次再试
+	void MarkDesktopStateRead() {
+		if (!this->readerView) {
+			if (!this->readerMapping)
+				this->readerMapping = OpenFileMappingW(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, DESKTOP_STATE_READER_NAME);
+			if (!this->readerMapping) return;
+			this->readerView = reinterpret_cast<DesktopStateReader*>(MapViewOfFile(this->readerMapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(DesktopStateReader)));
+			if (!this->readerView) {
+				CloseHandle(this->readerMapping);
+				this->readerMapping = nullptr;
+				return;
+			}
+		}
+		markDesktopStateRead(this->readerView);
+	}
+
+	// @brief 桌面状态是否仍然有效
+	// @note 最近一次确认要晚于本进程最后一次改变桌面的命令，并且没有超过 DESKTOP_STATE_MAX_AGE
+	bool IsDesktopStateFresh(const DesktopState* state) const {
+		const ULONGLONG updated = state->updateTick;
+		return updated >= this->lastCommandTick && GetTickCount64() - updated <= DESKTOP_STATE_MAX_AGE;
+	}
+
+	// @brief 重置命令头部（与 SharedData 的默认值一致）
+	// @note 不清零 iconPositionMove：只有 size 范围内的数据会被发送和读取
+	static void ResetCommand(SharedData* commandData, CommandID command) {
+		commandData->command = command;
+		commandData->size = INT_MAX;
+		commandData->u_batchIndex = SIZE_MAX;
+		commandData->generation = 0;
+		commandData->totalCount = -1;
+		commandData->errorNumber = SIZE_MAX;
+		commandData->errorMessage[0] = L'\0';
+	}
+
+	// @brief 分页枚举：所有分页都来自 Agent 的同一份快照
+	// @param command COMMAND_GET_ICON 或 COMMAND_GET_POSITIONS
+	// @param pageSize 每页最大数量
+	// @param restart 收到第一页时调用，参数为图标总数；（重新）开始前应清空已收到的数据，返回 false 放弃
+	// @param page 每收到一页调用一次，数据按索引顺序到达
+	// @ret 是否成功
+	// @note 第一页的响应带回快照代号与图标总数，之后的请求带上代号；
+	//			枚举期间快照被替换（如另一个客户端也在枚举）时从头重来，最多 ENUMERATION_RETRIES 次
+	// @note 快照被替换时 Agent 不报错，只回传新的代号与 size = 0
+	// @note 按总数判断结束，图标数恰好是 pageSize 的整数倍时不需要多一次空请求
+	bool EnumeratePages(CommandID command, int pageSize,
+		const std::function<bool(int total)>& restart,
+		const std::function<void(const SharedData* page)>& page)
+	{
+		auto pSharedData = this->NewCommand(command);
+
+		for (int attempt = 0; attempt <= ENUMERATION_RETRIES; ++attempt) {
+			uint32_t generation = 0;	// 0：开始新的枚举
+			size_t j = 0;				// 索引
+			int total = 0;
+			bool stale = false;
+			do {
+				if (this->cancelRequested)
+					return false;
+				ResetCommand(pSharedData.get(), command);
+				pSharedData->size = pageSize; // 本次获取的最大数量
+				pSharedData->u_batchIndex = j;
+				pSharedData->generation = generation;
+
+				if (!this->run(pSharedData.get()))
+					return false;
+				if (generation != 0 && pSharedData->generation != generation) {
+					stale = true;
+					break;
+				}
+				if (pSharedData->size < 0 || pSharedData->totalCount < 0)
+					return false;
+
+				if (generation == 0) {
+					generation = pSharedData->generation;
+					total = pSharedData->totalCount;
+					if (!restart(total))
+						return false;
+				}
+				if (j + pSharedData->size > static_cast<size_t>(total) || (pSharedData->size == 0 && j < static_cast<size_t>(total)))
+					return false; // 同一份快照的数据不会变多或变少
+
+				page(pSharedData.get());
+				j += pSharedData->size;
+			} while (j < static_cast<size_t>(total));
+
+			if (!stale)
+				return true;
+			logMessage.warning(L"EnumeratePages: 枚举期间快照已更新（代号 " + to_wstring(generation) + L" -> " +
+				to_wstring(pSharedData->generation) + L"），从头开始");
+		}
+
+		logMessage.warning(L"EnumeratePages: 快照反复更新，放弃枚举");
+		return false;
+	}
+
+	// @brief 请求中携带的数据字节数
+	static size_t RequestPayloadBytes(const SharedData* commandData) {
+		switch (commandData->command) {
+		case CommandID::COMMAND_MOVE_ICON:
+		case CommandID::COMMAND_MOVE_ICON_BY_RATE:
+		case CommandID::COMMAND_ANIMATE:
+			return static_cast<size_t>(max(0, min(commandData->size, MAX_ICON_COUNT))) * sizeof(IconPositionMove);
+		default:
+			return 0;
+		}
+	}
+
+	// @brief 响应中携带的数据字节数
+	static size_t ResponsePayloadBytes(const SharedData* commandData) {
+		switch (commandData->command) {
+		case CommandID::COMMAND_GET_ICON:
+			return static_cast<size_t>(max(0, min(commandData->size, MAX_ICON_COUNT))) * sizeof(IconPositionMove);
+		case CommandID::COMMAND_GET_POSITIONS:
+			return static_cast<size_t>(max(0, min(commandData->size, MAX_POSITION_COUNT))) * sizeof(IconPositionHash);
+		default:
+			return 0;
+		}
+	}
+
+	// @brief 记录 Agent 回传的错误
+	// @param caller 调用者名称（用于日志）
+	// @param response 命令的响应；errorNumber 仍为 ResetCommand 的 SIZE_MAX 表示 Agent 没有响应
+	void ReportAgentError(const wchar_t* caller, const SharedData* response) {
+		if (response->errorNumber == 0) return;
+		this->lastAgentError = response->errorNumber == SIZE_MAX
+			? L"Agent 没有响应"
+			: to_wstring(response->errorNumber) + L" 个错误，最后一次错误：" + wstring(response->errorMessage);
+		logMessage.warning(wstring(caller) + L": " + this->lastAgentError);
+	}
+
+	// @brief 复制命令：命令头 + 数据区的前 payloadBytes 个字节
+	// @note 没有图标数据的命令只复制约 1 KB 的头部，而不是整个 SharedData
+	static void CopyCommand(SharedData* destination, const SharedData* source, size_t payloadBytes) {
+		destination->command = source->command;
+		if (payloadBytes)
+			memcpy(destination->iconPositionMove, source->iconPositionMove, payloadBytes);
+		constexpr size_t header = offsetof(SharedData, size); // iconPositionMove 之后的所有字段
+		memcpy(reinterpret_cast<char*>(destination) + header, reinterpret_cast<const char*>(source) + header, sizeof(SharedData) - header);
+	}
+
+	// @brief 复制状态反馈区：errorNumber 及之后的所有字段
+	static void CopyFeedback(SharedData* destination, const SharedData* source) {
+		constexpr size_t feedback = offsetof(SharedData, errorNumber);
+		memcpy(reinterpret_cast<char*>(destination) + feedback, reinterpret_cast<const char*>(source) + feedback, sizeof(SharedData) - feedback);
+	}
+
+	// @brief 发送命令，explorer 重启时自动重新注入
 	// @param commandData 共享内存数据
 	// @ret 是否成功
 	// @note commandData 会被更新
+	// @note 命令执行期间 explorer 重启的，重新注入后重放可以安全重复执行的命令
 	bool run(SharedData* commandData) {
+		if (this->recovering || !this->lifecycle.IsWatching())
+			return this->runOnce(commandData);
+
+		// 上次命令之后 explorer 已经退出
+		if (this->lifecycle.HasExited() && !this->RecoverFromExplorerExit())
+			return false;
+
+		const unsigned long generation = this->lifecycle.GetGeneration();
+		bool result = this->runOnce(commandData);
+		if (this->lifecycle.GetGeneration() == generation)
+			return result;
+
+		// 执行期间 explorer 退出
+		if (!this->RecoverFromExplorerExit())
+			return false;
+		if (!IsReplayable(commandData->command)) {
+			logMessage.warning(L"run: 命令 " + to_wstring(static_cast<int>(commandData->command)) + L" 不能重复执行，放弃重放");
+			return false;
+		}
+		logMessage.info(L"run: 重放命令 " + to_wstring(static_cast<int>(commandData->command)));
+		return this->runOnce(commandData);
+	}
+
+	// @brief 命令是否可以安全地重复执行
+	// @note 显示桌面（Win + D）会来回切换；退出类命令重复执行没有意义
+	static bool IsReplayable(CommandID command) {
+		switch (command) {
+		case CommandID::COMMAND_MOVE_ICON:
+		case CommandID::COMMAND_MOVE_ICON_BY_RATE:
+		case CommandID::COMMAND_ANIMATE:
+		case CommandID::COMMAND_REFRESH_DESKTOP:
+		case CommandID::COMMAND_IS_OK:
+		case CommandID::COMMAND_GET_ICON:
+		case CommandID::COMMAND_GET_ICON_NUMBER:
+		case CommandID::COMMAND_GET_FINGERPRINT:
+		case CommandID::COMMAND_DISABLE_SNAP_TO_GRID:
+		case CommandID::COMMAND_DISABLE_AUTO_ARRANGE:
+		case CommandID::COMMAND_CLEAR_LOG_FILE:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// @brief explorer 退出后：等待新的 explorer 出现并重新注入，失败时指数退避
+	// @note 超过 EXPLORER_RELAUNCH_TIMEOUT 仍没有 explorer 时手动启动一次
+	bool RecoverFromExplorerExit() {
+		logMessage.warning(L"RecoverFromExplorerExit: explorer 已退出，准备重新注入");
+		this->recovering = true;
+		this->lifecycle.Unwatch();
+
+		const ULONGLONG start = GetTickCount64();
+		bool relaunched = false;
+		DWORD backoff = REINJECT_BACKOFF;
+		bool recovered = false;
+		for (int attempt = 1; attempt <= REINJECT_ATTEMPTS && !recovered; ++attempt, backoff *= 2) {
+			Sleep(backoff);
+			if (!FindWindow(L"Progman", L"Program Manager")) {
+				if (!relaunched && GetTickCount64() - start >= EXPLORER_RELAUNCH_TIMEOUT) {
+					logMessage.warning(L"RecoverFromExplorerExit: explorer 没有自动重启，正在启动");
+					relaunched = this->StartExplorer();
+				}
+				continue;
+			}
+			logMessage.info(L"RecoverFromExplorerExit: 第 " + to_wstring(attempt) + L" 次尝试重新注入");
+			recovered = this->InjectDLLEx(true);
+		}
+		this->recovering = false;
+
+		if (recovered) {
+			logMessage.success(L"RecoverFromExplorerExit: 重新注入成功，用时 " + to_wstring(GetTickCount64() - start) + L" ms");
+			wcout << L"检测到资源管理器重启，已重新注入" << endl;
+		}
+		else {
+			logMessage.error(L"RecoverFromExplorerExit: 重新注入失败");
+		}
+		return recovered;
+	}
+
+	// @brief 等待响应事件；explorer 退出时立即返回 false
+	bool WaitResponse(HANDLE rspEvent, DWORD timeout) {
+		HANDLE process = this->lifecycle.GetProcessHandle();
+		if (!process || this->recovering)
+			return WaitForSingleObject(rspEvent, timeout) == WAIT_OBJECT_0;
+
+		const HANDLE handles[] = { rspEvent, process };
+		switch (WaitForMultipleObjects(2, handles, FALSE, timeout)) {
+		case WAIT_OBJECT_0:
+			return true;
+		case WAIT_OBJECT_0 + 1:
+			logMessage.warning(L"run: 等待响应时 explorer 退出");
+			return false;
+		default:
+			return false;
+		}
+	}
+
+	// @brief 等待主通道命令完成，期间通过控制通道查询并显示进度
+	// @param timeout 没有进展时的超时时间
+	// @note 只要 Agent 报告的进度还在前进，超时时间就从最近一次前进重新计算
+	// @note Agent 报告 explorer 界面线程无响应时，只再等 HUNG_GRACE 接收诊断信息，不再等满超时时间
+	bool WaitOperation(HANDLE rspEvent, DWORD timeout) {
+		ULONGLONG deadline = GetTickCount64() + timeout;
+		int lastDone = -1;
+		bool reported = false;
+		bool hung = false;
+		while (true) {
+			const ULONGLONG now = GetTickCount64();
+			if (now >= deadline) break;
+			if (this->WaitResponse(rspEvent, static_cast<DWORD>(std::min<ULONGLONG>(PROGRESS_INTERVAL, deadline - now)))) {
+				if (reported) wcout << endl;
+				return true;
+			}
+			if (this->lifecycle.HasExited()) break;
+
+			ControlData control;
+			control.command = CommandID::COMMAND_IS_OK;
+			if (!this->runControl(control)) continue;
+			if (control.uiHung && !hung) {
+				hung = true;
+				deadline = std::min<ULONGLONG>(deadline, GetTickCount64() + HUNG_GRACE);
+				logMessage.warning(L"WaitOperation: explorer 界面线程无响应，等待 Agent 中止当前命令");
+			}
+			if (control.progressTotal <= 0) continue;
+			if (control.progressDone != lastDone && !hung) {
+				lastDone = control.progressDone;
+				deadline = GetTickCount64() + timeout;
+			}
+
+			const ULONGLONG elapsed = std::max<ULONGLONG>(GetTickCount64() - control.activeSinceTick, 1);
+			if (this->consoleTrace) {
+				wcout << L"\r进度: " << control.progressDone << L" / " << control.progressTotal
+					<< L"，错误 " << control.progressErrors
+					<< L"，" << control.progressDone * 1000ULL / elapsed << L" 个/秒   " << flush;
+				reported = true;
+			}
+		}
+		if (reported) wcout << endl;
+		if (hung) wcout << L"explorer 无响应，命令已中止" << endl;
+		return false;
+	}
+
+	// @brief 通过控制通道发送一条轻量命令
+	// @param control 命令数据，会被更新
+	// @ret 是否成功
+	// @note 控制通道有独立的互斥锁与事件，不会排在主通道的批量命令之后
+	bool runControl(ControlData& control) {
+		struct HandleGuard {
+			HANDLE handle = nullptr;
+			explicit HandleGuard(HANDLE h = nullptr) : handle(h) {}
+			~HandleGuard() {
+				if (handle && handle != INVALID_HANDLE_VALUE)
+					CloseHandle(handle);
+			}
+			operator HANDLE() const { return handle; }
+		};
+
+		HandleGuard hMutex(CreateMutexW(NULL, FALSE, CONTROL_MUTEX_NAME));
+		if (!hMutex || WaitForSingleObject(hMutex, SURIVIVAL_TIMEOUT) != WAIT_OBJECT_0) {
+			logMessage.warning(L"runControl: 等待控制通道互斥锁失败");
+			return false;
+		}
+		struct MutexRelease {
+			HANDLE mutex;
+			~MutexRelease() { ReleaseMutex(mutex); }
+		} release{ hMutex };
+
+		HandleGuard cmdEvent(OpenEventW(EVENT_MODIFY_STATE, FALSE, CONTROL_CMD_EVENT_NAME));
+		HandleGuard rspEvent(OpenEventW(SYNCHRONIZE | EVENT_MODIFY_STATE, FALSE, CONTROL_RSP_EVENT_NAME));
+		HandleGuard mapping(OpenFileMappingW(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, CONTROL_MEM_NAME));
+		if (!cmdEvent || !rspEvent || !mapping)
+			return false; // Agent 不在线
+
+		ControlData* view = reinterpret_cast<ControlData*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(ControlData)));
+		if (!view) {
+			logMessage.warning(L"runControl: 映射控制通道失败，错误代码为 " + to_wstring(GetLastError()));
+			return false;
+		}
+
+		// 互斥锁保证同一时刻只有一条控制命令；先清掉上一次超时后迟到的响应
+		*view = control;
+		ResetEvent(rspEvent);
+		SetEvent(cmdEvent);
+		bool result = false;
+		if (this->WaitResponse(rspEvent, SURIVIVAL_TIMEOUT)) {
+			control = *view;
+			result = control.errorNumber == 0;
+		}
+		UnmapViewOfFile(view);
+		if (!result)
+			logMessage.warning(L"runControl: 控制通道无响应");
+		return result;
+	}
+
+	// @brief 通过共享内存发送一次命令
+	// @param commandData 共享内存数据
+	// @ret 是否成功
+	// @note commandData 会被更新
+	bool runOnce(SharedData* commandData) {
 		if (!commandData) {
 			logMessage.warning(L"run: 指令指针为空");
 			return false;
 		}
 
+		// 标记主通道忙，RequestCancel 据此判断是否有命令可以取消
+		struct BusyGuard {
+			std::atomic<bool>& busy;
+			explicit BusyGuard(std::atomic<bool>& busy) : busy(busy) { busy = true; }
+			~BusyGuard() { busy = false; }
+		} busyGuard(this->busy);
+
 		// 句柄的 RAII 包装器
 		struct HandleGuard {
 			HANDLE handle = nullptr;
@@ -435,23 +1040,24 @@ private:
 			return false;
 		}
 
-		if (!(WaitForSingleObject(rspEvent,
+		if (!this->WaitResponse(rspEvent,
 			(sharedMemView->command == CommandID::COMMAND_IS_OK)
 			? SURIVIVAL_TIMEOUT
-			: CURRENT_OPERATION_TIMEOUT)
-			== WAIT_OBJECT_0)) {
+			: CURRENT_OPERATION_TIMEOUT)) {
 			ReleaseMutex(hMutex);
 			logMessage.warning(L"run: 等待前一次响应超时");
 			return false;
 		}
 
-		wcout << (L"---------- send -------------") << endl;
-		wcout << (L"commandData->command      = " + to_wstring(static_cast<int>(commandData->command))) << endl;
-		wcout << (L"commandData->size         = " + to_wstring(commandData->size)) << endl;
-		wcout << (L"commandData->u_batchIndex = " + to_wstring(commandData->u_batchIndex)) << endl;
-		wcout << (L"commandData->errorNumber  = " + to_wstring(commandData->errorNumber)) << endl;
-		wcout << (L"commandData->errorMessage = " + wstring(commandData->errorMessage)) << endl;
-		wcout << (L"-----------------------------") << endl;
+		if (this->consoleTrace) {
+			wcout << (L"---------- send -------------") << endl;
+			wcout << (L"commandData->command      = " + to_wstring(static_cast<int>(commandData->command))) << endl;
+			wcout << (L"commandData->size         = " + to_wstring(commandData->size)) << endl;
+			wcout << (L"commandData->u_batchIndex = " + to_wstring(commandData->u_batchIndex)) << endl;
+			wcout << (L"commandData->errorNumber  = " + to_wstring(commandData->errorNumber)) << endl;
+			wcout << (L"commandData->errorMessage = " + wstring(commandData->errorMessage)) << endl;
+			wcout << (L"-----------------------------") << endl;
+		}
 
 		// 复制数据到共享内存
 		logMessage.log(L"---------- 发送命令 ----------");
@@ -462,16 +1068,17 @@ private:
 		logMessage.log(L"commandData->errorMessage = " + wstring(commandData->errorMessage));
 		logMessage.log(L"-----------------------------");
 		logMessage.log(L"等待命令执行");
-		memcpy_s(sharedMemView, sizeof(SharedData), commandData, sizeof(SharedData));
+		commandData->sliceBudget = this->sliceBudget;
+		CopyCommand(sharedMemView, commandData, RequestPayloadBytes(commandData));
+		if (!isQueryCommand(commandData->command))
+			this->lastCommandTick = GetTickCount64(); // 在此之前发布的桌面状态可能已经过时
 		SetEvent(cmdEvent); // 通知DLL有新的命令
 
 		// 等待操作完成
 		bool operationSuccess = false;
-		if (!(WaitForSingleObject(rspEvent,
-			(sharedMemView->command == CommandID::COMMAND_IS_OK)
-			? SURIVIVAL_TIMEOUT
-			: CURRENT_OPERATION_TIMEOUT)
-			== WAIT_OBJECT_0)) {
+		if (!((sharedMemView->command == CommandID::COMMAND_IS_OK)
+			? this->WaitResponse(rspEvent, SURIVIVAL_TIMEOUT)
+			: this->WaitOperation(rspEvent, CURRENT_OPERATION_TIMEOUT))) {
 			ReleaseMutex(hMutex);
 			logMessage.warning(L"run: 等待命令执行超时");
 			return false;
@@ -484,28 +1091,34 @@ private:
 		logMessage.log(L"sharedMemView->u_batchIndex = " + to_wstring(sharedMemView->u_batchIndex));
 		logMessage.log(L"sharedMemView->errorNumber  = " + to_wstring(sharedMemView->errorNumber));
 		logMessage.log(L"sharedMemView->errorMessage = " + wstring(sharedMemView->errorMessage));
+		if (sharedMemView->sliceCount)
+			logMessage.log(L"sharedMemView->sliceCount   = " + to_wstring(sharedMemView->sliceCount) +
+				L"（最长 " + to_wstring(sharedMemView->maxSliceMicroseconds) + L" us）");
 		logMessage.log(L"-----------------------------");
 
-		wcout << (L"---------- request ----------") << endl;
-		wcout << (L"sharedMemView->command      = " + to_wstring(static_cast<int>(sharedMemView->command))) << endl;
-		wcout << (L"sharedMemView->size         = " + to_wstring(sharedMemView->size)) << endl;
-		wcout << (L"sharedMemView->u_batchIndex = " + to_wstring(sharedMemView->u_batchIndex)) << endl;
-		wcout << (L"sharedMemView->errorNumber  = " + to_wstring(sharedMemView->errorNumber)) << endl;
-		wcout << (L"sharedMemView->errorMessage = " + wstring(sharedMemView->errorMessage)) << endl;
-		wcout << (L"-----------------------------") << endl;
+		if (this->consoleTrace) {
+			wcout << (L"---------- request ----------") << endl;
+			wcout << (L"sharedMemView->command      = " + to_wstring(static_cast<int>(sharedMemView->command))) << endl;
+			wcout << (L"sharedMemView->size         = " + to_wstring(sharedMemView->size)) << endl;
+			wcout << (L"sharedMemView->u_batchIndex = " + to_wstring(sharedMemView->u_batchIndex)) << endl;
+			wcout << (L"sharedMemView->errorNumber  = " + to_wstring(sharedMemView->errorNumber)) << endl;
+			wcout << (L"sharedMemView->errorMessage = " + wstring(sharedMemView->errorMessage)) << endl;
+			if (sharedMemView->sliceCount)
+				wcout << (L"sharedMemView->sliceCount   = " + to_wstring(sharedMemView->sliceCount) +
+					L"（最长 " + to_wstring(sharedMemView->maxSliceMicroseconds) + L" us）") << endl;
+			wcout << (L"-----------------------------") << endl;
+		}
 
 		operationSuccess = (sharedMemView->errorNumber == 0);
-		if (operationSuccess) {
+		if (operationSuccess)
 			logMessage.success(L"run: 指令执行完成，正在将数据拷回");
-			// 拷回数据
-			memcpy_s(commandData, sizeof(SharedData), (SharedData*)sharedMemView, sizeof(SharedData));
-		}
+		// 失败时只拷回状态反馈区（错误数、错误信息与分片、帧数统计），请求部分保持原样，重放时仍是原来的命令
+		if (operationSuccess)
+			CopyCommand(commandData, sharedMemView, ResponsePayloadBytes(sharedMemView));
+		else
+			CopyFeedback(commandData, sharedMemView);
 
 		ReleaseMutex(hMutex);
-		if (!this->CheckExplorerStatus()) {
-			logMessage.warning(L"run: 资源管理器异常崩溃");
-			throw runtime_error("资源管理器异常崩溃");
-		}
 		return operationSuccess;
 	}
 
@@ -679,6 +1292,16 @@ private:
 			return false;
 		}
 
+		// 就绪事件：Agent 创建好共享内存与事件、开始等待命令后置位
+		// 先复位，避免上一次注入留下的信号
+		HandleGuard readyEvent(CreateEventW(nullptr, TRUE, FALSE, READY_EVENT_NAME));
+		if (!readyEvent) {
+			logMessage.error(L"InjectDLL: 无法创建就绪事件，错误代码：" + to_wstring(GetLastError()));
+			return false;
+		}
+		ResetEvent(readyEvent);
+		const ULONGLONG injectStart = GetTickCount64();
+
 		// 创建远程线程
 		HandleGuard hThread(CreateRemoteThread(hProcess, nullptr, 0, loadLib, remoteMem, 0, nullptr));
 		if (!hThread) {
@@ -706,15 +1329,22 @@ private:
 			return false;
 		}
 
-		logMessage.success(L"InjectDLL: DLL 成功加载到目标进程");
+		logMessage.success(L"InjectDLL: DLL 成功加载到目标进程，用时 " + to_wstring(GetTickCount64() - injectStart) + L" ms");
+
+		// 等待 Agent 就绪
+		if (WaitForSingleObject(readyEvent, READY_TIMEOUT) != WAIT_OBJECT_0) {
+			logMessage.error(L"InjectDLL: DLL 已加载，但 " + to_wstring(READY_TIMEOUT) + L" ms 内未就绪");
+			return false;
+		}
 
-		Sleep(500); // 等待线程进行初始化
+		const ULONGLONG readyTime = GetTickCount64() - injectStart;
+		logMessage.success(L"InjectDLL: Agent 已就绪，注入到就绪用时 " + to_wstring(readyTime) + L" ms");
+		wcout << L"DLL 注入完成，就绪用时 " << readyTime << L" ms" << endl;
 		return true;
 	}
 
-	// @brief 保持资源管理器存活状态
-	bool CheckExplorerStatus() {
-		if (this->GetTargetExplorerPID()) return true;
+	// @brief 启动资源管理器
+	bool StartExplorer() {
 		// 启动资源管理器
 		// 获取Windows目录路径
 		TCHAR winDir[MAX_PATH];
@@ -730,6 +1360,7 @@ private:
 		if (CreateProcess(explorerPath.c_str(), NULL, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi)) {
 			CloseHandle(pi.hThread);
 			CloseHandle(pi.hProcess);
+			return true;
 		}
 		return false;
 	}
@@ -737,4 +1368,56 @@ private:
 	// @var LogMessage logMessage
 	// @brief 用于写入日志
 	LogMessage& logMessage;
+
+	// @var bool consoleTrace
+	// @brief 是否在控制台打印通信数据
+	bool consoleTrace = true;
+
+	// @var wstring lastAgentError
+	// @brief 当前操作中 Agent 最后回传的错误
+	wstring lastAgentError;
+
+	// @var ExplorerLifecycle lifecycle
+	// @brief 跟踪注入目标 explorer 的生命周期
+	ExplorerLifecycle lifecycle{ logMessage };
+
+	// @var bool recovering
+	// @brief 正在重新注入（此时的命令不再触发恢复）
+	bool recovering = false;
+
+	// @var BufferPool<SharedData> commandBuffers
+	// @brief 命令缓冲区池（每块约 133 KB）
+	BufferPool<SharedData> commandBuffers;
+
+	// @var sliceBudget
+	// @brief 批量命令每个时间片的预算（微秒）
+	uint32_t sliceBudget = DEFAULT_SLICE_BUDGET;
+
+	// @var busy
+	// @brief 主通道正在执行命令
+	std::atomic<bool> busy{ false };
+
+	// @var cancelRequested
+	// @brief 当前操作已被取消，多批次的操作在两批之间检查
+	std::atomic<bool> cancelRequested{ false };
+
+	// @var HANDLE stateMapping
+	// @brief 桌面状态共享内存（首次读取时打开）
+	HANDLE stateMapping = nullptr;
+
+	// @var const DesktopState* stateView
+	// @brief 桌面状态只读视图
+	const DesktopState* stateView = nullptr;
+
+	// @var HANDLE readerMapping
+	// @brief 读者心跳共享内存（首次读取桌面状态时打开）
+	HANDLE readerMapping = nullptr;
+
+	// @var DesktopStateReader* readerView
+	// @brief 读者心跳视图
+	DesktopStateReader* readerView = nullptr;
+
+	// @var ULONGLONG lastCommandTick
+	// @brief 最近一次发送命令的时间，早于它的桌面状态不可信
+	ULONGLONG lastCommandTick = 0;
 };
@@ -0,0 +1,68 @@
+﻿/**
+ * @file common\animation.h
+ * @brief 图标动画参数与缓动曲线（Q16 定点）
+ */
+
+#pragma once
+#include <cstdint>
+#include <cwchar>
+#include "fixedpoint.h"
+
+constexpr uint32_t ANIMATION_DEFAULT_FPS = 60;		// 默认帧率
+constexpr uint32_t ANIMATION_MAX_FPS = 240;			// 最高帧率
+constexpr uint32_t ANIMATION_MAX_DURATION = 60000;	// 单次动画的最长时长（毫秒）
+
+// @enum Easing
+// @brief 缓动曲线
+enum class Easing : int32_t {
+	EASING_LINEAR = 0,			// 匀速
+	EASING_EASE_OUT = 1,		// 先快后慢（二次）
+	EASING_EASE_IN_OUT = 2		// 慢-快-慢（smoothstep）
+};
+
+// @struct AnimationParams
+// @brief COMMAND_ANIMATE 的参数
+// @note 起点是图标的当前位置，终点是 iconPositionMove 中的坐标
+struct AnimationParams
+{
+	uint32_t duration = 0;								// 时长（毫秒），0 表示直接移到终点
+	uint32_t framesPerSecond = ANIMATION_DEFAULT_FPS;	// 目标帧率
+	Easing easing = Easing::EASING_EASE_IN_OUT;			// 缓动曲线
+	int32_t byRate = 0;									// 终点是否为比率坐标（同 COMMAND_MOVE_ICON_BY_RATE）
+};
+
+// @brief 缓动：把线性进度换算为曲线上的进度
+// @param t 线性进度，0 ~ RATIO_Q16_ONE
+// @ret 缓动后的进度，t 为 0 / RATIO_Q16_ONE 时分别精确返回 0 / RATIO_Q16_ONE
+inline RatioQ16 easeQ16(Easing easing, RatioQ16 t) {
+	if (t <= 0) return 0;
+	if (t >= RATIO_Q16_ONE) return RATIO_Q16_ONE;
+	const int64_t x = t;
+	switch (easing) {
+	case Easing::EASING_EASE_OUT:	// t * (2 - t)
+		return static_cast<RatioQ16>((x * (2 * RATIO_Q16_ONE - x)) >> RATIO_Q16_SHIFT);
+	case Easing::EASING_EASE_IN_OUT: {	// 3t^2 - 2t^3
+		const int64_t x2 = (x * x) >> RATIO_Q16_SHIFT;
+		const int64_t x3 = (x2 * x) >> RATIO_Q16_SHIFT;
+		return static_cast<RatioQ16>(3 * x2 - 2 * x3);
+	}
+	default:
+		return t;
+	}
+}
+
+// @brief 按进度在起点与终点之间插值（四舍五入）
+// @param progress 0 ~ RATIO_Q16_ONE
+inline long interpolate(long from, long to, RatioQ16 progress) {
+	return static_cast<long>(from + roundedDivide(static_cast<int64_t>(to - from) * progress, RATIO_Q16_ONE));
+}
+
+// @brief 缓动曲线名称 -> Easing
+// @ret 是否为有效名称（linear、ease-out、ease-in-out）
+inline bool easingFromName(const wchar_t* name, Easing& easing) {
+	if (wcscmp(name, L"linear") == 0) easing = Easing::EASING_LINEAR;
+	else if (wcscmp(name, L"ease-out") == 0) easing = Easing::EASING_EASE_OUT;
+	else if (wcscmp(name, L"ease-in-out") == 0) easing = Easing::EASING_EASE_IN_OUT;
+	else return false;
+	return true;
+}
@@ -3,6 +3,9 @@
 #include <string>
 #include <vector>
 #include "icon.h"
+#include "hash.h"
+#include "animation.h"
+#include "fingerprint.h"
 constexpr auto MAX_ICON_COUNT = 256;	// ڴͼ
 
 // -------------------------------
@@ -23,7 +26,20 @@ enum class CommandID : int {
 	COMMAND_GET_ICON_NUMBER = 7,		// ȡͼ
 	COMMAND_DISABLE_SNAP_TO_GRID = 8,	// ͼ
 	COMMAND_DISABLE_AUTO_ARRANGE = 9,	// Զ
-	COMMAND_CLEAR_LOG_FILE = 10			// ־ļ
+	COMMAND_CLEAR_LOG_FILE = 10,		// ־ļ
+	COMMAND_GET_POSITIONS = 11,			// ȡͼλɢУƣ
+	COMMAND_CANCEL = 12,				// ȡִͨеֻ߿ͨ
+	COMMAND_ANIMATE = 13,				// ƽƶͼ꣨ SharedData::animation
+	COMMAND_GET_FINGERPRINT = 14		// ռλͼ 0 ~ size-1 Ĳָƣ SharedData::fingerprint
+};
+
+// @struct IconPositionHash
+// @brief յͼλã + ɢУhashNameÿ 12 ֽ
+struct IconPositionHash
+{
+	int32_t x;
+	int32_t y;
+	uint32_t nameHash;
 };
 // @struct SharedData
 // @brief ̼ͨŵĹڴݽṹ
@@ -36,10 +52,31 @@ struct SharedData
 	IconPositionMove iconPositionMove[MAX_ICON_COUNT];	// ͼλݣ + ꣩
 	int size = INT_MAX;									// iconPositionMove գ
 	size_t u_batchIndex = SIZE_MAX;						// Especial
+	uint32_t generation = 0;							// EspecialҳöٵĿմţ 0 ʾʼµö٣
+	int totalCount = -1;								// գҳöٵͼ
+	uint32_t sliceBudget = 0;							// ÿʱƬԤ㣨΢룩0 ʾƬ
+	AnimationParams animation;							// COMMAND_ANIMATE ʱ֡뻺
 
 	// -------------------------------
 	// ״̬ 
 	// -------------------------------
 	size_t errorNumber = SIZE_MAX;						// Ŀ0 ʾûд
 	wchar_t errorMessage[512] = { 0 };					// Ϣ
-};
\ No newline at end of file
+	uint32_t sliceCount = 0;							// ʵʷֳɵʱƬ
+	uint32_t maxSliceMicroseconds = 0;					// ʱƬʱ΢룩
+	uint32_t framesRendered = 0;						// COMMAND_ANIMATE ʵʻƵ֡
+	uint32_t framesDropped = 0;							// COMMAND_ANIMATE ƹ֡
+	LayoutFingerprint fingerprint;						// COMMAND_GET_FINGERPRINT ĽΪ Agent ƶͼʱʹõĻ DPI
+};
+
+// ڴԷµ IconPositionHash 
+constexpr auto MAX_POSITION_COUNT = static_cast<int>(sizeof(SharedData::iconPositionMove) / sizeof(IconPositionHash));
+
+// @brief COMMAND_GET_POSITIONS ʹõ iconPositionMove ͬһڴ
+inline IconPositionHash* positionsOf(SharedData* sharedData) {
+	return reinterpret_cast<IconPositionHash*>(sharedData->iconPositionMove);
+}
+
+inline const IconPositionHash* positionsOf(const SharedData* sharedData) {
+	return reinterpret_cast<const IconPositionHash*>(sharedData->iconPositionMove);
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+﻿/**
+ * @file common\control.h
+ * @brief 控制通道：存活检测等轻量命令，不与批量命令排队
+ */
+
+#pragma once
+#include <Windows.h>
+#include "communication.h"
+
+constexpr auto CONTROL_MEM_NAME = L"Local\\DesktopIconMoverControlMem";		// 控制通道共享内存名称
+constexpr auto CONTROL_CMD_EVENT_NAME = L"Local\\DesktopIconMoverControlCmdEvent";	// 控制通道命令事件
+constexpr auto CONTROL_RSP_EVENT_NAME = L"Local\\DesktopIconMoverControlRspEvent";	// 控制通道响应事件
+constexpr auto CONTROL_MUTEX_NAME = L"Local\\DesktopIconMoverControlMutex";		// 控制通道互斥锁
+constexpr auto READY_EVENT_NAME = L"Local\\DesktopIconMoverReadyEvent";			// 注入后 Agent 可以接收命令时置位（手动重置）
+
+// @struct ControlData
+// @brief 控制通道的共享内存数据结构
+// @note 控制通道有独立的互斥锁、事件与 Agent 线程，主通道执行大批量命令时也能立即响应
+struct ControlData
+{
+	// -------------------------------
+	// 共享数据区
+	// -------------------------------
+	CommandID command = CommandID::COMMAND_INVALID;		// 预执行的命令（COMMAND_IS_OK 或 COMMAND_CANCEL）
+
+	// -------------------------------
+	// 状态反馈区
+	// -------------------------------
+	CommandID activeCommand = CommandID::COMMAND_INVALID;	// 主通道正在执行的命令，COMMAND_INVALID 表示空闲
+	ULONGLONG activeSinceTick = 0;						// 主通道开始执行当前命令的时间（GetTickCount64）
+	int progressDone = 0;								// 主通道当前命令已处理的数量
+	int progressTotal = 0;								// 主通道当前命令需要处理的总数（0 表示不报告进度）
+	int progressErrors = 0;								// 主通道当前命令已出现的错误数
+	int uiHung = 0;										// explorer 界面线程已判定为无响应（主通道会尽快中止当前命令）
+	size_t errorNumber = SIZE_MAX;						// 错误数目（0 表示没有错误）
+};
@@ -0,0 +1,99 @@
+﻿/**
+ * @file common\desktopstate.h
+ * @brief Agent 发布的只读桌面状态（顺序锁保护的共享内存）
+ */
+
+#pragma once
+#include <Windows.h>
+#include <cstdint>
+#include "communication.h"
+
+constexpr auto DESKTOP_STATE_NAME = L"Local\\DesktopIconMoverStateMem";	// 桌面状态共享内存名称
+constexpr auto DESKTOP_STATE_READER_NAME = L"Local\\DesktopIconMoverStateReaderMem";	// 读者心跳共享内存名称
+constexpr auto MAX_STATE_ICON_COUNT = 4096;		// 桌面状态最多记录的图标数量
+constexpr DWORD DESKTOP_STATE_REFRESH = 1000;	// Agent 空闲时检查桌面变化的间隔
+constexpr DWORD DESKTOP_STATE_SETTLE = 50;		// 执行过移动等命令后，空闲多久更新桌面状态
+constexpr DWORD DESKTOP_STATE_MAX_AGE = 3 * DESKTOP_STATE_REFRESH;	// 超过这个时间没有更新的状态视为失效（Agent 正忙或已退出）
+constexpr auto DESKTOP_STATE_READ_RETRIES = 64;	// 读取时遇到写入的最大重试次数
+constexpr ULONGLONG DESKTOP_STATE_READER_TIMEOUT = 60000;	// 超过这个时间没有客户端读取，Agent 停止空闲刷新（长于 watch 默认的最长轮询间隔）
+constexpr uint32_t DESKTOP_STATE_SLICE_BUDGET = 2000;	// 空闲刷新读取图标时每个时间片的预算（微秒）
+
+// @struct DesktopState
+// @brief 桌面状态：图标数量、坐标与名称散列
+// @note 只有 Agent 写入；客户端只读映射，不加锁、不发命令
+// @note sequence 为奇数表示正在写入；读取前后 sequence 相同且为偶数，读到的数据才是一致的
+struct DesktopState
+{
+	volatile LONG sequence;						// 顺序锁计数，0 表示还没有发布过
+	DWORD agentProcessId;						// 发布者（explorer）的进程 ID
+	ULONGLONG updateTick;						// 最近一次确认状态有效的时间（GetTickCount64），数据没有变化时不经过顺序锁直接更新
+	int32_t count;								// 桌面图标总数
+	int32_t stored;								// positions 中的有效数量（count 超过 MAX_STATE_ICON_COUNT 时被截断）
+	IconPositionHash positions[MAX_STATE_ICON_COUNT];	// 图标坐标与名称散列（按列表视图索引顺序）
+};
+
+// @brief 是否为不改变桌面的查询类命令
+// @note 其它命令执行之后，Agent 会尽快更新桌面状态，客户端也不再信任之前发布的状态
+inline bool isQueryCommand(CommandID command) {
+	switch (command) {
+	case CommandID::COMMAND_IS_OK:
+	case CommandID::COMMAND_GET_ICON:
+	case CommandID::COMMAND_GET_POSITIONS:
+	case CommandID::COMMAND_GET_ICON_NUMBER:
+	case CommandID::COMMAND_GET_FINGERPRINT:
+	case CommandID::COMMAND_CLEAR_LOG_FILE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// @brief 发布新的桌面状态（只由 Agent 调用）
+// @param write 写入数据的函数，参数为 DesktopState*
+template <class Write>
+inline void publishDesktopState(DesktopState* state, Write write) {
+	InterlockedIncrement(&state->sequence);	// 变为奇数：读者会重试
+	MemoryBarrier();
+	write(state);
+	state->updateTick = GetTickCount64();
+	MemoryBarrier();
+	InterlockedIncrement(&state->sequence);	// 变回偶数：发布完成
+}
+
+// @struct DesktopStateReader
+// @brief 读者心跳：客户端唯一可以写入的共享内存，与桌面状态分开映射，桌面状态对客户端保持只读
+// @note Agent 只在最近有读者时才在空闲时刷新状态；没有读者时，状态只在执行过改变桌面的命令后更新
+struct DesktopStateReader
+{
+	volatile LONG64 readerTick;					// 最近一次有客户端读取的时间（GetTickCount64）
+};
+
+// @brief 记录一次读取（只由客户端调用）
+inline void markDesktopStateRead(DesktopStateReader* reader) {
+	InterlockedExchange64(&reader->readerTick, static_cast<LONG64>(GetTickCount64()));
+}
+
+// @brief 最近 DESKTOP_STATE_READER_TIMEOUT 内是否有客户端读取过（只由 Agent 调用）
+inline bool hasRecentDesktopStateReader(const DesktopStateReader* reader) {
+	return GetTickCount64() - static_cast<ULONGLONG>(reader->readerTick) <= DESKTOP_STATE_READER_TIMEOUT;
+}
+
+// @brief 读取一致的桌面状态
+// @param read 读取数据的函数，参数为 const DesktopState*；可能被调用多次，只有最后一次的结果有效
+// @ret 是否读到一致的数据（从未发布过或多次重试仍在写入时返回 false）
+template <class Read>
+inline bool readDesktopState(const DesktopState* state, Read read) {
+	for (int attempt = 0; attempt < DESKTOP_STATE_READ_RETRIES; ++attempt) {
+		const LONG before = state->sequence;
+		if (before == 0) return false;
+		if (before & 1) {
+			YieldProcessor();
+			continue;
+		}
+		MemoryBarrier();
+		read(state);
+		MemoryBarrier();
+		if (state->sequence == before) return true;
+	}
+	return false;
+}
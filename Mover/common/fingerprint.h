@@ -0,0 +1,82 @@
+﻿/**
+ * @file common\fingerprint.h
+ * @brief 布局指纹：快速判断桌面是否已经是目标布局
+ */
+
+#pragma once
+#include <cstdint>
+#include "fixedpoint.h"
+#include "hash.h"
+
+// @var LAYOUT_TOLERANCE
+// @brief 默认允许的位置偏差（逻辑像素）：LayoutDiff（--tolerance 的默认值）与布局指纹共用
+constexpr int LAYOUT_TOLERANCE = 2;
+
+// @brief 指纹量化格子的边长（设备像素）
+// @note 取 LAYOUT_TOLERANCE 按 DPI 缩放后加 1：同一格内的两个坐标相差不超过容差，不会把偏离的图标当成已就位
+inline int32_t fingerprintQuantum(uint32_t dpi) {
+	return pixelToDevicePixel(LAYOUT_TOLERANCE, dpi) + 1;
+}
+
+// @brief 64 位混合函数（SplitMix64 的终结步骤）
+inline uint64_t mixFingerprint(uint64_t value) {
+	value ^= value >> 30;
+	value *= 0xBF58476D1CE4E5B9ULL;
+	value ^= value >> 27;
+	value *= 0x94D049BB133111EBULL;
+	value ^= value >> 31;
+	return value;
+}
+
+// @struct LayoutFingerprint
+// @brief 布局指纹：各图标（名称散列 + 量化坐标）散列之和，与图标顺序无关
+// @note 坐标量化到目标桌面的设备像素网格（screenWidth × screenHeight，dpi），
+//			与 Agent 移动图标时的换算完全相同：由本工具摆放的图标，文件与桌面两边算出的指纹逐位相同
+// @note 设备像素再按 quantum 分格后才参与散列（Agent 取 fingerprintQuantum(dpi)，即 LayoutDiff 的默认容差），
+//			被挪动一两个像素、仍在同一格内的图标不影响指纹；靠近格子边界的图标偏移后可能落入相邻格子，
+//			这时指纹不一致，照常移动，结果仍然正确
+// @note 默认网格为 RATIO_Q16_ONE × RATIO_Q16_ONE、DPI_BASE，即直接使用 Q16 坐标，用于脱离桌面比较两个文件
+struct LayoutFingerprint
+{
+	uint64_t value = 0;						// 各图标散列之和
+	uint32_t count = 0;						// 参与计算的图标数
+	int32_t screenWidth = RATIO_Q16_ONE;	// 量化网格：屏幕宽（像素）
+	int32_t screenHeight = RATIO_Q16_ONE;	// 量化网格：屏幕高（像素）
+	uint32_t dpi = DPI_BASE;				// 量化网格：DPI
+	int32_t quantum = 1;					// 量化网格：格子边长（设备像素），1 表示不分格
+
+	// @brief 清空指纹，保留量化网格
+	void clear() {
+		this->value = 0;
+		this->count = 0;
+	}
+
+	// @brief 加入一个图标，坐标为设备像素，先按 quantum 分格
+	void add(uint32_t nameHash, int32_t x, int32_t y) {
+		x = floorDivide(x, this->quantum);
+		y = floorDivide(y, this->quantum);
+		uint64_t hash = mixFingerprint(nameHash ^ (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32));
+		hash = mixFingerprint(hash ^ static_cast<uint32_t>(y));
+		this->value += hash;
+		++this->count;
+	}
+
+	// @brief 加入一个图标，坐标为 Q16 比率，先量化到网格
+	void addRatio(uint32_t nameHash, RatioQ16 x, RatioQ16 y) {
+		this->add(nameHash, q16ToDevicePixel(x, this->screenWidth, this->dpi), q16ToDevicePixel(y, this->screenHeight, this->dpi));
+	}
+
+	// @brief 两个指纹是否表示同一个布局（网格也必须相同）
+	bool matches(const LayoutFingerprint& other) const {
+		return this->value == other.value && this->count == other.count &&
+			this->screenWidth == other.screenWidth && this->screenHeight == other.screenHeight && this->dpi == other.dpi &&
+			this->quantum == other.quantum;
+	}
+
+private:
+	// @brief 向下取整的除法，桌面坐标可能为负（主屏左侧或上方的显示器）
+	static int32_t floorDivide(int32_t value, int32_t divisor) {
+		if (divisor <= 1) return value;
+		return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+	}
+};
@@ -0,0 +1,61 @@
+﻿/**
+ * @file common\fixedpoint.h
+ * @brief Q16 定点比率坐标与整数换算
+ */
+
+#pragma once
+#include <cstdint>
+#include <cmath>
+
+// @typedef RatioQ16
+// @brief Q16 定点比率，RATIO_Q16_ONE 表示 1.0（整个屏幕的宽/高）
+// @note 布局文件、IPC 数据、Agent 全程使用这一种表示，只在边界处与 double / 像素互转
+typedef int32_t RatioQ16;
+
+constexpr int32_t RATIO_Q16_SHIFT = 16;
+constexpr int32_t RATIO_Q16_ONE = 1 << RATIO_Q16_SHIFT;
+constexpr uint32_t DPI_BASE = 96;	// 100% 缩放时的 DPI
+
+// @brief 四舍五入的整数除法
+// @param denominator 分母，必须大于 0
+inline int64_t roundedDivide(int64_t numerator, int64_t denominator) {
+	return numerator >= 0
+		? (numerator + denominator / 2) / denominator
+		: -((-numerator + denominator / 2) / denominator);
+}
+
+// @brief double 比率 -> Q16（四舍五入）
+inline RatioQ16 ratioToQ16(double ratio) {
+	return static_cast<RatioQ16>(std::llround(ratio * RATIO_Q16_ONE));
+}
+
+// @brief Q16 -> double 比率
+// @note 只用于显示与兼容旧数据，不要参与坐标计算
+inline double q16ToRatio(RatioQ16 q) {
+	return static_cast<double>(q) / RATIO_Q16_ONE;
+}
+
+// @brief 像素 -> Q16 比率
+// @param pixel 像素坐标
+// @param screen 屏幕（宽/高）像素数
+inline RatioQ16 pixelToQ16(long pixel, int screen) {
+	if (screen <= 0) return 0;
+	return static_cast<RatioQ16>(roundedDivide(static_cast<int64_t>(pixel) << RATIO_Q16_SHIFT, screen));
+}
+
+// @brief Q16 比率 -> 设备像素，屏幕换算与 DPI 缩放一步完成
+// @param q 比率
+// @param screen 屏幕（宽/高）像素数
+// @param dpi 目标窗口 DPI，DPI_BASE 表示不缩放
+// @note screen < 65536 时，pixelToQ16 -> q16ToDevicePixel(DPI_BASE) 逐位还原
+inline int q16ToDevicePixel(RatioQ16 q, int screen, uint32_t dpi = DPI_BASE) {
+	return static_cast<int>(roundedDivide(
+		static_cast<int64_t>(q) * screen * dpi,
+		static_cast<int64_t>(RATIO_Q16_ONE) * DPI_BASE));
+}
+
+// @brief 逻辑像素 -> 设备像素
+// @param dpi 目标窗口 DPI
+inline int pixelToDevicePixel(long pixel, uint32_t dpi = DPI_BASE) {
+	return static_cast<int>(roundedDivide(static_cast<int64_t>(pixel) * dpi, DPI_BASE));
+}
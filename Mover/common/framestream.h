@@ -0,0 +1,90 @@
+﻿/**
+ * @file common\framestream.h
+ * @brief 帧流通道：三缓冲共享内存，生产者推送整帧坐标，Agent 总是应用最新的一帧
+ */
+
+#pragma once
+#include <Windows.h>
+#include <cstdint>
+#include "communication.h"
+
+constexpr auto FRAME_STREAM_MEM_NAME = L"Local\\DesktopIconMoverFrameStreamMem";				// 帧流共享内存名称
+constexpr auto FRAME_STREAM_READY_EVENT_NAME = L"Local\\DesktopIconMoverFrameStreamReadyEvent";		// 有新帧（自动重置）
+constexpr auto FRAME_STREAM_APPLIED_EVENT_NAME = L"Local\\DesktopIconMoverFrameStreamAppliedEvent";	// Agent 应用完一帧（自动重置）
+constexpr auto FRAME_STREAM_PRODUCER_MUTEX_NAME = L"Local\\DesktopIconMoverFrameStreamProducerMutex";	// 同一时间只允许一个生产者
+constexpr auto MAX_STREAM_ICON_COUNT = 4096;	// 一帧最多的图标数量
+constexpr LONG FRAME_STREAM_SLOTS = 3;			// 缓冲区数量
+constexpr LONG FRAME_STREAM_FRESH = 0x4;		// middle 中的标志：中间缓冲区是还没有被应用的新帧
+constexpr LONG FRAME_STREAM_SLOT_MASK = 0x3;	// middle 中的缓冲区序号
+
+// @struct StreamFrame
+// @brief 一帧：每个图标的目标坐标与名称散列（hashName）
+struct StreamFrame
+{
+	LONGLONG sequence;				// 帧序号，从 1 开始
+	LONGLONG submitMicroseconds;	// 提交时刻（streamClockMicroseconds）
+	int32_t count;					// positions 中的有效数量
+	int32_t byRate;					// 坐标是否为 Q16 比率（否则为像素）
+	IconPositionHash positions[MAX_STREAM_ICON_COUNT];
+};
+
+// @struct FrameStreamRegion
+// @brief 帧流共享内存
+// @note 三缓冲：生产者独占 back，Agent 独占 front，中间缓冲区通过 middle 原子交换，双方都不会等待对方
+// @note 生产者交换时发现中间缓冲区仍是新帧，说明那一帧还没被应用就被新帧替换（丢弃）
+struct FrameStreamRegion
+{
+	volatile LONG middle;							// 中间缓冲区序号 | FRAME_STREAM_FRESH
+	volatile LONG back;								// 生产者当前写入的缓冲区序号（新的生产者从这里接着写）
+	volatile LONGLONG submitted;					// 生产者提交的帧数
+	volatile LONGLONG replaced;						// 没有被应用就被替换的帧数
+	volatile LONGLONG applied;						// Agent 应用的帧数
+	volatile LONGLONG lastAppliedSequence;			// Agent 最近应用的帧序号
+	volatile LONGLONG lastLatencyMicroseconds;		// 最近一帧从提交到应用完成的延迟
+	volatile LONGLONG maxLatencyMicroseconds;		// 最大延迟
+	StreamFrame frames[FRAME_STREAM_SLOTS];
+};
+
+// @brief 帧流使用的时钟（微秒），两个进程读到的值可以直接比较
+inline LONGLONG streamClockMicroseconds() {
+	static const LONGLONG frequency = [] {
+		LARGE_INTEGER value;
+		QueryPerformanceFrequency(&value);
+		return value.QuadPart;
+	}();
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart / frequency * 1000000 + counter.QuadPart % frequency * 1000000 / frequency;
+}
+
+// @brief 初始化帧流（只由 Agent 调用）
+inline void initFrameStream(FrameStreamRegion* region, LONG& front) {
+	region->back = 0;
+	region->middle = 1;
+	front = 2;
+	region->submitted = region->replaced = region->applied = 0;
+	region->lastAppliedSequence = 0;
+	region->lastLatencyMicroseconds = region->maxLatencyMicroseconds = 0;
+}
+
+// @brief 生产者：发布 back 中写好的一帧，换回一个空闲缓冲区
+// @param back 生产者的缓冲区序号，会被更新
+// @ret 是否替换了一帧还没有被应用的帧
+inline bool publishStreamFrame(FrameStreamRegion* region, LONG& back) {
+	MemoryBarrier();
+	const LONG previous = InterlockedExchange(&region->middle, back | FRAME_STREAM_FRESH);
+	back = previous & FRAME_STREAM_SLOT_MASK;
+	region->back = back;
+	return (previous & FRAME_STREAM_FRESH) != 0;
+}
+
+// @brief 消费者（Agent）：取得最新的一帧
+// @param front Agent 的缓冲区序号，有新帧时被更新为新帧所在的缓冲区
+// @ret 是否有新帧
+inline bool acquireStreamFrame(FrameStreamRegion* region, LONG& front) {
+	if (!(region->middle & FRAME_STREAM_FRESH)) return false;
+	const LONG previous = InterlockedExchange(&region->middle, front);
+	front = previous & FRAME_STREAM_SLOT_MASK;
+	MemoryBarrier();
+	return true;
+}
@@ -0,0 +1,30 @@
+﻿/**
+ * @file common\hash.h
+ * @brief 图标名称散列（FNV-1a）
+ */
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+constexpr uint32_t FNV1A_32_OFFSET = 2166136261u;
+constexpr uint32_t FNV1A_32_PRIME = 16777619u;
+
+// @brief 32 位 FNV-1a 散列，按 UTF-16 代码单元逐个混入
+// @note Agent 与客户端必须使用同一个函数，散列值才可以互相比较
+inline uint32_t hashName(const wchar_t* name, size_t length) {
+	uint32_t hash = FNV1A_32_OFFSET;
+	for (size_t i = 0; i < length; ++i) {
+		const uint16_t unit = static_cast<uint16_t>(name[i]);
+		hash = (hash ^ (unit & 0xFF)) * FNV1A_32_PRIME;
+		hash = (hash ^ (unit >> 8)) * FNV1A_32_PRIME;
+	}
+	return hash;
+}
+
+// @brief 以 0 结尾的名称的散列
+inline uint32_t hashName(const wchar_t* name) {
+	size_t length = 0;
+	while (name[length]) ++length;
+	return hashName(name, length);
+}
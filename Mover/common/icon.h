@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include <string>
+#include "fixedpoint.h"
 using namespace std;
 
 // @struct IconPoint
@@ -48,7 +49,23 @@ struct IconPositionMove
 	}
 };
 
+// @struct RatioPoint
+// @brief ͼ꣨Q16 㣩
+struct RatioPoint
+{
+	RatioQ16 x;
+	RatioQ16 y;
+
+	RatioPoint() : x(0), y(0) {}
+
+	RatioPoint(RatioQ16 x, RatioQ16 y) : x(x), y(y) {}
+
+	// @brief  double ݣݼɰ沼ļ
+	RatioPoint(const pair<double, double>& ratio)
+		: x(ratioToQ16(ratio.first)), y(ratioToQ16(ratio.second)) {}
+};
+
 // @typedef RatioPointVector
 // @brief ͼλݣƣʣ
 // @note ͨݣ¼Ǳʶ
-typedef vector<pair<double, double>> RatioPointVector;
\ No newline at end of file
+typedef vector<RatioPoint> RatioPointVector;
\ No newline at end of file
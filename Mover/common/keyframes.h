@@ -0,0 +1,180 @@
+﻿/**
+ * @file common\keyframes.h
+ * @brief 关键帧动画文件：帧间差分 + zigzag varint 压缩
+ */
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include "icon.h"
+using namespace std;
+
+// 文件结构（小端）：
+//		KeyframeHeader
+//		帧 0 ... 帧 frameCount - 1，每帧依次为：
+//			varint			本帧持续时间（单位为 1 / timeBase 秒）
+//			iconCount 对	zigzag varint：x、y 相对上一帧的差（帧 0 相对 0），Q16 比率坐标
+// 静止的图标每帧只占 2 字节，小幅移动的图标通常不超过 4 ~ 6 字节
+
+constexpr uint32_t KEYFRAME_MAGIC = 0x4B4D4944;				// "DIMK"
+constexpr uint16_t KEYFRAME_VERSION = 1;					// 文件格式版本
+constexpr uint32_t KEYFRAME_DEFAULT_TIME_BASE = 1000;		// 默认时间基准：毫秒
+constexpr uint32_t KEYFRAME_MAX_ICON_COUNT = 65536;		// 单个文件最多的图标数量
+
+#pragma pack(push, 1)
+// @struct KeyframeHeader
+// @brief 文件头
+struct KeyframeHeader
+{
+	uint32_t magic;			// KEYFRAME_MAGIC
+	uint16_t version;		// KEYFRAME_VERSION
+	uint16_t headerSize;	// 文件头大小，新版本可以在末尾追加字段
+	uint32_t iconCount;		// 每帧的图标数量
+	uint32_t frameCount;	// 帧数
+	uint32_t timeBase;		// 每秒的时间单位数
+};
+#pragma pack(pop)
+
+// @brief zigzag 编码：把有符号数映射为小的无符号数（0、-1、1、-2 ... -> 0、1、2、3 ...）
+inline uint32_t zigzagEncode(int32_t value) {
+	return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+inline int32_t zigzagDecode(uint32_t value) {
+	return static_cast<int32_t>((value >> 1) ^ (0u - (value & 1)));
+}
+
+// @brief 追加 varint（每字节 7 位，最高位表示后面还有字节）
+inline void putVarint(vector<uint8_t>& out, uint32_t value) {
+	while (value >= 0x80) {
+		out.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+// @brief 读取 varint
+// @param cursor 读取位置，成功后前移
+// @ret 数据是否完整
+inline bool getVarint(const uint8_t*& cursor, const uint8_t* end, uint32_t& value) {
+	value = 0;
+	for (int shift = 0; shift < 35; shift += 7) {
+		if (cursor >= end) return false;
+		const uint8_t byte = *cursor++;
+		value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) return true;
+	}
+	return false; // 超过 5 字节
+}
+
+// @class KeyframeEncoder
+// @brief 逐帧编码关键帧文件
+class KeyframeEncoder
+{
+public:
+	// @param timeBase 每秒的时间单位数（add 中 duration 的单位）
+	explicit KeyframeEncoder(uint32_t iconCount, uint32_t timeBase = KEYFRAME_DEFAULT_TIME_BASE)
+		: previous(iconCount) {
+		KeyframeHeader header = { KEYFRAME_MAGIC, KEYFRAME_VERSION, sizeof(KeyframeHeader), iconCount, 0, timeBase };
+		this->bytes.resize(sizeof(KeyframeHeader));
+		memcpy(this->bytes.data(), &header, sizeof(header));
+	}
+
+	// @brief 追加一帧
+	// @param duration 本帧持续时间（单位为 1 / timeBase 秒）
+	// @ret 图标数量与文件头不一致时返回 false
+	bool add(const RatioPointVector& frame, uint32_t duration) {
+		if (frame.size() != this->previous.size()) return false;
+		putVarint(this->bytes, duration);
+		for (size_t i = 0; i < frame.size(); ++i) {
+			// 无符号减法：差值溢出时回绕，解码时同样回绕
+			putVarint(this->bytes, zigzagEncode(static_cast<int32_t>(static_cast<uint32_t>(frame[i].x) - static_cast<uint32_t>(this->previous[i].x))));
+			putVarint(this->bytes, zigzagEncode(static_cast<int32_t>(static_cast<uint32_t>(frame[i].y) - static_cast<uint32_t>(this->previous[i].y))));
+		}
+		this->previous = frame;
+		++this->frames;
+		return true;
+	}
+
+	// @brief 写入帧数，返回完整的文件内容
+	const vector<uint8_t>& finish() {
+		memcpy(this->bytes.data() + offsetof(KeyframeHeader, frameCount), &this->frames, sizeof(this->frames));
+		return this->bytes;
+	}
+
+	uint32_t frameCount() const {
+		return this->frames;
+	}
+
+private:
+	vector<uint8_t> bytes;		// 文件内容
+	RatioPointVector previous;	// 上一帧
+	uint32_t frames = 0;		// 已编码的帧数
+};
+
+// @class KeyframeDecoder
+// @brief 逐帧解码关键帧文件
+// @note 只引用数据，不复制（通常是内存映射的文件），长动画不会一次全部解码
+class KeyframeDecoder
+{
+public:
+	// @brief 绑定数据并检查文件头
+	// @ret 是否为有效的关键帧文件
+	bool open(const uint8_t* data, size_t size) {
+		this->begin = this->cursor = this->end = nullptr;
+		if (!data || size < sizeof(KeyframeHeader)) return false;
+		memcpy(&this->fileHeader, data, sizeof(KeyframeHeader));
+		if (this->fileHeader.magic != KEYFRAME_MAGIC || this->fileHeader.version > KEYFRAME_VERSION
+			|| this->fileHeader.headerSize < sizeof(KeyframeHeader) || this->fileHeader.headerSize > size
+			|| this->fileHeader.timeBase == 0 || this->fileHeader.iconCount > KEYFRAME_MAX_ICON_COUNT)
+			return false;
+		this->begin = data + this->fileHeader.headerSize;
+		this->end = data + size;
+		this->rewind();
+		return true;
+	}
+
+	const KeyframeHeader& header() const {
+		return this->fileHeader;
+	}
+
+	// @brief 回到第一帧
+	void rewind() {
+		this->cursor = this->begin;
+		this->decoded = 0;
+	}
+
+	// @brief 解码下一帧
+	// @param frame 上一帧的数据（第一帧前由解码器清零），就地累加差分得到本帧
+	// @param duration 输出：本帧持续时间（单位为 1 / timeBase 秒）
+	// @ret 是否还有完整的一帧；数据截断时返回 false
+	bool next(RatioPointVector& frame, uint32_t& duration) {
+		if (!this->cursor || this->decoded >= this->fileHeader.frameCount) return false;
+		if (this->decoded == 0) frame.assign(this->fileHeader.iconCount, RatioPoint());
+		if (frame.size() != this->fileHeader.iconCount) return false;
+
+		if (!getVarint(this->cursor, this->end, duration)) return false;
+		for (RatioPoint& point : frame) {
+			uint32_t dx, dy;
+			if (!getVarint(this->cursor, this->end, dx) || !getVarint(this->cursor, this->end, dy)) return false;
+			point.x = static_cast<RatioQ16>(static_cast<uint32_t>(point.x) + static_cast<uint32_t>(zigzagDecode(dx)));
+			point.y = static_cast<RatioQ16>(static_cast<uint32_t>(point.y) + static_cast<uint32_t>(zigzagDecode(dy)));
+		}
+		++this->decoded;
+		return true;
+	}
+
+	// @brief 已解码的帧数
+	uint32_t position() const {
+		return this->decoded;
+	}
+
+private:
+	KeyframeHeader fileHeader = {};
+	const uint8_t* begin = nullptr;		// 第一帧
+	const uint8_t* cursor = nullptr;	// 下一帧
+	const uint8_t* end = nullptr;		// 数据末尾
+	uint32_t decoded = 0;				// 已解码的帧数
+};
@@ -0,0 +1,115 @@
+﻿/**
+ * @file common\snapshot.h
+ * @brief 紧凑的图标快照：定长记录 + 共享字符池
+ */
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <vector>
+#include "icon.h"
+using namespace std;
+
+// @struct CompactIcon
+// @brief 紧凑图标记录：名称存放在快照的字符池中，记录本身只有 16 字节
+struct CompactIcon
+{
+	uint32_t nameOffset;	// 名称在字符池中的起始位置
+	uint32_t nameLength;	// 名称长度（不含结尾的 0）
+	IconPoint p;
+};
+
+// @class IconSnapshot
+// @brief 一次枚举得到的全部图标
+// @note IconPositionMove 每条固定 512 字节的名称，快照只按实际长度存放；
+//			只在 IPC 与旧接口的边界处与 IconPositionMove 互转
+class IconSnapshot
+{
+public:
+	// @brief 预留空间
+	// @param averageNameLength 预计的平均名称长度
+	void reserve(size_t icons, size_t averageNameLength = 16) {
+		this->records.reserve(icons);
+		this->arena.reserve(icons * (averageNameLength + 1));
+	}
+
+	void clear() {
+		this->records.clear();
+		this->arena.clear();
+	}
+
+	// @brief 追加一个图标
+	void add(const wchar_t* name, size_t length, const IconPoint& p) {
+		CompactIcon icon;
+		icon.nameOffset = static_cast<uint32_t>(this->arena.size());
+		icon.nameLength = static_cast<uint32_t>(length);
+		icon.p = p;
+		this->arena.insert(this->arena.end(), name, name + length);
+		this->arena.push_back(L'\0'); // 保留结尾的 0，name() 可直接当作 C 字符串使用
+		this->records.push_back(icon);
+	}
+
+	void add(const wchar_t* name, const IconPoint& p) {
+		this->add(name, wcslen(name), p);
+	}
+
+	// @brief 从 IconPositionMove 追加（边界转换）
+	void add(const IconPositionMove& icon) {
+		this->add(icon.targetName, wcsnlen(icon.targetName, _countof(icon.targetName)), icon.p);
+	}
+
+	size_t size() const {
+		return this->records.size();
+	}
+
+	bool empty() const {
+		return this->records.empty();
+	}
+
+	CompactIcon& operator[](size_t index) {
+		return this->records[index];
+	}
+
+	const CompactIcon& operator[](size_t index) const {
+		return this->records[index];
+	}
+
+	// @brief 图标名称（以 0 结尾）
+	const wchar_t* name(size_t index) const {
+		return this->arena.data() + this->records[index].nameOffset;
+	}
+
+	// @brief 全部记录，可直接排序（名称不随之移动）
+	vector<CompactIcon>& getRecords() {
+		return this->records;
+	}
+
+	const vector<CompactIcon>& getRecords() const {
+		return this->records;
+	}
+
+	// @brief 转换为 IconPositionMove（边界转换）
+	// @note 超过 255 个字符的名称会被截断
+	void toLegacy(size_t index, IconPositionMove& icon) const {
+		const CompactIcon& record = this->records[index];
+		const size_t length = min<size_t>(record.nameLength, _countof(icon.targetName) - 1);
+		memcpy(icon.targetName, this->name(index), length * sizeof(wchar_t));
+		icon.targetName[length] = L'\0';
+		icon.p = record.p;
+	}
+
+	// @brief 实际占用的内存（字节）
+	size_t memoryFootprint() const {
+		return this->records.capacity() * sizeof(CompactIcon) + this->arena.capacity() * sizeof(wchar_t);
+	}
+
+	// @brief 同样数量的图标用 IconPositionMove 存放时占用的内存（字节）
+	static size_t legacyFootprint(size_t icons) {
+		return icons * sizeof(IconPositionMove);
+	}
+
+private:
+	vector<CompactIcon> records;
+	vector<wchar_t> arena;	// 字符池：所有名称首尾相接，各自以 0 结尾
+};
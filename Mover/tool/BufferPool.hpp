@@ -0,0 +1,76 @@
+﻿/**
+ * @file tool\BufferPool.hpp
+ * @brief 可复用的大对象缓冲池
+ */
+
+#pragma once
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <atomic>
+using namespace std;
+
+// @class BufferPool
+// @brief 归还的对象留在池中供下次使用，避免反复分配与构造大对象
+// @note 取出的对象保持上次使用后的内容，由调用者负责重置需要的字段
+// @note 线程安全；池必须比它借出的对象活得久
+template <typename T>
+class BufferPool {
+public:
+	// @struct Releaser
+	// @brief Lease 析构时把对象还给池
+	struct Releaser {
+		BufferPool* pool;
+		void operator()(T* object) const { pool->release(object); }
+	};
+
+	// @typedef Lease
+	// @brief 借出的对象，离开作用域自动归还
+	typedef unique_ptr<T, Releaser> Lease;
+
+	// @param capacity 池中最多保留的空闲对象数量，多出的直接释放
+	explicit BufferPool(size_t capacity = 4) : capacity(capacity) {}
+
+	BufferPool(const BufferPool&) = delete;
+	BufferPool& operator=(const BufferPool&) = delete;
+
+	// @brief 借出一个对象，池为空时才分配
+	Lease acquire() {
+		{
+			lock_guard<mutex> guard(this->poolMutex);
+			if (!this->idle.empty()) {
+				T* object = this->idle.back().release();
+				this->idle.pop_back();
+				return Lease(object, Releaser{ this });
+			}
+		}
+		++this->allocationCount;
+		return Lease(new T(), Releaser{ this });
+	}
+
+	// @brief 累计分配次数（稳定运行时不应增长）
+	size_t allocations() const {
+		return this->allocationCount;
+	}
+
+	// @brief 当前空闲对象数量
+	size_t available() {
+		lock_guard<mutex> guard(this->poolMutex);
+		return this->idle.size();
+	}
+
+private:
+	void release(T* object) {
+		if (!object) return;
+		lock_guard<mutex> guard(this->poolMutex);
+		if (this->idle.size() < this->capacity)
+			this->idle.emplace_back(object);
+		else
+			delete object;
+	}
+
+	size_t capacity;
+	mutex poolMutex;
+	vector<unique_ptr<T>> idle;
+	atomic<size_t> allocationCount{ 0 };
+};
@@ -0,0 +1,162 @@
+﻿/**
+ * @file tool\EnvironmentProbe.hpp
+ * @brief 惰性求值的运行环境探测（权限、系统版本、Agent 状态）
+ */
+
+#pragma once
+#include <Windows.h>
+#include <string>
+#include <fstream>
+#include <functional>
+#include "LogMessage.hpp"
+using namespace std;
+
+// @class EnvironmentProbe
+// @brief 启动时的环境探测：每一项都在第一次用到时才求值，之后直接返回结果
+// @note Main 与 Application 共用同一个实例
+// @note 可选的磁盘缓存只保存系统版本（同一次开机内不会变），按开机 ID 失效；
+//			管理员权限取决于当前进程令牌，Agent 状态随时会变，都不写入缓存
+class EnvironmentProbe {
+public:
+	// @typedef AgentCheck
+	// @brief 检查 Agent 是否在线（一次 IPC 往返）
+	typedef function<bool()> AgentCheck;
+
+	EnvironmentProbe(LogMessage& logger, AgentCheck agentCheck) : logger(logger), agentCheck(agentCheck) {}
+
+	// @brief 启用磁盘缓存
+	// @param path 缓存文件路径，留空使用 %TEMP%\DesktopIconMover.probe
+	void EnableDiskCache(const wstring& path = L"") {
+		this->cachePath = path.empty() ? defaultCachePath() : path;
+	}
+
+	// @brief 是否以管理员权限运行
+	bool IsRunningAsAdmin() {
+		if (this->adminState < 0) {
+			BOOL isAdmin = FALSE;
+			HANDLE hToken = NULL;
+			if (OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY, &hToken)) {
+				TOKEN_ELEVATION elevation = { 0 };
+				DWORD dwSize = sizeof(TOKEN_ELEVATION);
+				if (GetTokenInformation(hToken, TokenElevation, &elevation, sizeof(elevation), &dwSize)) {
+					isAdmin = elevation.TokenIsElevated;
+				}
+				CloseHandle(hToken);
+			}
+			this->adminState = isAdmin ? 1 : 0;
+		}
+		return this->adminState == 1;
+	}
+
+	// @brief Windows 主版本号
+	DWORD GetWindowsMajorVersion() {
+		this->probeVersion();
+		return this->major;
+	}
+
+	// @brief Windows 版本号，如 10.0.19045
+	wstring GetWindowsVersionNumber() {
+		this->probeVersion();
+		return to_wstring(this->major) + L"." + to_wstring(this->minor) + L"." + to_wstring(this->build);
+	}
+
+	// @brief Agent 是否在线
+	// @note 第一次调用会进行一次 IPC 往返（Agent 不在线时最多等待 SURIVIVAL_TIMEOUT）
+	bool IsAgentOnline() {
+		if (this->agentState < 0)
+			this->agentState = this->agentCheck() ? 1 : 0;
+		return this->agentState == 1;
+	}
+
+	// @brief Agent 状态已知时（如刚注入成功）直接更新，避免再探测一次
+	void SetAgentOnline(bool online) {
+		this->agentState = online ? 1 : 0;
+	}
+
+	// @brief Agent 状态是否已经探测过
+	bool IsAgentStateKnown() const {
+		return this->agentState >= 0;
+	}
+
+private:
+	// @brief 读取系统版本：优先读缓存，否则调用 RtlGetNtVersionNumbers
+	void probeVersion() {
+		if (this->versionKnown) return;
+		this->versionKnown = true;
+
+		const wstring bootId = this->cachePath.empty() ? L"" : currentBootId();
+		if (!bootId.empty() && this->readCache(bootId)) {
+			logger.info(L"EnvironmentProbe: 使用缓存的系统版本 " + to_wstring(this->major) + L"." + to_wstring(this->minor));
+			return;
+		}
+
+		// ntdll 总是已经加载，不需要 LoadLibrary
+		typedef void(__stdcall* NTPROC)(DWORD*, DWORD*, DWORD*);
+		HMODULE hNtdll = GetModuleHandleW(L"ntdll.dll");
+		NTPROC GetNtVersionNumbers = hNtdll ? (NTPROC)GetProcAddress(hNtdll, "RtlGetNtVersionNumbers") : nullptr;
+		if (!GetNtVersionNumbers) throw runtime_error("无法获取 RtlGetNtVersionNumbers");
+		GetNtVersionNumbers(&this->major, &this->minor, &this->build);
+		this->build &= 0xFFFF; // 高位是编译类型标志
+
+		if (!bootId.empty()) this->writeCache(bootId);
+	}
+
+	bool readCache(const wstring& bootId) {
+		wifstream file(this->cachePath, ios::in);
+		if (!file.is_open()) return false;
+		file.imbue(locale::classic());
+
+		wstring cachedBootId;
+		DWORD cachedMajor = 0, cachedMinor = 0, cachedBuild = 0;
+		if (!(file >> cachedBootId >> cachedMajor >> cachedMinor >> cachedBuild) || cachedBootId != bootId)
+			return false;
+
+		this->major = cachedMajor;
+		this->minor = cachedMinor;
+		this->build = cachedBuild;
+		return true;
+	}
+
+	void writeCache(const wstring& bootId) {
+		wofstream file(this->cachePath, ios::out | ios::trunc);
+		if (!file.is_open()) {
+			logger.warning(L"EnvironmentProbe: 无法写入缓存 " + this->cachePath);
+			return;
+		}
+		file.imbue(locale::classic());
+		file << bootId << L"\n" << this->major << L" " << this->minor << L" " << this->build << L"\n";
+	}
+
+	// @brief 本次开机的标识
+	// @note 优先使用注册表中的 BootId，读不到时用开机时间（精确到分钟）代替
+	static wstring currentBootId() {
+		DWORD bootId = 0, size = sizeof(bootId);
+		if (RegGetValueW(HKEY_LOCAL_MACHINE,
+			L"SYSTEM\\CurrentControlSet\\Control\\Session Manager\\Memory Management\\PrefetchParameters",
+			L"BootId", RRF_RT_REG_DWORD, nullptr, &bootId, &size) == ERROR_SUCCESS)
+			return L"boot:" + to_wstring(bootId);
+
+		FILETIME now;
+		GetSystemTimeAsFileTime(&now);
+		const unsigned long long seconds = ((static_cast<unsigned long long>(now.dwHighDateTime) << 32) | now.dwLowDateTime) / 10000000ULL;
+		return L"uptime:" + to_wstring((seconds - GetTickCount64() / 1000) / 60);
+	}
+
+	static wstring defaultCachePath() {
+		wchar_t buffer[MAX_PATH];
+		DWORD length = GetTempPathW(MAX_PATH, buffer);
+		if (length == 0 || length >= MAX_PATH) return L"";
+		return wstring(buffer) + L"DesktopIconMover.probe";
+	}
+
+	LogMessage& logger;
+	AgentCheck agentCheck;
+	wstring cachePath;				// 为空表示不使用磁盘缓存
+
+	// -1 表示尚未探测
+	int adminState = -1;
+	int agentState = -1;
+
+	bool versionKnown = false;
+	DWORD major = 0, minor = 0, build = 0;
+};
@@ -0,0 +1,105 @@
+﻿/**
+ * @file tool\ExplorerLifecycle.hpp
+ * @brief 跟踪 explorer 进程的生命周期
+ */
+
+#pragma once
+#include <Windows.h>
+#include <atomic>
+#include <string>
+#include "LogMessage.hpp"
+using namespace std;
+
+// @class ExplorerLifecycle
+// @brief 持有 explorer 进程句柄，由线程池等待其退出，不需要轮询
+// @note 每次检测到退出，代数（generation）加一；调用者比较前后代数即可知道期间 explorer 是否重启过
+class ExplorerLifecycle {
+public:
+	ExplorerLifecycle(LogMessage& logger) : logger(logger) {}
+
+	~ExplorerLifecycle() {
+		this->Unwatch();
+	}
+
+	ExplorerLifecycle(const ExplorerLifecycle&) = delete;
+	ExplorerLifecycle& operator=(const ExplorerLifecycle&) = delete;
+
+	// @brief 开始跟踪指定进程，会替换之前跟踪的进程
+	// @ret 是否成功
+	bool Watch(DWORD pid) {
+		if (pid == this->pid && this->process && !this->exited) return true;
+		this->Unwatch();
+
+		this->process = OpenProcess(SYNCHRONIZE, FALSE, pid);
+		if (!this->process) {
+			logger.warning(L"ExplorerLifecycle: 无法打开 explorer 进程，错误代码：" + to_wstring(GetLastError()));
+			return false;
+		}
+
+		this->exited = false;
+		this->pid = pid;
+		if (!RegisterWaitForSingleObject(&this->wait, this->process, &ExplorerLifecycle::onExit, this, INFINITE, WT_EXECUTEONLYONCE)) {
+			logger.warning(L"ExplorerLifecycle: 注册等待失败，错误代码：" + to_wstring(GetLastError()));
+			this->Unwatch();
+			return false;
+		}
+
+		logger.info(L"ExplorerLifecycle: 开始跟踪 explorer 进程 " + to_wstring(pid));
+		return true;
+	}
+
+	// @brief 停止跟踪
+	void Unwatch() {
+		if (this->wait) {
+			UnregisterWaitEx(this->wait, INVALID_HANDLE_VALUE); // 等待正在执行的回调结束
+			this->wait = nullptr;
+		}
+		if (this->process) {
+			CloseHandle(this->process);
+			this->process = nullptr;
+		}
+		this->pid = 0;
+	}
+
+	// @brief 是否正在跟踪某个进程
+	bool IsWatching() const {
+		return this->process != nullptr;
+	}
+
+	// @brief 被跟踪的进程是否已经退出
+	bool HasExited() const {
+		return this->exited;
+	}
+
+	// @brief 当前代数
+	unsigned long GetGeneration() const {
+		return this->generation;
+	}
+
+	// @brief 进程句柄，可与其它句柄一起 WaitForMultipleObjects
+	// @ret 未跟踪时返回 nullptr
+	HANDLE GetProcessHandle() const {
+		return this->process;
+	}
+
+	DWORD GetPid() const {
+		return this->pid;
+	}
+
+private:
+	// @brief 线程池回调：进程退出
+	static VOID CALLBACK onExit(PVOID context, BOOLEAN timedOut) {
+		auto* self = static_cast<ExplorerLifecycle*>(context);
+		if (timedOut) return;
+		self->exited = true;
+		++self->generation;
+		self->logger.warning(L"ExplorerLifecycle: explorer 进程 " + to_wstring(self->pid) + L" 已退出");
+	}
+
+	LogMessage& logger;
+	HANDLE process = nullptr;
+	HANDLE wait = nullptr;
+	DWORD pid = 0;
+	atomic<bool> exited{ false };
+	atomic<unsigned long> generation{ 0 };
+};
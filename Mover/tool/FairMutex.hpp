@@ -0,0 +1,32 @@
+﻿/**
+ * @file tool\FairMutex.hpp
+ * @brief 先来先服务的互斥锁
+ */
+
+#pragma once
+#include <mutex>
+#include <condition_variable>
+
+// @class FairMutex
+// @brief 排号互斥锁：按 lock() 的先后顺序获得锁，不会有调用者一直抢不到
+// @note 满足 BasicLockable，可直接配合 lock_guard / unique_lock 使用
+class FairMutex {
+public:
+	void lock() {
+		std::unique_lock<std::mutex> guard(this->mutex);
+		const unsigned long long ticket = this->nextTicket++;
+		this->turn.wait(guard, [&] { return this->serving == ticket; });
+	}
+
+	void unlock() {
+		std::lock_guard<std::mutex> guard(this->mutex);
+		++this->serving;
+		this->turn.notify_all();
+	}
+
+private:
+	std::mutex mutex;
+	std::condition_variable turn;
+	unsigned long long nextTicket = 0;	// 下一个发出的号
+	unsigned long long serving = 0;		// 当前持有锁的号
+};
@@ -0,0 +1,156 @@
+﻿/**
+ * @file tool\FrameStream.hpp
+ * @brief 帧流生产者：向 Agent 推送整帧坐标
+ */
+
+#pragma once
+#include <Windows.h>
+#include <string>
+#include <algorithm>
+#include "../common/framestream.h"
+#include "LogMessage.hpp"
+using namespace std;
+
+// @class FrameStream
+// @brief 帧流生产者
+// @note 与主通道不同，推送一帧不需要互斥锁、不等待响应、不复制 133 KB 的 SharedData：
+//			写入自己的缓冲区 -> 原子交换 -> 通知 Agent
+// @note 背压：Agent 跟不上时旧帧被新帧替换（submit 返回 SUBMIT_REPLACED）；
+//			需要每帧都被应用的生产者可以在提交前调用 waitApplied()，按 Agent 的速度推送
+class FrameStream
+{
+public:
+	// @enum SubmitResult
+	// @brief submit 的结果
+	enum class SubmitResult : int {
+		SUBMIT_QUEUED = 0,		// 已提交，上一帧已经被应用
+		SUBMIT_REPLACED = 1,	// 已提交，但替换了一帧还没有被应用的帧（Agent 跟不上）
+		SUBMIT_FAILED = 2		// 帧流没有打开或数据无效
+	};
+
+	explicit FrameStream(LogMessage& logMessage) : logMessage(logMessage) {}
+
+	FrameStream(const FrameStream&) = delete;
+	FrameStream& operator=(const FrameStream&) = delete;
+
+	~FrameStream() {
+		this->close();
+	}
+
+	// @brief 打开 Agent 创建的帧流
+	// @ret 是否成功；Agent 未注入或已有其它生产者时返回 false
+	bool open() {
+		this->close();
+		this->producerMutex = CreateMutexW(nullptr, FALSE, FRAME_STREAM_PRODUCER_MUTEX_NAME);
+		const DWORD wait = this->producerMutex ? WaitForSingleObject(this->producerMutex, 0) : WAIT_FAILED;
+		if (wait != WAIT_OBJECT_0 && wait != WAIT_ABANDONED) {
+			logMessage.warning(L"FrameStream: 已有其它生产者正在推送");
+			this->close();
+			return false;
+		}
+		this->ownsMutex = true;
+
+		this->mapping = OpenFileMappingW(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, FRAME_STREAM_MEM_NAME);
+		if (this->mapping)
+			this->region = reinterpret_cast<FrameStreamRegion*>(MapViewOfFile(this->mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(FrameStreamRegion)));
+		this->readyEvent = OpenEventW(EVENT_MODIFY_STATE, FALSE, FRAME_STREAM_READY_EVENT_NAME);
+		this->appliedEvent = OpenEventW(SYNCHRONIZE, FALSE, FRAME_STREAM_APPLIED_EVENT_NAME);
+		if (!this->region || !this->readyEvent || !this->appliedEvent) {
+			logMessage.warning(L"FrameStream: 打开帧流失败，错误代码: " + to_wstring(GetLastError()));
+			this->close();
+			return false;
+		}
+
+		this->back = this->region->back & FRAME_STREAM_SLOT_MASK;
+		const LONGLONG lastApplied = this->region->lastAppliedSequence;
+		this->sequence = max(lastApplied, this->region->frames[this->back].sequence);
+		this->startSubmitted = this->region->submitted;
+		this->startReplaced = this->region->replaced;
+		this->startApplied = this->region->applied;
+		logMessage.info(L"FrameStream: 帧流已打开");
+		return true;
+	}
+
+	void close() {
+		if (this->region) UnmapViewOfFile(this->region);
+		if (this->mapping) CloseHandle(this->mapping);
+		if (this->readyEvent) CloseHandle(this->readyEvent);
+		if (this->appliedEvent) CloseHandle(this->appliedEvent);
+		if (this->ownsMutex) ReleaseMutex(this->producerMutex);
+		if (this->producerMutex) CloseHandle(this->producerMutex);
+		this->region = nullptr;
+		this->mapping = this->readyEvent = this->appliedEvent = this->producerMutex = nullptr;
+		this->ownsMutex = false;
+	}
+
+	bool isOpen() const {
+		return this->region != nullptr;
+	}
+
+	// @brief 推送一帧
+	// @param positions 图标坐标与名称散列，最多 MAX_STREAM_ICON_COUNT 个
+	// @param byRate 坐标是否为 Q16 比率
+	SubmitResult submit(const IconPositionHash* positions, size_t count, bool byRate) {
+		if (!this->region || count > MAX_STREAM_ICON_COUNT) return SubmitResult::SUBMIT_FAILED;
+
+		StreamFrame& frame = this->region->frames[this->back];
+		memcpy(frame.positions, positions, count * sizeof(IconPositionHash));
+		frame.count = static_cast<int32_t>(count);
+		frame.byRate = byRate ? 1 : 0;
+		frame.sequence = ++this->sequence;
+		frame.submitMicroseconds = streamClockMicroseconds();
+
+		const bool replaced = publishStreamFrame(this->region, this->back);
+		InterlockedIncrement64(&this->region->submitted);
+		if (replaced) InterlockedIncrement64(&this->region->replaced);
+		SetEvent(this->readyEvent);
+		return replaced ? SubmitResult::SUBMIT_REPLACED : SubmitResult::SUBMIT_QUEUED;
+	}
+
+	// @brief 背压：已提交但还没有被应用的帧数（0 或 1，更早的已被替换）
+	LONGLONG pending() const {
+		if (!this->region) return 0;
+		return this->sequence > this->region->lastAppliedSequence ? 1 : 0;
+	}
+
+	// @brief 等待 Agent 应用完最近提交的一帧
+	// @ret 是否在 timeout 内应用完
+	bool waitApplied(DWORD timeout) {
+		const ULONGLONG deadline = GetTickCount64() + timeout;
+		while (this->pending()) {
+			const ULONGLONG now = GetTickCount64();
+			if (now >= deadline || WaitForSingleObject(this->appliedEvent, static_cast<DWORD>(deadline - now)) == WAIT_FAILED)
+				return !this->pending();
+		}
+		return true;
+	}
+
+	// @brief 最近一帧从提交到应用完成的延迟（微秒）
+	LONGLONG lastLatencyMicroseconds() const {
+		return this->region ? this->region->lastLatencyMicroseconds : 0;
+	}
+
+	// @brief 统计摘要（自 open 以来），用于日志
+	wstring summary() const {
+		if (!this->region) return L"帧流未打开";
+		return L"提交 " + to_wstring(this->region->submitted - this->startSubmitted) +
+			L" 帧，应用 " + to_wstring(this->region->applied - this->startApplied) +
+			L" 帧，被替换 " + to_wstring(this->region->replaced - this->startReplaced) +
+			L" 帧，最近延迟 " + to_wstring(this->region->lastLatencyMicroseconds) +
+			L" us，最大延迟 " + to_wstring(this->region->maxLatencyMicroseconds) + L" us";
+	}
+
+private:
+	LogMessage& logMessage;
+	HANDLE producerMutex = nullptr;
+	bool ownsMutex = false;
+	HANDLE mapping = nullptr;
+	HANDLE readyEvent = nullptr;
+	HANDLE appliedEvent = nullptr;
+	FrameStreamRegion* region = nullptr;
+	LONG back = 0;					// 正在写入的缓冲区
+	LONGLONG sequence = 0;			// 最近提交的帧序号
+	LONGLONG startSubmitted = 0;	// open 时的计数，用于统计本次推送
+	LONGLONG startReplaced = 0;
+	LONGLONG startApplied = 0;
+};
@@ -0,0 +1,213 @@
+﻿/**
+ * @file tool\KeyframePlayer.hpp
+ * @brief 关键帧播放：后台线程提前解码，按时间基准发送变化的图标
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <algorithm>
+#include "../common/keyframes.h"
+#include "../common/snapshot.h"
+using namespace std;
+
+constexpr size_t KEYFRAME_LOOKAHEAD = 8;	// 提前解码的帧数
+
+// @class KeyframePlayer
+// @brief 关键帧播放器
+// @note 解码线程提前解码 KEYFRAME_LOOKAHEAD 帧并找出相对上一帧移动过的图标，发送线程只负责按时发送，
+//			解码与比较不在发送的关键路径上
+// @note 每帧按“到期时间 - 最近的发送耗时”提前发出，IPC 耗时不会推迟画面；
+//			落后时跳过已经过期的帧，被跳过的帧中的移动并入下一次发送，最终位置不会丢失
+// @note 图标名称为编号 0、1、2...（与 addFileOnDesktop 创建的占位文件对应），坐标为 Q16 比率
+class KeyframePlayer
+{
+public:
+	typedef chrono::steady_clock clock;
+
+	// @brief 发送一帧：changed 中是需要移动的图标，返回是否成功
+	typedef function<bool(const IconSnapshot& changed)> Sender;
+
+	// @param decoder 已打开的解码器，播放从第一帧开始
+	explicit KeyframePlayer(KeyframeDecoder& decoder, size_t lookahead = KEYFRAME_LOOKAHEAD)
+		: decoder(decoder), lookahead(max<size_t>(lookahead, 1)) {}
+
+	// @brief 播放全部帧
+	// @param stop 每帧之前调用，返回 true 时提前结束
+	// @ret 是否完整播放且每次发送都成功
+	bool play(const Sender& send, const function<bool()>& stop) {
+		const KeyframeHeader& header = this->decoder.header();
+		this->decoder.rewind();
+		this->finished = false;
+		this->cancelled = false;
+		this->corrupted = false;
+		this->queue.clear();
+		thread producer(&KeyframePlayer::decodeAhead, this);
+
+		RatioPointVector latest(header.iconCount);	// 每个图标最新的目标位置
+		vector<bool> pending(header.iconCount, false);
+		vector<uint32_t> pendingIndices;			// 还没有发出的图标
+		IconSnapshot changed;
+		bool result = true;
+		const clock::time_point start = clock::now();
+
+		PreparedFrame frame;
+		while (this->pop(frame)) {
+			if (stop()) {
+				result = false;
+				break;
+			}
+			for (const auto& move : frame.moves) {
+				latest[move.first] = move.second;
+				if (!pending[move.first]) {
+					pending[move.first] = true;
+					pendingIndices.push_back(move.first);
+				}
+			}
+
+			// 下一帧也已经到期：跳过本帧，移动并入下一次发送
+			const uint64_t now = microsecondsSince(start);
+			if (this->nextDue() <= now + this->sendLatency) {
+				++this->dropped;
+				continue;
+			}
+
+			// 提前一个发送耗时发出，使移动在到期时刻生效
+			if (frame.due > now + this->sendLatency)
+				this_thread::sleep_until(start + chrono::microseconds(frame.due - this->sendLatency));
+			else
+				this->maxLate = max(this->maxLate, now + this->sendLatency - frame.due);
+
+			changed.clear();
+			changed.reserve(pendingIndices.size(), 4);
+			for (uint32_t index : pendingIndices) {
+				const wstring name = to_wstring(index);
+				changed.add(name.c_str(), name.size(), { latest[index].x, latest[index].y });
+				pending[index] = false;
+			}
+			pendingIndices.clear();
+
+			const clock::time_point sendStart = clock::now();
+			if (!changed.empty() && !send(changed)) result = false;
+			const uint64_t latency = static_cast<uint64_t>(chrono::duration_cast<chrono::microseconds>(clock::now() - sendStart).count());
+			this->sendLatency = this->sent ? (this->sendLatency * 7 + latency) / 8 : latency; // 指数滑动平均
+			this->maxSendLatency = max(this->maxSendLatency, latency);
+			this->iconsSent += changed.size();
+			++this->sent;
+		}
+
+		{
+			lock_guard<mutex> guard(this->queueMutex);
+			this->cancelled = true;
+		}
+		this->queueChanged.notify_all();
+		producer.join();
+		this->elapsed = microsecondsSince(start);
+		return result && !this->corrupted && this->sent + this->dropped == header.frameCount;
+	}
+
+	// @brief 已发送的帧数
+	uint32_t framesSent() const {
+		return this->sent;
+	}
+
+	// @brief 因落后而跳过的帧数
+	uint32_t framesDropped() const {
+		return this->dropped;
+	}
+
+	// @brief 文件是否在中途截断或损坏
+	bool isCorrupted() const {
+		return this->corrupted;
+	}
+
+	// @brief 统计摘要，用于日志
+	wstring summary() const {
+		return L"发送 " + to_wstring(this->sent) + L" 帧，跳过 " + to_wstring(this->dropped) + L" 帧，共移动 " +
+			to_wstring(this->iconsSent) + L" 个图标，用时 " + to_wstring(this->elapsed / 1000) + L" ms，平均发送耗时 " +
+			to_wstring(this->sendLatency / 1000) + L" ms（最长 " + to_wstring(this->maxSendLatency / 1000) + L" ms），最多迟到 " +
+			to_wstring(this->maxLate / 1000) + L" ms";
+	}
+
+private:
+	// @struct PreparedFrame
+	// @brief 解码并比较后的一帧
+	struct PreparedFrame {
+		uint64_t due = 0;							// 到期时间（相对播放开始，微秒）
+		vector<pair<uint32_t, RatioPoint>> moves;	// 相对上一帧移动过的图标
+	};
+
+	static uint64_t microsecondsSince(clock::time_point start) {
+		return static_cast<uint64_t>(chrono::duration_cast<chrono::microseconds>(clock::now() - start).count());
+	}
+
+	// @brief 解码线程：解码、比较，放入有界队列
+	void decodeAhead() {
+		const KeyframeHeader& header = this->decoder.header();
+		RatioPointVector previous, current;
+		uint64_t due = 0;
+		uint32_t duration = 0;
+		while (this->decoder.next(current, duration)) {
+			PreparedFrame frame;
+			frame.due = due;
+			due += static_cast<uint64_t>(duration) * 1000000ULL / header.timeBase;
+			for (uint32_t i = 0; i < current.size(); ++i) {
+				if (previous.empty() || current[i].x != previous[i].x || current[i].y != previous[i].y)
+					frame.moves.push_back(make_pair(i, current[i]));
+			}
+			previous = current;
+
+			unique_lock<mutex> lock(this->queueMutex);
+			this->queueChanged.wait(lock, [this] { return this->cancelled || this->queue.size() < this->lookahead; });
+			if (this->cancelled) return;
+			this->queue.push_back(std::move(frame));
+			this->queueChanged.notify_all();
+		}
+
+		lock_guard<mutex> guard(this->queueMutex);
+		this->corrupted = this->decoder.position() < header.frameCount;
+		this->finished = true;
+		this->queueChanged.notify_all();
+	}
+
+	// @brief 取出下一帧，没有更多帧时返回 false
+	bool pop(PreparedFrame& frame) {
+		unique_lock<mutex> lock(this->queueMutex);
+		this->queueChanged.wait(lock, [this] { return this->finished || !this->queue.empty(); });
+		if (this->queue.empty()) return false;
+		frame = std::move(this->queue.front());
+		this->queue.pop_front();
+		this->queueChanged.notify_all();
+		return true;
+	}
+
+	// @brief 队列中下一帧的到期时间；还没有解码出来时视为无限远
+	uint64_t nextDue() {
+		lock_guard<mutex> guard(this->queueMutex);
+		return this->queue.empty() ? UINT64_MAX / 2 : this->queue.front().due;
+	}
+
+	KeyframeDecoder& decoder;
+	size_t lookahead;				// 队列容量
+
+	mutex queueMutex;
+	condition_variable queueChanged;
+	deque<PreparedFrame> queue;		// 已解码、等待发送的帧
+	bool finished = false;			// 解码线程已结束
+	bool cancelled = false;			// 播放已结束，解码线程应退出
+	bool corrupted = false;			// 数据在中途截断
+
+	uint32_t sent = 0;				// 已发送的帧数
+	uint32_t dropped = 0;			// 跳过的帧数
+	size_t iconsSent = 0;			// 累计移动的图标数
+	uint64_t sendLatency = 0;		// 发送耗时的滑动平均（微秒）
+	uint64_t maxSendLatency = 0;	// 最长发送耗时（微秒）
+	uint64_t maxLate = 0;			// 最多迟到（微秒）
+	uint64_t elapsed = 0;			// 播放用时（微秒）
+};
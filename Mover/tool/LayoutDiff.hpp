@@ -0,0 +1,99 @@
+﻿/**
+ * @file tool\LayoutDiff.hpp
+ * @brief 当前桌面与目标布局的差异
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdlib>
+#include "../common/icon.h"
+#include "../common/hash.h"
+#include "../common/fixedpoint.h"
+#include "../common/fingerprint.h"
+#include "../common/snapshot.h"
+#include "../common/communication.h"
+using namespace std;
+
+// @class LayoutDiff
+// @brief 按占位文件名（0、1、2...）把当前图标位置与目标布局逐个比较
+// @note 目标坐标先按 Agent 的网格（屏幕尺寸与 DPI）换算成设备像素，与 Agent 实际摆放的位置相同，
+//			再与读到的设备像素比较；偏差不超过 tolerance（按 DPI 缩放）的图标视为已就位，不会进入移动列表
+class LayoutDiff
+{
+public:
+	// @struct Result
+	// @brief 一次比较的结果
+	struct Result {
+		IconSnapshot moves;		// 需要移动的图标（名称为编号，坐标为 Q16 比率）
+		size_t inPlace = 0;		// 已就位、跳过的图标数
+		size_t missing = 0;		// 桌面上找不到的占位图标数
+	};
+
+	// @param target 目标布局
+	// @param tolerance 允许的偏差（逻辑像素）
+	// @param grid Agent 的量化网格（见 Mover::GetLayoutFingerprint），只使用屏幕尺寸与 DPI
+	LayoutDiff(const RatioPointVector& target, int tolerance, const LayoutFingerprint& grid)
+		: target(target), placeholders(placeholderHashes(target.size())),
+		tolerance(pixelToDevicePixel(tolerance, grid.dpi)) {
+		this->devicePoints.reserve(target.size());
+		for (const RatioPoint& point : target)
+			this->devicePoints.push_back({
+				q16ToDevicePixel(point.x, grid.screenWidth, grid.dpi),
+				q16ToDevicePixel(point.y, grid.screenHeight, grid.dpi) });
+	}
+
+	// @brief 比较当前位置与目标布局
+	// @param icons 当前图标位置（名称散列与坐标）
+	// @param result [OUT] 比较结果，会先被清空
+	void compare(const vector<IconPositionHash>& icons, Result& result) const {
+		result.moves.clear();
+		result.inPlace = 0;
+		result.missing = 0;
+
+		vector<bool> seen(this->target.size(), false);
+		for (const IconPositionHash& icon : icons) {
+			auto found = this->placeholders.find(icon.nameHash);
+			if (found == this->placeholders.end()) continue;
+			const size_t index = found->second;
+			if (seen[index]) continue; // 同名图标只比较第一个
+			seen[index] = true;
+
+			const DevicePoint& expected = this->devicePoints[index];
+			if (abs(icon.x - expected.x) > this->tolerance || abs(icon.y - expected.y) > this->tolerance)
+				result.moves.add(to_wstring(index).c_str(), { this->target[index].x, this->target[index].y });
+			else
+				++result.inPlace;
+		}
+		for (bool found : seen)
+			if (!found) ++result.missing;
+	}
+
+	size_t size() const {
+		return this->target.size();
+	}
+
+private:
+	// @brief 占位文件名（0、1、2...）的散列 -> 编号
+	// @note 散列相同的编号只保留第一个
+	static unordered_map<uint32_t, size_t> placeholderHashes(size_t size) {
+		unordered_map<uint32_t, size_t> hashes;
+		hashes.reserve(size);
+		for (size_t i = 0; i < size; ++i) {
+			const wstring name = to_wstring(i);
+			hashes.emplace(hashName(name.c_str(), name.size()), i);
+		}
+		return hashes;
+	}
+
+	struct DevicePoint {
+		int32_t x;
+		int32_t y;
+	};
+
+	const RatioPointVector& target;
+	const unordered_map<uint32_t, size_t> placeholders;
+	vector<DevicePoint> devicePoints;	// 目标位置（设备像素），与 Agent 摆放的位置相同
+	const int tolerance;				// 允许的偏差（设备像素）
+};
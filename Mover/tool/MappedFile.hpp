@@ -0,0 +1,74 @@
+﻿/**
+ * @file tool\MappedFile.hpp
+ * @brief 只读内存映射文件
+ */
+
+#pragma once
+#include <Windows.h>
+#include <cstdint>
+
+// @class MappedFile
+// @brief 把整个文件只读映射到内存，按需由系统分页读入
+// @note 适合顺序读取的大文件：不需要一次读入，也不占用堆内存
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile() {
+		this->close();
+	}
+
+	// @brief 映射文件
+	// @ret 是否成功；空文件视为失败
+	bool open(const wchar_t* path) {
+		this->close();
+		this->file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (this->file == INVALID_HANDLE_VALUE) {
+			this->file = nullptr;
+			return false;
+		}
+
+		LARGE_INTEGER size = {};
+		if (!GetFileSizeEx(this->file, &size) || size.QuadPart <= 0 || static_cast<unsigned long long>(size.QuadPart) > SIZE_MAX) {
+			this->close();
+			return false;
+		}
+
+		this->mapping = CreateFileMappingW(this->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (this->mapping)
+			this->view = static_cast<const uint8_t*>(MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0));
+		if (!this->view) {
+			this->close();
+			return false;
+		}
+		this->length = static_cast<size_t>(size.QuadPart);
+		return true;
+	}
+
+	void close() {
+		if (this->view) UnmapViewOfFile(this->view);
+		if (this->mapping) CloseHandle(this->mapping);
+		if (this->file) CloseHandle(this->file);
+		this->view = nullptr;
+		this->mapping = nullptr;
+		this->file = nullptr;
+		this->length = 0;
+	}
+
+	const uint8_t* data() const {
+		return this->view;
+	}
+
+	size_t size() const {
+		return this->length;
+	}
+
+private:
+	HANDLE file = nullptr;
+	HANDLE mapping = nullptr;
+	const uint8_t* view = nullptr;
+	size_t length = 0;
+};
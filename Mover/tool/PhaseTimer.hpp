@@ -0,0 +1,59 @@
+﻿/**
+ * @file tool\PhaseTimer.hpp
+ * @brief 分阶段计时
+ */
+
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+using namespace std;
+
+// @class PhaseTimer
+// @brief 记录相邻两次 mark() 之间的耗时
+// @note 用法：构造即开始计时，每个阶段结束时调用 mark(阶段名)，最后 report()
+class PhaseTimer {
+public:
+	struct Phase {
+		wstring name;
+		double milliseconds;
+	};
+
+	PhaseTimer() : start(clock::now()), last(start) {}
+
+	// @brief 结束当前阶段
+	void mark(const wstring& name) {
+		const auto now = clock::now();
+		this->phases.push_back({ name, chrono::duration<double, milli>(now - this->last).count() });
+		this->last = now;
+	}
+
+	// @brief 自构造以来的总耗时（毫秒）
+	double total() const {
+		return chrono::duration<double, milli>(clock::now() - this->start).count();
+	}
+
+	const vector<Phase>& getPhases() const {
+		return this->phases;
+	}
+
+	// @brief 格式化为一行，如 “初始化 1.20 ms | 环境检测 0.35 ms | 总计 1.55 ms”
+	wstring report() const {
+		wostringstream out;
+		out.imbue(locale::classic());
+		out << fixed << setprecision(2);
+		for (const auto& phase : this->phases)
+			out << phase.name << L" " << phase.milliseconds << L" ms | ";
+		out << L"总计 " << this->total() << L" ms";
+		return out.str();
+	}
+
+private:
+	typedef chrono::steady_clock clock;
+
+	clock::time_point start;
+	clock::time_point last;
+	vector<Phase> phases;
+};
@@ -0,0 +1,274 @@
+﻿/**
+ * @file tool\PipeServer.hpp
+ * @brief 本地命名管道服务端 / 客户端（带长度帧）
+ */
+
+#pragma once
+#include <Windows.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <list>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include "LogMessage.hpp"
+using namespace std;
+
+constexpr auto PIPE_NAME = L"\\\\.\\pipe\\DesktopIconMover";	// 服务管道名称
+constexpr DWORD PIPE_BUFFER_SIZE = 64 * 1024;					// 管道缓冲区大小
+constexpr DWORD PIPE_MAX_FRAME = 16 * 1024 * 1024;				// 单帧最大字节数
+constexpr DWORD PIPE_CONNECT_TIMEOUT = 5000;					// 客户端连接超时时间
+
+// @note 帧格式
+//			请求：[uint32 字节数][UTF-16 命令行]
+//			响应：[uint32 字节数][int32 退出码][UTF-16 输出文本]
+
+// @brief 同步读写一次
+// @note 服务端的管道以 FILE_FLAG_OVERLAPPED 创建，读写必须带 OVERLAPPED；客户端的普通句柄带上也会同步完成
+inline bool TransferPipe(HANDLE pipe, bool write, void* buffer, DWORD size, DWORD& transferred) {
+	OVERLAPPED overlapped = {};
+	overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	if (!overlapped.hEvent) return false;
+	BOOL done = write
+		? WriteFile(pipe, buffer, size, &transferred, &overlapped)
+		: ReadFile(pipe, buffer, size, &transferred, &overlapped);
+	if (!done && GetLastError() == ERROR_IO_PENDING)
+		done = GetOverlappedResult(pipe, &overlapped, &transferred, TRUE);
+	CloseHandle(overlapped.hEvent);
+	return done != FALSE;
+}
+
+// @brief 读取一帧
+inline bool ReadPipeFrame(HANDLE pipe, vector<char>& frame) {
+	// 读满 size 个字节
+	auto readAll = [pipe](void* buffer, DWORD size) {
+		char* p = static_cast<char*>(buffer);
+		while (size) {
+			DWORD read = 0;
+			if (!TransferPipe(pipe, false, p, size, read) || read == 0) return false;
+			p += read;
+			size -= read;
+		}
+		return true;
+	};
+
+	uint32_t length = 0;
+	if (!readAll(&length, sizeof(length)) || length > PIPE_MAX_FRAME) return false;
+	frame.resize(length);
+	return length == 0 || readAll(frame.data(), length);
+}
+
+// @brief 写出一帧
+inline bool WritePipeFrame(HANDLE pipe, const vector<char>& frame) {
+	uint32_t length = static_cast<uint32_t>(frame.size());
+	vector<char> buffer(sizeof(length) + frame.size());
+	memcpy(buffer.data(), &length, sizeof(length));
+	if (!frame.empty()) memcpy(buffer.data() + sizeof(length), frame.data(), frame.size());
+
+	DWORD written = 0;
+	return TransferPipe(pipe, true, buffer.data(), static_cast<DWORD>(buffer.size()), written)
+		&& written == buffer.size();
+}
+
+// @class PipeServer
+// @brief 命名管道服务端：每个客户端一个线程，收到请求帧后调用处理函数并回复
+// @note 处理函数可能被多个线程同时调用，串行化由调用者负责
+class PipeServer {
+public:
+	// @typedef Handler
+	// @brief 请求处理函数：参数为请求文本与输出文本，返回退出码
+	typedef function<int(const wstring& request, wstring& response)> Handler;
+
+	PipeServer(LogMessage& logger, const wstring& name = PIPE_NAME)
+		: logger(logger), name(name), stopEvent(CreateEventW(nullptr, TRUE, FALSE, nullptr)) {}
+
+	~PipeServer() {
+		this->stop();
+		this->joinClients();
+		if (this->stopEvent) CloseHandle(this->stopEvent);
+	}
+
+	// @brief 开始服务，阻塞到 stop() 被调用
+	// @ret 是否正常结束
+	bool serve(const Handler& handler) {
+		HANDLE connectEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		if (!this->stopEvent || !connectEvent) {
+			logger.error(L"PipeServer: 创建事件失败，错误代码：" + to_wstring(GetLastError()));
+			if (connectEvent) CloseHandle(connectEvent);
+			return false;
+		}
+		this->stopping = false;
+		this->stopPending = false;
+		ResetEvent(this->stopEvent);
+		while (!this->stopping) {
+			HANDLE pipe = CreateNamedPipeW(this->name.c_str(),
+				PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED,
+				PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+				PIPE_UNLIMITED_INSTANCES,
+				PIPE_BUFFER_SIZE, PIPE_BUFFER_SIZE, 0, nullptr);
+			if (pipe == INVALID_HANDLE_VALUE) {
+				logger.error(L"PipeServer: 创建命名管道失败，错误代码：" + to_wstring(GetLastError()));
+				CloseHandle(connectEvent);
+				return false;
+			}
+
+			// 等待客户端连接或 stop()
+			if (!this->waitForClient(pipe, connectEvent) || this->stopping) {
+				CloseHandle(pipe);
+				continue;
+			}
+
+			// 先回收已经结束的客户端线程，常驻服务的线程数只取决于同时连接的客户端数
+			this->reapClients(false);
+			lock_guard<mutex> guard(this->clientsMutex);
+			this->clientPipes.insert(pipe);
+			this->clients.emplace_back();
+			Client& client = this->clients.back();
+			client.worker = thread(&PipeServer::serveClient, this, pipe, handler, &client.finished);
+		}
+
+		CloseHandle(connectEvent);
+		this->joinClients();
+		return true;
+	}
+
+	// @brief 回复完当前请求后停止服务（供处理函数调用）
+	void stopAfterReply() {
+		this->stopPending = true;
+	}
+
+	// @brief 停止服务，断开所有客户端
+	void stop() {
+		if (this->stopping.exchange(true)) return;
+		if (this->stopEvent) SetEvent(this->stopEvent); // 唤醒等待连接的循环
+
+		lock_guard<mutex> guard(this->clientsMutex);
+		for (HANDLE pipe : this->clientPipes)
+			DisconnectNamedPipe(pipe);
+	}
+
+private:
+	// @struct Client
+	// @brief 客户端线程；finished 在线程退出前置位，之后可以直接 join
+	struct Client {
+		thread worker;
+		atomic<bool> finished{ false };
+	};
+
+	// @brief 重叠方式等待一个客户端连接，stop() 时立即返回
+	// @ret 是否已连接
+	bool waitForClient(HANDLE pipe, HANDLE connectEvent) {
+		OVERLAPPED overlapped = {};
+		overlapped.hEvent = connectEvent;
+		ResetEvent(connectEvent);
+		if (ConnectNamedPipe(pipe, &overlapped)) return true;
+
+		switch (GetLastError()) {
+		case ERROR_PIPE_CONNECTED:
+			return true;
+		case ERROR_IO_PENDING:
+			break;
+		default:
+			return false;
+		}
+
+		const HANDLE waits[] = { connectEvent, this->stopEvent };
+		DWORD transferred = 0;
+		if (WaitForMultipleObjects(2, waits, FALSE, INFINITE) == WAIT_OBJECT_0)
+			return GetOverlappedResult(pipe, &overlapped, &transferred, FALSE) != FALSE;
+
+		// 停止：取消等待，并等取消完成后才能释放 overlapped
+		CancelIo(pipe);
+		GetOverlappedResult(pipe, &overlapped, &transferred, TRUE);
+		return false;
+	}
+
+	// @brief 处理单个客户端的全部请求
+	// @param finished 全部处理完后置位
+	void serveClient(HANDLE pipe, Handler handler, atomic<bool>* finished) {
+		vector<char> frame;
+		while (!this->stopping && ReadPipeFrame(pipe, frame)) {
+			wstring request(reinterpret_cast<const wchar_t*>(frame.data()), frame.size() / sizeof(wchar_t));
+			wstring response;
+			int32_t status = EXIT_FAILURE;
+			try {
+				status = handler(request, response);
+			}
+			catch (const exception& e) {
+				response = L"服务端异常: " + wstring(e.what(), e.what() + strlen(e.what()));
+			}
+
+			vector<char> reply(sizeof(status) + response.size() * sizeof(wchar_t));
+			memcpy(reply.data(), &status, sizeof(status));
+			if (!response.empty())
+				memcpy(reply.data() + sizeof(status), response.data(), response.size() * sizeof(wchar_t));
+			if (!WritePipeFrame(pipe, reply)) break;
+			if (this->stopPending) {
+				FlushFileBuffers(pipe);
+				this->stop();
+			}
+		}
+
+		FlushFileBuffers(pipe);
+		DisconnectNamedPipe(pipe);
+		{
+			lock_guard<mutex> guard(this->clientsMutex);
+			this->clientPipes.erase(pipe);
+		}
+		CloseHandle(pipe);
+		*finished = true;
+	}
+
+	// @brief 等待全部客户端线程结束
+	void joinClients() {
+		this->reapClients(true);
+	}
+
+	// @brief 回收客户端线程
+	// @param all true：等待全部线程结束；false：只回收已经结束的线程
+	void reapClients(bool all) {
+		list<Client> finished;
+		{
+			lock_guard<mutex> guard(this->clientsMutex);
+			for (auto it = this->clients.begin(); it != this->clients.end();) {
+				if (all || it->finished) finished.splice(finished.end(), this->clients, it++);
+				else ++it;
+			}
+		}
+		for (auto& client : finished)
+			if (client.worker.joinable()) client.worker.join();
+	}
+
+	LogMessage& logger;
+	wstring name;
+	HANDLE stopEvent;	// stop() 时置位（手动重置），唤醒等待连接的循环
+	atomic<bool> stopping{ false };
+	atomic<bool> stopPending{ false };
+	mutex clientsMutex;
+	set<HANDLE> clientPipes;
+	list<Client> clients;	// list：线程持有 finished 的地址，元素不能移动
+};
+
+// @brief 作为客户端发送一条请求并等待响应
+// @param request 请求文本（命令行参数）
+// @param response 服务端输出
+// @ret 服务端返回的退出码；无法连接或通信失败时返回 -1
+inline int SendPipeRequest(const wstring& request, wstring& response, const wstring& name = PIPE_NAME) {
+	if (!WaitNamedPipeW(name.c_str(), PIPE_CONNECT_TIMEOUT)) return -1;
+	HANDLE pipe = CreateFileW(name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+	if (pipe == INVALID_HANDLE_VALUE) return -1;
+
+	vector<char> frame(request.size() * sizeof(wchar_t));
+	if (!request.empty()) memcpy(frame.data(), request.data(), frame.size());
+
+	int32_t status = -1;
+	if (WritePipeFrame(pipe, frame) && ReadPipeFrame(pipe, frame) && frame.size() >= sizeof(status)) {
+		memcpy(&status, frame.data(), sizeof(status));
+		response.assign(reinterpret_cast<const wchar_t*>(frame.data() + sizeof(status)),
+			(frame.size() - sizeof(status)) / sizeof(wchar_t));
+	}
+	CloseHandle(pipe);
+	return status;
+}
@@ -0,0 +1,183 @@
+﻿/**
+ * @file tool\PointGrid.hpp
+ * @brief 空间散列：无名布局的最近邻匹配
+ */
+
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "../common/icon.h"
+using namespace std;
+
+// @class PointGrid
+// @brief 均匀网格空间散列，按格子存放点的下标
+// @note 格子边长按点的密度选取（平均每格约两个点），格子以 CSR 形式连续存放，构建只需两次线性扫描
+// @note take() 由近到远逐圈查找，已取出的点移出所在格子，不会再被返回，用于一对一匹配
+// @note 查找范围是以 X、Y 两个半轴描述的椭圆：Q16 比率按屏幕宽、高分别换算，同样的像素距离在两个方向上的比率不同
+class PointGrid
+{
+public:
+	explicit PointGrid(const RatioPointVector& points)
+		: points(points), taken(points.size(), false) {
+		if (points.empty()) return;
+
+		int64_t maxX = points[0].x, maxY = points[0].y;
+		this->minX = points[0].x;
+		this->minY = points[0].y;
+		for (const RatioPoint& p : points) {
+			this->minX = min<int64_t>(this->minX, p.x);
+			this->minY = min<int64_t>(this->minY, p.y);
+			maxX = max<int64_t>(maxX, p.x);
+			maxY = max<int64_t>(maxY, p.y);
+		}
+		const int64_t width = maxX - this->minX + 1, height = maxY - this->minY + 1;
+		const double area = static_cast<double>(width) * static_cast<double>(height);
+		this->cell = max<int64_t>(1, static_cast<int64_t>(sqrt(area * 2 / points.size())));
+		// 点集很扁时按面积算出的格子过小，限制行列数不超过点数，格子总数保持 O(n)
+		this->cell = max<int64_t>(this->cell, max(width, height) / static_cast<int64_t>(points.size()) + 1);
+		this->columns = width / this->cell + 1;
+		this->rows = height / this->cell + 1;
+
+		// 计数 -> 前缀和 -> 填充
+		this->starts.assign(static_cast<size_t>(this->columns * this->rows) + 1, 0);
+		for (const RatioPoint& p : points)
+			++this->starts[this->cellOf(p) + 1];
+		for (size_t i = 1; i < this->starts.size(); ++i)
+			this->starts[i] += this->starts[i - 1];
+		this->ends.assign(this->starts.begin(), this->starts.end() - 1);
+		this->order.resize(points.size());
+		this->positions.resize(points.size());
+		for (size_t i = 0; i < points.size(); ++i) {
+			const uint32_t position = this->ends[this->cellOf(points[i])]++;
+			this->order[position] = static_cast<uint32_t>(i);
+			this->positions[i] = position;
+		}
+	}
+
+	// @brief 取出在 p 的 radius 范围内最近的点
+	// @param radius X、Y 方向的半轴（Q16），为 0 的方向坐标必须相同
+	// @ret 点的下标；没有时返回 SIZE_MAX
+	// @note 远近按归一化距离 (dx / radius.x)² + (dy / radius.y)² 比较，距离相同时取下标较小的点
+	size_t take(const RatioPoint& p, const RatioPoint& radius) {
+		if (this->points.empty() || radius.x < 0 || radius.y < 0) return SIZE_MAX;
+
+		const int64_t column = floorDivide(p.x - this->minX, this->cell);
+		const int64_t row = floorDivide(p.y - this->minY, this->cell);
+		const int64_t longest = max(radius.x, radius.y);
+		const int64_t maxRing = longest / this->cell + 1;
+		size_t best = SIZE_MAX;
+		double bestDistance = 1.0;
+
+		for (int64_t ring = 0; ring <= maxRing; ++ring) {
+			// 第 ring 圈的格子在某个方向上与 p 至少相距 (ring - 1) * cell
+			if (ring > 0) {
+				if (bestDistance == 0 && best != SIZE_MAX) break;
+				const double gap = static_cast<double>((ring - 1) * this->cell) / max<int64_t>(longest, 1);
+				if (gap * gap > bestDistance) break;
+			}
+			for (int64_t y = row - ring; y <= row + ring; ++y) {
+				if (y < 0 || y >= this->rows) continue;
+				const bool edge = (y == row - ring || y == row + ring);
+				const int64_t step = edge ? 1 : max<int64_t>(1, 2 * ring);
+				for (int64_t x = column - ring; x <= column + ring; x += step) {
+					if (x < 0 || x >= this->columns) continue;
+					const size_t c = static_cast<size_t>(y * this->columns + x);
+					for (uint32_t k = this->starts[c]; k < this->ends[c]; ++k) {
+						const uint32_t index = this->order[k];
+						const int64_t dx = static_cast<int64_t>(this->points[index].x) - p.x;
+						const int64_t dy = static_cast<int64_t>(this->points[index].y) - p.y;
+						const double distance = normalizedDistance(dx, dy, radius);
+						if (distance < bestDistance || (distance == bestDistance && index < best)) {
+							best = index;
+							bestDistance = distance;
+						}
+					}
+				}
+			}
+		}
+
+		if (best != SIZE_MAX) this->remove(best);
+		return best;
+	}
+
+	// @brief 按所在格子排列查询点的下标
+	// @note 依次查询相邻的点时访问的格子也相邻，大批量查询时比按原顺序快数倍
+	void orderByCell(const RatioPointVector& queries, vector<size_t>& result) const {
+		result.resize(queries.size());
+		if (this->points.empty()) {
+			for (size_t j = 0; j < queries.size(); ++j) result[j] = j;
+			return;
+		}
+		vector<uint32_t> offsets(this->starts.size(), 0);
+		for (const RatioPoint& q : queries)
+			++offsets[this->clampedCellOf(q) + 1];
+		for (size_t i = 1; i < offsets.size(); ++i)
+			offsets[i] += offsets[i - 1];
+		for (size_t j = 0; j < queries.size(); ++j)
+			result[offsets[this->clampedCellOf(queries[j])]++] = j;
+	}
+
+	// @brief 该点是否已被取出
+	bool isTaken(size_t index) const {
+		return this->taken[index];
+	}
+
+private:
+	// @brief 把点与所在格子的最后一个点交换，再缩短格子
+	void remove(size_t index) {
+		const size_t c = this->cellOf(this->points[index]);
+		const uint32_t last = --this->ends[c];
+		const uint32_t position = this->positions[index];
+		const uint32_t moved = this->order[last];
+		this->order[position] = moved;
+		this->positions[moved] = position;
+		this->order[last] = static_cast<uint32_t>(index);
+		this->positions[index] = last;
+		this->taken[index] = true;
+	}
+
+	size_t cellOf(const RatioPoint& p) const {
+		const int64_t column = (p.x - this->minX) / this->cell;
+		const int64_t row = (p.y - this->minY) / this->cell;
+		return static_cast<size_t>(row * this->columns + column);
+	}
+
+	// @brief 网格外的点归入最近的格子
+	size_t clampedCellOf(const RatioPoint& p) const {
+		const int64_t column = min(max<int64_t>(floorDivide(p.x - this->minX, this->cell), 0), this->columns - 1);
+		const int64_t row = min(max<int64_t>(floorDivide(p.y - this->minY, this->cell), 0), this->rows - 1);
+		return static_cast<size_t>(row * this->columns + column);
+	}
+
+	// @brief (dx / radius.x)² + (dy / radius.y)²，不超过 1 即在范围内
+	static double normalizedDistance(int64_t dx, int64_t dy, const RatioPoint& radius) {
+		double distance = 0;
+		if (dx) {
+			if (!radius.x) return HUGE_VAL;
+			const double t = static_cast<double>(dx) / radius.x;
+			distance += t * t;
+		}
+		if (dy) {
+			if (!radius.y) return HUGE_VAL;
+			const double t = static_cast<double>(dy) / radius.y;
+			distance += t * t;
+		}
+		return distance;
+	}
+
+	static int64_t floorDivide(int64_t value, int64_t divisor) {
+		return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+	}
+
+	const RatioPointVector& points;
+	vector<bool> taken;
+	int64_t minX = 0, minY = 0;
+	int64_t cell = 1;
+	int64_t columns = 0, rows = 0;
+	vector<uint32_t> starts;	// 第 c 个格子的点为 order[starts[c], ends[c])，取出的点移到 ends[c] 之后
+	vector<uint32_t> ends;
+	vector<uint32_t> order;
+	vector<uint32_t> positions;	// 点在 order 中的位置
+};
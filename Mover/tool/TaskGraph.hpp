@@ -0,0 +1,190 @@
+﻿/**
+ * @file tool\TaskGraph.hpp
+ * @brief 按依赖关系并行执行的阶段图
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+using namespace std;
+
+// @class TaskGraph
+// @brief 阶段图：每个阶段在其依赖全部成功后由工作线程执行，互不依赖的阶段同时进行
+// @note 某个阶段失败（返回 false）时，所有直接或间接依赖它的阶段都会被跳过
+// @note 用法：
+//			TaskGraph graph;
+//			auto read = graph.add(L"读取", [&] { ... return true; });
+//			auto move = graph.add(L"移动", [&] { ... return true; }, { read });
+//			bool ok = graph.run();
+class TaskGraph {
+public:
+	typedef size_t StageID;
+
+	enum class StageState : int {
+		PENDING,	// 未执行
+		SUCCEEDED,	// 成功
+		FAILED,		// 返回 false 或抛出异常
+		SKIPPED		// 依赖失败，没有执行
+	};
+
+	// @struct Stage
+	// @brief 阶段信息，时间均为相对 run() 开始的毫秒数
+	struct Stage {
+		wstring name;
+		function<bool()> work;
+		vector<StageID> dependencies;
+		StageState state = StageState::PENDING;
+		double start = 0;
+		double end = 0;
+	};
+
+	// @brief 添加阶段
+	// @param dependencies 必须先完成的阶段（只能是已经添加的阶段）
+	// @ret 阶段 ID
+	// @throw invalid_argument 依赖了自己或还没有添加的阶段（否则 run() 会永远等待）
+	StageID add(const wstring& name, function<bool()> work, const vector<StageID>& dependencies = {}) {
+		Stage stage;
+		stage.name = name;
+		stage.work = std::move(work);
+		stage.dependencies = dependencies;
+		sort(stage.dependencies.begin(), stage.dependencies.end());
+		stage.dependencies.erase(unique(stage.dependencies.begin(), stage.dependencies.end()), stage.dependencies.end());
+		if (!stage.dependencies.empty() && stage.dependencies.back() >= this->stages.size())
+			throw invalid_argument("TaskGraph::add: 依赖必须是已经添加的阶段");
+		this->stages.push_back(std::move(stage));
+		return this->stages.size() - 1;
+	}
+
+	// @brief 执行全部阶段，阻塞到全部结束
+	// @param workers 工作线程数，0 表示按 CPU 核心数（至少 2 个，阶段大多在等待 IO / IPC）
+	// @ret 是否全部成功
+	bool run(unsigned workers = 0) {
+		this->started = clock::now();
+		for (auto& stage : this->stages) stage.state = StageState::PENDING;
+
+		vector<size_t> waiting(this->stages.size());
+		for (StageID id = 0; id < this->stages.size(); ++id) {
+			waiting[id] = this->stages[id].dependencies.size();
+			if (waiting[id] == 0) this->ready.push_back(id);
+		}
+		this->finished = 0;
+
+		if (workers == 0) workers = max(2u, thread::hardware_concurrency());
+		workers = static_cast<unsigned>(min<size_t>(workers, max<size_t>(this->stages.size(), 1)));
+
+		vector<thread> threads;
+		for (unsigned i = 0; i < workers; ++i)
+			threads.emplace_back(&TaskGraph::worker, this, ref(waiting));
+		for (auto& t : threads) t.join();
+
+		this->wall = this->elapsed();
+		return all_of(this->stages.begin(), this->stages.end(),
+			[](const Stage& stage) { return stage.state == StageState::SUCCEEDED; });
+	}
+
+	const vector<Stage>& getStages() const {
+		return this->stages;
+	}
+
+	// @brief 上次 run() 的总耗时（毫秒）
+	double wallTime() const {
+		return this->wall;
+	}
+
+	// @brief 关键路径长度（毫秒）：依赖链上阶段耗时之和的最大值
+	double criticalPath() const {
+		vector<double> finish(this->stages.size(), 0);
+		double longest = 0;
+		for (StageID id = 0; id < this->stages.size(); ++id) { // 依赖总在前面，按顺序即可
+			double begin = 0;
+			for (StageID dependency : this->stages[id].dependencies)
+				begin = max(begin, finish[dependency]);
+			finish[id] = begin + (this->stages[id].end - this->stages[id].start);
+			longest = max(longest, finish[id]);
+		}
+		return longest;
+	}
+
+	// @brief 各阶段耗时报告，每个阶段一行
+	wstring report() const {
+		wostringstream out;
+		out.imbue(locale::classic());
+		out << fixed << setprecision(1);
+		for (const auto& stage : this->stages) {
+			out << L"  " << left << setw(12) << stage.name << right
+				<< setw(9) << stage.start << L" -> " << setw(9) << stage.end << L" ms"
+				<< L"  (" << (stage.end - stage.start) << L" ms)";
+			if (stage.state == StageState::FAILED) out << L"  失败";
+			if (stage.state == StageState::SKIPPED) out << L"  跳过";
+			out << L"\n";
+		}
+		out << L"  总耗时 " << this->wall << L" ms，关键路径 " << this->criticalPath() << L" ms\n";
+		return out.str();
+	}
+
+private:
+	typedef chrono::steady_clock clock;
+
+	double elapsed() const {
+		return chrono::duration<double, milli>(clock::now() - this->started).count();
+	}
+
+	// @brief 工作线程：取出就绪阶段执行，完成后释放依赖它的阶段
+	void worker(vector<size_t>& waiting) {
+		unique_lock<mutex> guard(this->stageMutex);
+		while (true) {
+			this->changed.wait(guard, [&] { return !this->ready.empty() || this->finished == this->stages.size(); });
+			if (this->ready.empty()) return;
+
+			const StageID id = this->ready.front();
+			this->ready.pop_front();
+			Stage& stage = this->stages[id];
+
+			// 有依赖失败则跳过
+			const bool skip = any_of(stage.dependencies.begin(), stage.dependencies.end(),
+				[&](StageID dependency) { return this->stages[dependency].state != StageState::SUCCEEDED; });
+
+			stage.start = this->elapsed();
+			bool succeeded = false;
+			if (!skip) {
+				guard.unlock();
+				try {
+					succeeded = stage.work();
+				}
+				catch (...) {
+					succeeded = false;
+				}
+				guard.lock();
+			}
+			stage.end = this->elapsed();
+			stage.state = skip ? StageState::SKIPPED : (succeeded ? StageState::SUCCEEDED : StageState::FAILED);
+
+			// 释放后继阶段
+			for (StageID next = id + 1; next < this->stages.size(); ++next) {
+				const auto& dependencies = this->stages[next].dependencies;
+				if (find(dependencies.begin(), dependencies.end(), id) != dependencies.end() && --waiting[next] == 0)
+					this->ready.push_back(next);
+			}
+			++this->finished;
+			this->changed.notify_all();
+		}
+	}
+
+	vector<Stage> stages;
+	deque<StageID> ready;
+	size_t finished = 0;
+	mutex stageMutex;
+	condition_variable changed;
+	clock::time_point started;
+	double wall = 0;
+};
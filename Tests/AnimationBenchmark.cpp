@@ -0,0 +1,86 @@
+﻿/**
+ * @file AnimationBenchmark.cpp
+ * @brief 在模拟桌面后端上播放图标动画，测量不同图标数量下可达到的帧率与丢帧数
+ * @note 用法: AnimationBenchmark [每次后端调用的延迟(微秒)]，默认 ANIMATION_BENCHMARK_LATENCY
+ * @note 流程与 Agent 的 ProcessAnimateRequest 相同：按批读取起点，每帧把所有图标作为一批交给 RunBatch
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "backend/SimulatedDesktopBackend.hpp"
+#include "DesktopIcons.hpp"
+#include "tool/Animator.hpp"
+#include "common/fixedpoint.h"
+using namespace std;
+
+constexpr int ANIMATION_BENCHMARK_ICON_COUNTS[] = { 10, 100, 1000, 4000 };
+constexpr long long ANIMATION_BENCHMARK_LATENCY = 2;		// 默认每次后端调用的延迟（微秒）
+constexpr uint32_t ANIMATION_BENCHMARK_DURATION = 500;		// 每轮动画时长（毫秒）
+
+// @struct Track
+// @brief 一个图标的起点与终点（同 Agent 的 AnimationTrack）
+struct Track {
+	int index;
+	DesktopPoint from;
+	DesktopPoint to;
+};
+
+// @brief 对 count 个图标播放一次动画：每个图标移到第 count - 1 - i 个图标的位置
+// @ret 动画是否播放完且所有图标停在终点
+static bool runBenchmark(int count, long long latency) {
+	SimulatedDesktopBackend desktop(latency);
+	desktop.Populate(count);
+
+	DesktopIcons icons(&desktop);
+	const DesktopPoint screen = icons.GetScreenSize();
+	SliceScheduler scheduler(0);
+	vector<DesktopPoint> points;
+	if (!icons.Read(count, nullptr, &points, scheduler)) {
+		printf("FAIL [%d icons] reading start positions\n", count);
+		return false;
+	}
+
+	vector<Track> tracks;
+	tracks.reserve(count);
+	for (int i = 0; i < count; ++i) {
+		const DesktopPoint& target = points[count - 1 - i];
+		tracks.push_back({ i, points[i], icons.ToDevicePoint(pixelToQ16(target.x, screen.x), pixelToQ16(target.y, screen.y), true) });
+	}
+
+	desktop.ResetCallCount();
+	desktop.ResetBatchCount();
+	Animator animator(ANIMATION_BENCHMARK_DURATION, ANIMATION_DEFAULT_FPS, Easing::EASING_EASE_IN_OUT);
+	int failed = 0;
+	const bool finished = animator.play([&](RatioQ16 progress) {
+		failed = 0;
+		desktop.RunBatch([&] {
+			for (const Track& track : tracks) {
+				const DesktopPoint point = { interpolate(track.from.x, track.to.x, progress), interpolate(track.from.y, track.to.y, progress) };
+				if (!desktop.SetItemPosition(track.index, point)) ++failed;
+			}
+		});
+	}, [] { return false; });
+
+	printf("%6d icons  %4u / %4u frames  %4u dropped  %6.1f fps  slowest frame %7u us  %8llu calls\n",
+		count, animator.framesRendered(), animator.plannedFrames(), animator.framesDropped(),
+		animator.achievedFps(), animator.maxFrameMicroseconds(), desktop.GetCallCount());
+
+	vector<DesktopPoint> moved;
+	bool ok = finished && failed == 0 && icons.Read(count, nullptr, &moved, scheduler);
+	for (int i = 0; ok && i < count; ++i)
+		ok = moved[i].x == tracks[i].to.x && moved[i].y == tracks[i].to.y;
+	if (!ok) printf("FAIL [%d icons] icons did not end at their targets\n", count);
+	return ok;
+}
+
+int main(int argc, char* argv[]) {
+	const long long latency = argc > 1 ? atoll(argv[1]) : ANIMATION_BENCHMARK_LATENCY;
+	printf("simulated latency: %lld us per call, %u ms at %u fps\n", latency, ANIMATION_BENCHMARK_DURATION, ANIMATION_DEFAULT_FPS);
+
+	bool ok = true;
+	for (int count : ANIMATION_BENCHMARK_ICON_COUNTS) ok &= runBenchmark(count, latency);
+	printf(ok ? "OK\n" : "FAILED\n");
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,119 @@
+﻿/**
+ * @file BufferPoolTest.cpp
+ * @brief BufferPool 分配次数测试：稳定运行时借出、归还命令缓冲区不应再分配堆内存
+ * @note SharedData 依赖 Windows.h，这里用大小相近的结构代替（约 133 KB）
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "tool/BufferPool.hpp"
+using namespace std;
+
+constexpr int STEADY_ITERATIONS = 100000;
+constexpr int THREAD_COUNT = 4;
+
+// @brief 全局 operator new 的调用次数
+static atomic<size_t> heapAllocations{ 0 };
+
+void* operator new(size_t size) {
+	++heapAllocations;
+	if (void* p = malloc(size ? size : 1)) return p;
+	throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	free(p);
+}
+
+// @struct LargeCommand
+// @brief 代替 SharedData：头部字段 + 大块数据
+struct LargeCommand {
+	int command;
+	int size;
+	char payload[133 * 1024];
+};
+
+// @brief 模拟一次命令：借出，重置头部，写入少量数据，归还
+static void runCommand(BufferPool<LargeCommand>& pool, int i) {
+	auto command = pool.acquire();
+	command->command = i;
+	command->size = 16;
+	memset(command->payload, i & 0xFF, 16);
+}
+
+// @brief 检查失败时输出原因
+// @ret condition
+static bool expect(bool condition, const char* what, size_t actual) {
+	if (!condition) printf("FAIL %s (got %zu)\n", what, actual);
+	return condition;
+}
+
+int main() {
+	bool ok = true;
+
+	// 单线程：预热后借出、归还都不分配
+	{
+		BufferPool<LargeCommand> pool;
+		runCommand(pool, 0);
+		const size_t heapBefore = heapAllocations;
+		for (int i = 0; i < STEADY_ITERATIONS; ++i) runCommand(pool, i);
+		const size_t heapDelta = heapAllocations - heapBefore;
+		ok &= expect(heapDelta == 0, "heap allocations in steady state", heapDelta);
+		ok &= expect(pool.allocations() == 1, "pool allocations in steady state", pool.allocations());
+	}
+
+	// 同时借出多个：分配次数等于最大并发数，不超过容量时归还后全部保留
+	{
+		BufferPool<LargeCommand> pool(4);
+		{
+			auto a = pool.acquire();
+			auto b = pool.acquire();
+			auto c = pool.acquire();
+		}
+		const size_t heapBefore = heapAllocations;
+		for (int i = 0; i < STEADY_ITERATIONS; ++i) {
+			auto a = pool.acquire();
+			auto b = pool.acquire();
+			auto c = pool.acquire();
+		}
+		const size_t heapDelta = heapAllocations - heapBefore;
+		ok &= expect(heapDelta == 0, "heap allocations with three leases", heapDelta);
+		ok &= expect(pool.allocations() == 3, "pool allocations with three leases", pool.allocations());
+		ok &= expect(pool.available() == 3, "idle buffers with three leases", pool.available());
+	}
+
+	// 超过容量：多出的对象归还时释放，池中最多保留 capacity 个
+	{
+		BufferPool<LargeCommand> pool(2);
+		{
+			vector<BufferPool<LargeCommand>::Lease> leases;
+			for (int i = 0; i < 5; ++i) leases.push_back(pool.acquire());
+		}
+		ok &= expect(pool.allocations() == 5, "pool allocations over capacity", pool.allocations());
+		ok &= expect(pool.available() == 2, "idle buffers over capacity", pool.available());
+	}
+
+	// 多线程：分配次数不超过线程数
+	{
+		BufferPool<LargeCommand> pool(THREAD_COUNT);
+		vector<thread> threads;
+		for (int t = 0; t < THREAD_COUNT; ++t)
+			threads.emplace_back([&pool] {
+				for (int i = 0; i < STEADY_ITERATIONS; ++i) runCommand(pool, i);
+			});
+		for (thread& t : threads) t.join();
+		ok &= expect(pool.allocations() <= THREAD_COUNT, "pool allocations across threads", pool.allocations());
+	}
+
+	printf(ok ? "OK\n" : "FAILED\n");
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
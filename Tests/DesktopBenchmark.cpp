@@ -0,0 +1,147 @@
+﻿/**
+ * @file DesktopBenchmark.cpp
+ * @brief 在模拟桌面后端上运行枚举、查找、移动流程并计时
+ * @note 用法: DesktopBenchmark [每次后端调用的延迟(微秒)]，默认 0
+ * @note 流程与 Agent 相同：枚举同 CaptureEnumerationSnapshot，移动同 ProcessMoveRequest（按比率移动）
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "backend/SimulatedDesktopBackend.hpp"
+#include "DesktopIcons.hpp"
+#include "common/fixedpoint.h"
+using namespace std;
+
+constexpr int BENCHMARK_ICON_COUNTS[] = { 10, 1000, 50000 };
+constexpr uint32_t BENCHMARK_SLICE_BUDGET = 8000;	// 与客户端默认的时间片预算相同（微秒）
+
+// @class Stopwatch
+// @brief 毫秒计时
+class Stopwatch {
+public:
+	Stopwatch() : start(chrono::steady_clock::now()) {}
+
+	double milliseconds() const {
+		return chrono::duration<double, milli>(chrono::steady_clock::now() - this->start).count();
+	}
+
+private:
+	chrono::steady_clock::time_point start;
+};
+
+// @brief 检查失败时输出原因
+// @ret condition
+static bool expect(bool condition, int count, const char* what) {
+	if (!condition) printf("FAIL [%d icons] %s\n", count, what);
+	return condition;
+}
+
+// @brief 输出一个阶段的用时与后端调用次数，然后清零计数
+static void report(SimulatedDesktopBackend& desktop, int count, const char* phase, const Stopwatch& watch, const SliceScheduler* scheduler) {
+	printf("%6d icons  %-10s %10.3f ms  %8llu calls  %6llu batches",
+		count, phase, watch.milliseconds(), desktop.GetCallCount(), desktop.GetBatchCount());
+	if (scheduler) printf("  max slice %u us", scheduler->maxSliceMicroseconds());
+	printf("\n");
+	desktop.ResetCallCount();
+	desktop.ResetBatchCount();
+}
+
+// @brief 对 count 个图标运行一轮枚举、查找、移动
+// @ret 结果是否全部正确
+static bool runBenchmark(int count, long long latency) {
+	SimulatedDesktopBackend desktop(latency);
+	desktop.Populate(count);
+	desktop.ResetCallCount();
+	bool ok = true;
+
+	// 枚举：名称与坐标按批读取
+	vector<wstring> names;
+	vector<DesktopPoint> points;
+	{
+		Stopwatch watch;
+		SliceScheduler scheduler(BENCHMARK_SLICE_BUDGET);
+		ok &= expect(DesktopIcons(&desktop).Read(desktop.GetItemCount(), &names, &points, scheduler), count, "enumeration stopped");
+		scheduler.finish();
+		report(desktop, count, "enumerate", watch, &scheduler);
+	}
+	ok &= expect(names.size() == static_cast<size_t>(count) && points.size() == static_cast<size_t>(count), count, "enumeration size");
+	if (!ok) return false;
+
+	// 查找：建表后按名称逐个查找，不访问后端
+	{
+		Stopwatch watch;
+		IconIndex index;
+		index.Build(names);
+		bool found = true;
+		for (int i = count - 1; i >= 0; --i) found &= index.Find(names[i].c_str()) == i;
+		found &= index.Find(L"missing.lnk") == -1;
+		report(desktop, count, "lookup", watch, nullptr);
+		ok &= expect(found, count, "lookup result");
+	}
+
+	// 移动：第 i 个图标移到第 count - 1 - i 个图标的位置，坐标以 Q16 比率传入
+	// 不分片（预算为 0）：每批仍然最多 MAX_BATCH_ICONS 个图标，批与批之间不睡眠
+	vector<DesktopPoint> expected(count);
+	{
+		Stopwatch watch;
+		DesktopIcons icons(&desktop);
+		const DesktopPoint screen = icons.GetScreenSize();
+		vector<wstring> requestNames;
+		IconIndex index;
+		SliceScheduler reader(0);
+		ok &= expect(icons.Read(desktop.GetItemCount(), &requestNames, nullptr, reader), count, "name read stopped");
+		index.Build(requestNames);
+
+		vector<IconMove> moves;
+		moves.reserve(count);
+		for (int i = 0; i < count; ++i) {
+			const int item = index.Find(names[i].c_str());
+			const DesktopPoint& target = points[count - 1 - i];
+			const DesktopPoint point = icons.ToDevicePoint(pixelToQ16(target.x, screen.x), pixelToQ16(target.y, screen.y), true);
+			if (item >= 0) {
+				moves.push_back({ item, point });
+				expected[item] = point;
+			}
+		}
+		vector<size_t> failed;
+		SliceScheduler scheduler(0);
+		const size_t done = icons.Move(moves, scheduler, failed);
+		scheduler.finish();
+		const unsigned long long batches = desktop.GetBatchCount();
+		const size_t slices = scheduler.sliceCount();
+		report(desktop, count, "move", watch, &scheduler);
+
+		ok &= expect(moves.size() == static_cast<size_t>(count), count, "move resolution");
+		ok &= expect(done == moves.size() && failed.empty(), count, "move result");
+		const unsigned long long batchesPerPass = (count + MAX_BATCH_ICONS - 1) / MAX_BATCH_ICONS;
+		ok &= expect(batches == 2 * batchesPerPass, count, "batch cap with slice budget 0");
+		ok &= expect(slices == 1, count, "slice budget 0 must not end slices between batches");
+	}
+
+	// 读回：每个图标都在目标位置
+	{
+		SliceScheduler scheduler(0);
+		vector<DesktopPoint> moved;
+		ok &= expect(DesktopIcons(&desktop).Read(count, nullptr, &moved, scheduler), count, "read back stopped");
+		bool same = moved.size() == expected.size();
+		for (size_t i = 0; same && i < moved.size(); ++i)
+			same = moved[i].x == expected[i].x && moved[i].y == expected[i].y;
+		ok &= expect(same, count, "positions after move");
+		desktop.ResetCallCount();
+		desktop.ResetBatchCount();
+	}
+	return ok;
+}
+
+int main(int argc, char* argv[]) {
+	const long long latency = argc > 1 ? atoll(argv[1]) : 0;
+	printf("simulated latency: %lld us per call\n", latency);
+
+	bool ok = true;
+	for (int count : BENCHMARK_ICON_COUNTS) ok &= runBenchmark(count, latency);
+	printf(ok ? "OK\n" : "FAILED\n");
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,99 @@
+﻿/**
+ * @file FixedPointTest.cpp
+ * @brief Q16 坐标往返测试：保存时 pixelToQ16，移动时 q16ToDevicePixel，DPI_BASE 下必须逐位还原
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include "backend/SimulatedDesktopBackend.hpp"
+#include "DesktopIcons.hpp"
+#include "common/fixedpoint.h"
+using namespace std;
+
+// 常见的屏幕宽高，以及接近 65536 上限的值
+constexpr int TEST_SCREEN_SIZES[] = { 1, 3, 600, 768, 800, 900, 1024, 1080, 1200, 1280, 1366, 1440, 1600, 1920,
+	2160, 2560, 2880, 3440, 3840, 5120, 7680, 15360, 32767, 65535 };
+
+// @brief [-screen, 2 * screen] 内的每个像素：pixel -> Q16 -> 设备像素（DPI_BASE）
+// @note 包含屏幕外的坐标（多显示器、超出可见区域的图标）
+// @ret 不能还原的像素数
+static long long countScreenMismatches(int screen) {
+	long long mismatches = 0;
+	for (long pixel = -screen; pixel <= 2L * screen; ++pixel) {
+		const RatioQ16 q = pixelToQ16(pixel, screen);
+		if (q16ToDevicePixel(q, screen) != pixel) {
+			if (mismatches == 0) printf("FAIL screen %d: pixel %ld -> q %d -> %d\n", screen, pixel, q, q16ToDevicePixel(q, screen));
+			++mismatches;
+		}
+	}
+	return mismatches;
+}
+
+// @brief Q16 -> double -> Q16（旧布局文件中的 double 比率）
+// @ret 不能还原的值的数量
+static long long countRatioMismatches() {
+	long long mismatches = 0;
+	for (int64_t q = -4 * RATIO_Q16_ONE; q <= 4 * RATIO_Q16_ONE; ++q)
+		if (ratioToQ16(q16ToRatio(static_cast<RatioQ16>(q))) != q) ++mismatches;
+	return mismatches;
+}
+
+// @brief 模拟一次保存再按比率移动：读出坐标，按 DataManager 的方式换成 Q16，打乱图标后按比率移回，读回的坐标必须与保存时相同
+// @ret 是否一致
+static bool saveAndRestore(long cx, long cy, int count) {
+	SimulatedDesktopBackend desktop;
+	desktop.SetScreenSize(cx, cy);
+	uint32_t seed = 12345;
+	auto next = [&seed](long range) {
+		seed = seed * 1664525u + 1013904223u;
+		return static_cast<long>((seed >> 8) % static_cast<uint32_t>(range));
+	};
+	for (int i = 0; i < count; ++i)
+		desktop.AddItem(to_wstring(i), next(2 * cx) - cx / 2, next(2 * cy) - cy / 2);
+
+	DesktopIcons icons(&desktop);
+	SliceScheduler scheduler(0);
+	vector<DesktopPoint> saved;
+	if (!icons.Read(count, nullptr, &saved, scheduler)) return false;
+
+	vector<IconMove> moves;
+	for (int i = 0; i < count; ++i) {
+		const RatioQ16 x = pixelToQ16(saved[i].x, cx);
+		const RatioQ16 y = pixelToQ16(saved[i].y, cy);
+		desktop.SetItemPosition(i, { 0, 0 });
+		moves.push_back({ i, icons.ToDevicePoint(x, y, true) });
+	}
+	vector<size_t> failed;
+	if (icons.Move(moves, scheduler, failed) != moves.size() || !failed.empty()) return false;
+
+	vector<DesktopPoint> restored;
+	if (!icons.Read(count, nullptr, &restored, scheduler)) return false;
+	for (int i = 0; i < count; ++i) {
+		if (restored[i].x != saved[i].x || restored[i].y != saved[i].y) {
+			printf("FAIL screen %ldx%ld: icon %d saved (%ld, %ld) restored (%ld, %ld)\n",
+				cx, cy, i, saved[i].x, saved[i].y, restored[i].x, restored[i].y);
+			return false;
+		}
+	}
+	return true;
+}
+
+int main() {
+	bool ok = true;
+
+	for (int screen : TEST_SCREEN_SIZES) ok &= countScreenMismatches(screen) == 0;
+
+	const long long ratioMismatches = countRatioMismatches();
+	if (ratioMismatches) printf("FAIL %lld Q16 values change through double\n", ratioMismatches);
+	ok &= ratioMismatches == 0;
+
+	ok &= saveAndRestore(1920, 1080, 1000);
+	ok &= saveAndRestore(1366, 768, 1000);
+	ok &= saveAndRestore(3440, 1440, 1000);
+	ok &= saveAndRestore(7680, 4320, 1000);
+
+	printf(ok ? "OK\n" : "FAILED\n");
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
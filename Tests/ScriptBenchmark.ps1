@@ -0,0 +1,75 @@
+﻿<#
+ .SYNOPSIS
+  对比同一组命令的两种执行方式：--script 在一个进程中依次执行，与每行命令启动一次 Mover.exe
+ .DESCRIPTION
+  两种方式都在脚本文件所在目录下执行，每种方式重复 -Repeat 次取平均。
+  只能在 Windows 上运行，并且会真的执行脚本中的命令；默认脚本（script-benchmark.txt）保存当前布局，再原样移回与校正，不改变桌面。
+  脚本文件按 Mover 的 --script 读取，不要带 BOM。
+ .PARAMETER Mover
+  Mover.exe 路径
+ .PARAMETER Script
+  脚本文件，每行一条命令（写法同命令行参数），# 开头为注释
+ .PARAMETER Repeat
+  每种方式的重复次数
+ .EXAMPLE
+  powershell -ExecutionPolicy Bypass -File Tests\ScriptBenchmark.ps1 -Mover x64\Release\Mover.exe
+#>
+param(
+	[string]$Mover = (Join-Path $PSScriptRoot "..\x64\Release\Mover.exe"),
+	[string]$Script = (Join-Path $PSScriptRoot "script-benchmark.txt"),
+	[int]$Repeat = 3
+)
+
+$ErrorActionPreference = "Stop"
+if (-not (Test-Path $Mover)) { throw "找不到 Mover.exe: $Mover" }
+$Mover = (Resolve-Path $Mover).Path
+$Script = (Resolve-Path $Script).Path
+$lines = @(Get-Content -Encoding UTF8 $Script | Where-Object { $_.Trim() -and -not $_.TrimStart().StartsWith("#") })
+if ($lines.Count -eq 0) { throw "脚本中没有命令: $Script" }
+$output = [IO.Path]::GetTempFileName()	# 丢弃 Mover 的控制台输出，只计时
+
+# @brief 运行一次 Mover.exe
+# @ret 用时（毫秒）；退出码不为 0 时停止
+function Invoke-Mover([string]$arguments) {
+	$watch = [Diagnostics.Stopwatch]::StartNew()
+	$process = Start-Process -FilePath $Mover -ArgumentList $arguments -NoNewWindow -Wait -PassThru -RedirectStandardOutput $output
+	$watch.Stop()
+	if ($process.ExitCode -ne 0) { throw "命令失败（退出码 $($process.ExitCode)）: $arguments" }
+	return $watch.Elapsed.TotalMilliseconds
+}
+
+Push-Location (Split-Path $Script)
+try {
+	$perLine = New-Object double[] $lines.Count
+	$separateTotal = 0.0
+	$scriptTotal = 0.0
+	for ($round = 0; $round -lt $Repeat; ++$round) {
+		# 每行一个进程
+		for ($i = 0; $i -lt $lines.Count; ++$i) {
+			$ms = Invoke-Mover $lines[$i]
+			$perLine[$i] += $ms
+			$separateTotal += $ms
+		}
+		# 同一组命令交给 --script
+		$scriptTotal += Invoke-Mover "--script=`"$Script`""
+	}
+}
+finally {
+	Pop-Location
+	Remove-Item $output -ErrorAction SilentlyContinue
+}
+
+$count = $lines.Count
+Write-Host ("{0} 条命令，每种方式重复 {1} 次（取平均）" -f $count, $Repeat)
+Write-Host ""
+Write-Host "每行一个进程:"
+for ($i = 0; $i -lt $count; ++$i) {
+	Write-Host ("  {0,10:N1} ms  {1}" -f ($perLine[$i] / $Repeat), $lines[$i])
+}
+Write-Host ""
+$separate = $separateTotal / $Repeat
+$batched = $scriptTotal / $Repeat
+Write-Host ("{0,-14} {1,12} {2,14}" -f "方式", "总用时(ms)", "每条命令(ms)")
+Write-Host ("{0,-14} {1,12:N1} {2,14:N1}" -f "每行一个进程", $separate, ($separate / $count))
+Write-Host ("{0,-14} {1,12:N1} {2,14:N1}" -f "--script", $batched, ($batched / $count))
+Write-Host ("--script 用时为逐个进程的 {0:P0}" -f ($batched / $separate))